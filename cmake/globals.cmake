@@ -6,4 +6,4 @@ set(GL_INCLUDE_DIRECTORIES
 	PUBLIC ${GLFW3_INCLUDE_DIRS}
 )
 
-set(GL_LIBS glfw glad)
+set(GL_LIBS glfw glad Threads::Threads)
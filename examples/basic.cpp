@@ -37,7 +37,8 @@ int main() {
   auto &blue_material = scene.make_material<gle::SolidColorMaterial>(
       glm::vec3(0.0, 0.0, 1.0), 1.0, 1.0);
 
-  auto &obj_mesh = scene.mesh(gle::load_obj_from_file("res/teacup.obj"));
+  auto &obj_mesh = scene.mesh(gle::load_obj_cached("res/teacup.obj"));
+  obj_mesh.vertex_format(gle::PACKED_VERTEX_FORMAT);
   scene.make_object(solid_shader, white_material, obj_mesh,
                     glm::vec3(-3, 0, -2), glm::vec3(0, 0, 0), glm::vec3(1));
 
@@ -72,7 +73,7 @@ int main() {
   window.add_mouse_listener(camera_state);
   window.add_task(camera_state);
 
-  window.make_render_pass<gle::ShadowRenderPass>();
+  window.make_render_pass<gle::ShadowRenderPass>(gle::ShadowOptions{3});
   window.make_render_pass<gle::ObjectRenderPass>();
 
   window.init(scene);
@@ -0,0 +1,165 @@
+#ifndef GLE_BOUNDS_HPP
+#define GLE_BOUNDS_HPP
+
+#include <array>
+#include <gle/common.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief An axis aligned bounding box
+///
+struct AABB {
+  /// @brief the minimum corner
+  ///
+  glm::vec3 min = glm::vec3(0);
+
+  /// @brief the maximum corner
+  ///
+  glm::vec3 max = glm::vec3(0);
+
+  /// @brief Get the smallest box containing all the given points
+  ///
+  /// @param points
+  /// @return AABB an empty box at the origin if there are no points
+  inline static AABB from_points(const std::vector<glm::vec3> &points);
+
+  /// @brief Get the center of the box
+  ///
+  /// @return glm::vec3
+  inline glm::vec3 center() const;
+
+  /// @brief Get the half size of the box along each axis
+  ///
+  /// @return glm::vec3
+  inline glm::vec3 extents() const;
+
+  /// @brief Get the box containing this box after the given transform
+  ///
+  /// @param transform
+  /// @return AABB
+  inline AABB transformed(const glm::mat4 &transform) const;
+
+  /// @brief Get the box containing this box and the other box
+  ///
+  /// @param other
+  /// @return AABB
+  inline AABB merged(const AABB &other) const;
+
+  /// @brief Check if this box overlaps the other box
+  ///
+  /// @param other
+  /// @return true if the boxes overlap or touch
+  inline bool overlaps(const AABB &other) const;
+
+  /// @brief Check if this box contains the other box
+  ///
+  /// @param other
+  /// @return true if the other box is inside or on the edge of this box
+  inline bool contains(const AABB &other) const;
+
+  /// @brief Get the surface area of the box
+  ///
+  /// @return float
+  inline float area() const;
+};
+
+/// @brief A ray, the points on the ray are origin + t * direction for t >= 0
+///
+struct Ray {
+  glm::vec3 origin = glm::vec3(0);
+  glm::vec3 direction = glm::vec3(0, 0, -1);
+
+  /// @brief Get the ray in the space of the given transform
+  ///
+  /// The ray parameter t of a point is the same before and after the transform
+  ///
+  /// @param transform
+  /// @return Ray
+  inline Ray transformed(const glm::mat4 &transform) const;
+
+  /// @brief Intersect the ray with a box
+  ///
+  /// @param box
+  /// @param max_t only hits closer than max_t are reported
+  /// @return the ray parameter where the ray enters the box, or max_t if it
+  ///         misses
+  inline float intersect(const AABB &box, float max_t) const;
+
+  /// @brief Intersect the ray with a triangle
+  ///
+  /// @param a
+  /// @param b
+  /// @param c
+  /// @param max_t only hits closer than max_t are reported
+  /// @return the ray parameter of the hit, or max_t if it misses
+  inline float intersect(const glm::vec3 &a, const glm::vec3 &b,
+                         const glm::vec3 &c, float max_t) const;
+};
+
+/// @brief A bounding sphere
+///
+struct BoundingSphere {
+  /// @brief the sphere center
+  ///
+  glm::vec3 center = glm::vec3(0);
+
+  /// @brief the sphere radius
+  ///
+  float radius = 0.0f;
+
+  /// @brief Get the sphere around the given points centered on their bounding
+  ///        box
+  ///
+  /// @param points
+  /// @return BoundingSphere
+  inline static BoundingSphere
+  from_points(const std::vector<glm::vec3> &points);
+
+  /// @brief Get the sphere containing this sphere after the given transform
+  ///
+  /// @param transform
+  /// @return BoundingSphere
+  inline BoundingSphere transformed(const glm::mat4 &transform) const;
+};
+
+/// @brief The six planes of a view frustum
+///
+/// The planes point inward, a point p is inside the plane when
+/// dot(plane, vec4(p, 1)) >= 0
+struct Frustum {
+  /// @brief the left, right, bottom, top, near and far planes
+  ///
+  std::array<glm::vec4, 6> planes;
+
+  /// @brief Get the frustum of the given view projection matrix
+  ///
+  /// @param view_projection
+  /// @return Frustum
+  inline static Frustum from_matrix(const glm::mat4 &view_projection);
+
+  /// @brief Check if the box is at least partially inside the frustum
+  ///
+  /// Conservative, boxes near the frustum corners may be reported as inside
+  ///
+  /// @param box
+  /// @return true if the box may be visible
+  inline bool intersects(const AABB &box) const;
+
+  /// @brief Check if the box is completely inside the frustum
+  ///
+  /// @param box
+  /// @return true if every corner of the box is inside the frustum
+  inline bool contains(const AABB &box) const;
+
+  /// @brief Check if the sphere is at least partially inside the frustum
+  ///
+  /// @param sphere
+  /// @return true if the sphere may be visible
+  inline bool intersects(const BoundingSphere &sphere) const;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_BOUNDS_HPP
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+
+GLE_NAMESPACE_BEGIN
+
+inline AABB AABB::from_points(const std::vector<glm::vec3> &points) {
+  if (points.empty()) return AABB();
+
+  auto box = AABB{points[0], points[0]};
+  for (const auto &point : points) {
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+  }
+  return box;
+}
+
+inline glm::vec3 AABB::center() const { return (min + max) * 0.5f; }
+
+inline glm::vec3 AABB::extents() const { return (max - min) * 0.5f; }
+
+inline AABB AABB::transformed(const glm::mat4 &transform) const {
+  // Transform the center and project the extents onto the new axes
+  auto new_center = glm::vec3(transform * glm::vec4(center(), 1.0f));
+  auto linear = glm::mat3(transform);
+  auto abs_linear = glm::mat3(glm::abs(linear[0]), glm::abs(linear[1]),
+                              glm::abs(linear[2]));
+  auto new_extents = abs_linear * extents();
+  return AABB{new_center - new_extents, new_center + new_extents};
+}
+
+inline AABB AABB::merged(const AABB &other) const {
+  return AABB{glm::min(min, other.min), glm::max(max, other.max)};
+}
+
+inline bool AABB::overlaps(const AABB &other) const {
+  return glm::all(glm::lessThanEqual(min, other.max)) &&
+         glm::all(glm::lessThanEqual(other.min, max));
+}
+
+inline bool AABB::contains(const AABB &other) const {
+  return glm::all(glm::lessThanEqual(min, other.min)) &&
+         glm::all(glm::lessThanEqual(other.max, max));
+}
+
+inline float AABB::area() const {
+  auto size = max - min;
+  return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+inline Ray Ray::transformed(const glm::mat4 &transform) const {
+  return Ray{glm::vec3(transform * glm::vec4(origin, 1.0f)),
+             glm::vec3(transform * glm::vec4(direction, 0.0f))};
+}
+
+inline float Ray::intersect(const AABB &box, float max_t) const {
+  // Slab test, divisions by zero give infinities which compare correctly
+  auto inv_direction = 1.0f / direction;
+  auto t0 = (box.min - origin) * inv_direction;
+  auto t1 = (box.max - origin) * inv_direction;
+  auto t_near = glm::min(t0, t1);
+  auto t_far = glm::max(t0, t1);
+  auto enter = std::max({t_near.x, t_near.y, t_near.z, 0.0f});
+  auto exit = std::min({t_far.x, t_far.y, t_far.z, max_t});
+  return enter <= exit ? enter : max_t;
+}
+
+inline float Ray::intersect(const glm::vec3 &a, const glm::vec3 &b,
+                            const glm::vec3 &c, float max_t) const {
+  // Moller-Trumbore
+  auto edge_1 = b - a;
+  auto edge_2 = c - a;
+  auto p = glm::cross(direction, edge_2);
+  auto det = glm::dot(edge_1, p);
+  if (std::abs(det) < 1e-12f) return max_t;
+
+  auto inv_det = 1.0f / det;
+  auto s = origin - a;
+  auto u = glm::dot(s, p) * inv_det;
+  if (u < 0.0f || u > 1.0f) return max_t;
+
+  auto q = glm::cross(s, edge_1);
+  auto v = glm::dot(direction, q) * inv_det;
+  if (v < 0.0f || u + v > 1.0f) return max_t;
+
+  auto t = glm::dot(edge_2, q) * inv_det;
+  return t >= 0.0f && t < max_t ? t : max_t;
+}
+
+inline BoundingSphere
+BoundingSphere::from_points(const std::vector<glm::vec3> &points) {
+  auto center = AABB::from_points(points).center();
+  float radius_2 = 0.0f;
+  for (const auto &point : points) {
+    auto offset = point - center;
+    radius_2 = std::max(radius_2, glm::dot(offset, offset));
+  }
+  return BoundingSphere{center, glm::sqrt(radius_2)};
+}
+
+inline BoundingSphere
+BoundingSphere::transformed(const glm::mat4 &transform) const {
+  auto new_center = glm::vec3(transform * glm::vec4(center, 1.0f));
+  // Non-uniform scale stretches the sphere by the largest axis scale
+  auto scale = std::max({glm::length(glm::vec3(transform[0])),
+                         glm::length(glm::vec3(transform[1])),
+                         glm::length(glm::vec3(transform[2]))});
+  return BoundingSphere{new_center, radius * scale};
+}
+
+inline Frustum Frustum::from_matrix(const glm::mat4 &view_projection) {
+  // Gribb and Hartmann plane extraction, glm matrices are column major
+  auto row = [&](int i) {
+    return glm::vec4(view_projection[0][i], view_projection[1][i],
+                     view_projection[2][i], view_projection[3][i]);
+  };
+
+  auto frustum = Frustum();
+  frustum.planes = {row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                    row(3) - row(1), row(3) + row(2), row(3) - row(2)};
+  for (auto &plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+inline bool Frustum::intersects(const AABB &box) const {
+  for (const auto &plane : planes) {
+    // The corner furthest along the plane normal
+    auto positive = glm::vec3(plane.x >= 0 ? box.max.x : box.min.x,
+                              plane.y >= 0 ? box.max.y : box.min.y,
+                              plane.z >= 0 ? box.max.z : box.min.z);
+    if (glm::dot(glm::vec3(plane), positive) + plane.w < 0) return false;
+  }
+  return true;
+}
+
+inline bool Frustum::contains(const AABB &box) const {
+  for (const auto &plane : planes) {
+    // The corner furthest against the plane normal
+    auto negative = glm::vec3(plane.x >= 0 ? box.min.x : box.max.x,
+                              plane.y >= 0 ? box.min.y : box.max.y,
+                              plane.z >= 0 ? box.min.z : box.max.z);
+    if (glm::dot(glm::vec3(plane), negative) + plane.w < 0) return false;
+  }
+  return true;
+}
+
+inline bool Frustum::intersects(const BoundingSphere &sphere) const {
+  for (const auto &plane : planes) {
+    if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+      return false;
+  }
+  return true;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <glm/gtc/matrix_transform.hpp>
+
+TEST_CASE("Frustum culls boxes outside the view") {
+  auto projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+  auto view =
+      glm::lookAt(glm::vec3(0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+  auto frustum = gle::Frustum::from_matrix(projection * view);
+
+  auto unit = gle::AABB{glm::vec3(-1), glm::vec3(1)};
+  auto at = [&](const glm::vec3 &position) {
+    return unit.transformed(glm::translate(glm::mat4(1), position));
+  };
+
+  CHECK(frustum.intersects(at(glm::vec3(0, 0, -10))));
+  CHECK(frustum.intersects(at(glm::vec3(10.5, 0, -10))));
+  CHECK_FALSE(frustum.intersects(at(glm::vec3(0, 0, 10))));
+  CHECK_FALSE(frustum.intersects(at(glm::vec3(20, 0, -10))));
+  CHECK_FALSE(frustum.intersects(at(glm::vec3(0, 0, -200))));
+
+  CHECK(frustum.intersects(gle::BoundingSphere{glm::vec3(0, 0, -10), 1.0f}));
+  CHECK_FALSE(
+      frustum.intersects(gle::BoundingSphere{glm::vec3(0, 0, 10), 1.0f}));
+}
+
+TEST_CASE("AABB::transformed contains the rotated box") {
+  auto box = gle::AABB{glm::vec3(-1), glm::vec3(1)};
+  auto rotated = box.transformed(
+      glm::rotate(glm::mat4(1), glm::radians(45.0f), glm::vec3(0, 1, 0)));
+  CHECK(rotated.max.x == doctest::Approx(glm::sqrt(2.0f)));
+  CHECK(rotated.max.y == doctest::Approx(1.0f));
+  CHECK(rotated.min.z == doctest::Approx(-glm::sqrt(2.0f)));
+}
+
+#endif
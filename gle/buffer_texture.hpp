@@ -0,0 +1,73 @@
+#ifndef GLE_BUFFER_TEXTURE_HPP
+#define GLE_BUFFER_TEXTURE_HPP
+
+#include <gle/common.hpp>
+#include <gle/gl.hpp>
+#include <gle/vbo.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+template <class T> constexpr GLenum buffer_texture_get_format() {
+  if constexpr (std::is_same<T, float>::value)
+    return GL_R32F;
+  else if constexpr (std::is_same<T, glm::vec4>::value)
+    return GL_RGBA32F;
+  else if constexpr (std::is_same<T, std::uint32_t>::value)
+    return GL_R32UI;
+  else if constexpr (std::is_same<T, glm::uvec2>::value)
+    return GL_RG32UI;
+  else
+    static_assert(dependent_false<T>::value,
+                  "Unable to detect buffer texture format");
+}
+
+} // namespace __internal__
+
+/// @brief A buffer texture (samplerBuffer in GLSL) for large arrays that do
+///        not fit in a uniform block
+///
+/// @tparam T the element type. This can be a float, uint32, glm::vec4 or
+///           glm::uvec2
+template <class T> class BufferTexture {
+public:
+  /// @brief the internal format of the texture (e.g. GL_RGBA32F)
+  ///
+  static constexpr GLenum gl_format =
+      __internal__::buffer_texture_get_format<T>();
+
+  BufferTexture(BufferTexture &) = delete;
+  BufferTexture(BufferTexture &&) = delete;
+  BufferTexture(const BufferTexture &) = delete;
+  BufferTexture(const BufferTexture &&) = delete;
+
+  inline BufferTexture();
+
+  inline ~BufferTexture();
+
+  /// @brief Gen the buffer and texture
+  ///
+  /// Must be called after GL is initialized
+  inline void init();
+
+  /// @brief Bind the texture to the given texture unit
+  ///
+  /// @param unit
+  inline void bind(GLuint unit) const;
+
+  /// @brief Replace the contents of the buffer
+  ///
+  /// @param data
+  inline void write(const std::vector<T> &data) const;
+
+private:
+  GLuint buffer;
+  GLuint texture;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_BUFFER_TEXTURE_HPP
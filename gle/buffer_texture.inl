@@ -0,0 +1,38 @@
+GLE_NAMESPACE_BEGIN
+
+template <class T>
+inline BufferTexture<T>::BufferTexture() : buffer(0), texture(0) {}
+
+template <class T> inline BufferTexture<T>::~BufferTexture() {
+  if (texture) glDeleteTextures(1, &texture);
+  if (buffer) glDeleteBuffers(1, &buffer);
+}
+
+template <class T> inline void BufferTexture<T>::init() {
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  glBufferData(GL_TEXTURE_BUFFER, sizeof(T), nullptr, GL_STREAM_DRAW);
+
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, gl_format, buffer);
+}
+
+template <class T> inline void BufferTexture<T>::bind(GLuint unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_BUFFER, texture);
+}
+
+template <class T>
+inline void BufferTexture<T>::write(const std::vector<T> &data) const {
+  glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+  // Orphan the old storage so the driver doesn't have to wait for draws that
+  // still read it
+  glBufferData(GL_TEXTURE_BUFFER, sizeof(T) * data.size(), nullptr,
+               GL_STREAM_DRAW);
+  if (!data.empty())
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, sizeof(T) * data.size(),
+                    data.data());
+}
+
+GLE_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,139 @@
+#ifndef GLE_BVH_HPP
+#define GLE_BVH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <gle/bounds.hpp>
+#include <gle/common.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief A dynamic bounding volume hierarchy
+///
+/// A binary tree of AABBs where every leaf holds one value. Leaves store a fat
+/// box, enlarged by a margin around the actual bounds, so values that move a
+/// little do not have to be reinserted. Leaves are inserted where they
+/// increase the surface area of the tree the least and the tree is kept
+/// balanced with rotations, so queries visit a logarithmic number of nodes.
+///
+/// @tparam T the type of value stored in the leaves
+template <class T> class BVH {
+public:
+  /// @brief Identifies a leaf of the tree
+  ///
+  using Proxy = std::int32_t;
+
+  /// @brief An invalid proxy
+  ///
+  static constexpr Proxy null_proxy = -1;
+
+  BVH(BVH &) = delete;
+  BVH(BVH &&) = delete;
+  BVH(const BVH &) = delete;
+  BVH(const BVH &&) = delete;
+
+  /// @brief Construct an empty BVH
+  ///
+  /// @param margin the fraction of the bounds size added around leaf bounds
+  inline explicit BVH(float margin = 0.1f);
+
+  /// @brief Insert a value
+  ///
+  /// @param bounds the bounds of the value
+  /// @param value
+  /// @return Proxy the proxy of the new leaf
+  inline Proxy insert(const AABB &bounds, T value);
+
+  /// @brief Remove a value
+  ///
+  /// @param proxy the proxy returned by insert
+  inline void remove(Proxy proxy);
+
+  /// @brief Update the bounds of a value
+  ///
+  /// The leaf is only reinserted if the new bounds are not inside its fat box
+  ///
+  /// @param proxy the proxy returned by insert
+  /// @param bounds the new bounds of the value
+  /// @return true if the leaf was reinserted
+  inline bool move(Proxy proxy, const AABB &bounds);
+
+  /// @brief Get the fat bounds of a leaf
+  ///
+  /// @param proxy
+  /// @return const AABB&
+  inline const AABB &fat_bounds(Proxy proxy) const;
+
+  /// @brief Get the value of a leaf
+  ///
+  /// @param proxy
+  /// @return const T&
+  inline const T &value(Proxy proxy) const;
+
+  /// @brief Call fn(value) for every value whose fat bounds intersect the
+  ///        frustum
+  ///
+  /// @param frustum
+  /// @param fn
+  template <class F> inline void query(const Frustum &frustum, F &&fn) const;
+
+  /// @brief Call fn(value) for every value whose fat bounds overlap the box
+  ///
+  /// @param box
+  /// @param fn
+  template <class F> inline void query(const AABB &box, F &&fn) const;
+
+  /// @brief Call fn(value, max_t) for every value whose fat bounds are hit by
+  ///        the ray closer than max_t, nearest boxes first
+  ///
+  /// fn returns the ray parameter of its hit, or max_t if the value was
+  /// missed, and later boxes are clipped to the closest hit so far.
+  ///
+  /// @param ray
+  /// @param max_t
+  /// @param fn
+  template <class F>
+  inline void raycast(const Ray &ray, float max_t, F &&fn) const;
+
+  /// @brief Get the number of values in the tree
+  ///
+  /// @return std::size_t
+  inline std::size_t size() const;
+
+  /// @brief Get the height of the tree, 0 for a single leaf
+  ///
+  /// @return int
+  inline int height() const;
+
+private:
+  struct Node {
+    AABB bounds;
+    T value;
+    Proxy parent;
+    Proxy left;
+    Proxy right;
+    // -1 for free nodes
+    int height;
+
+    inline bool is_leaf() const { return left == null_proxy; }
+  };
+
+  inline Proxy allocate_node();
+  inline void free_node(Proxy node);
+  inline void insert_leaf(Proxy leaf);
+  inline void remove_leaf(Proxy leaf);
+  inline void refit_ancestors(Proxy node);
+  inline Proxy balance(Proxy node);
+  inline AABB fatten(const AABB &bounds) const;
+
+  std::vector<Node> nodes;
+  Proxy root;
+  Proxy free_list;
+  std::size_t _size;
+  float margin;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_BVH_HPP
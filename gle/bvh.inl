@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <utility>
+
+GLE_NAMESPACE_BEGIN
+
+template <class T>
+inline BVH<T>::BVH(float margin)
+    : root(null_proxy), free_list(null_proxy), _size(0), margin(margin) {}
+
+template <class T>
+inline typename BVH<T>::Proxy BVH<T>::insert(const AABB &bounds, T value) {
+  auto leaf = allocate_node();
+  nodes[leaf].bounds = fatten(bounds);
+  nodes[leaf].value = std::move(value);
+  insert_leaf(leaf);
+  _size++;
+  return leaf;
+}
+
+template <class T> inline void BVH<T>::remove(Proxy proxy) {
+  remove_leaf(proxy);
+  free_node(proxy);
+  _size--;
+}
+
+template <class T>
+inline bool BVH<T>::move(Proxy proxy, const AABB &bounds) {
+  if (nodes[proxy].bounds.contains(bounds)) return false;
+
+  remove_leaf(proxy);
+  nodes[proxy].bounds = fatten(bounds);
+  insert_leaf(proxy);
+  return true;
+}
+
+template <class T>
+inline const AABB &BVH<T>::fat_bounds(Proxy proxy) const {
+  return nodes[proxy].bounds;
+}
+
+template <class T> inline const T &BVH<T>::value(Proxy proxy) const {
+  return nodes[proxy].value;
+}
+
+template <class T>
+template <class F>
+inline void BVH<T>::query(const Frustum &frustum, F &&fn) const {
+  if (root == null_proxy) return;
+
+  // Subtrees completely inside the frustum are reported without more tests
+  auto stack = std::vector<std::pair<Proxy, bool>>{{root, false}};
+  while (!stack.empty()) {
+    auto [index, inside] = stack.back();
+    stack.pop_back();
+    const auto &node = nodes[index];
+
+    if (!inside) {
+      if (!frustum.intersects(node.bounds)) continue;
+      inside = frustum.contains(node.bounds);
+    }
+
+    if (node.is_leaf()) {
+      fn(node.value);
+    } else {
+      stack.emplace_back(node.left, inside);
+      stack.emplace_back(node.right, inside);
+    }
+  }
+}
+
+template <class T>
+template <class F>
+inline void BVH<T>::query(const AABB &box, F &&fn) const {
+  if (root == null_proxy) return;
+
+  auto stack = std::vector<Proxy>{root};
+  while (!stack.empty()) {
+    const auto &node = nodes[stack.back()];
+    stack.pop_back();
+
+    if (!node.bounds.overlaps(box)) continue;
+
+    if (node.is_leaf()) {
+      fn(node.value);
+    } else {
+      stack.push_back(node.left);
+      stack.push_back(node.right);
+    }
+  }
+}
+
+template <class T>
+template <class F>
+inline void BVH<T>::raycast(const Ray &ray, float max_t, F &&fn) const {
+  if (root == null_proxy) return;
+
+  auto root_t = ray.intersect(nodes[root].bounds, max_t);
+  if (root_t >= max_t) return;
+
+  auto stack = std::vector<std::pair<Proxy, float>>{{root, root_t}};
+  while (!stack.empty()) {
+    auto [index, t] = stack.back();
+    stack.pop_back();
+    if (t >= max_t) continue;
+
+    const auto &node = nodes[index];
+    if (node.is_leaf()) {
+      max_t = std::min(max_t, fn(node.value, max_t));
+      continue;
+    }
+
+    // Push the further child first so the nearer one is visited first
+    auto left_t = ray.intersect(nodes[node.left].bounds, max_t);
+    auto right_t = ray.intersect(nodes[node.right].bounds, max_t);
+    if (left_t < right_t) {
+      if (right_t < max_t) stack.emplace_back(node.right, right_t);
+      stack.emplace_back(node.left, left_t);
+    } else {
+      if (left_t < max_t) stack.emplace_back(node.left, left_t);
+      if (right_t < max_t) stack.emplace_back(node.right, right_t);
+    }
+  }
+}
+
+template <class T> inline std::size_t BVH<T>::size() const { return _size; }
+
+template <class T> inline int BVH<T>::height() const {
+  return root == null_proxy ? 0 : nodes[root].height;
+}
+
+template <class T> inline typename BVH<T>::Proxy BVH<T>::allocate_node() {
+  Proxy node;
+  if (free_list != null_proxy) {
+    node = free_list;
+    free_list = nodes[node].parent;
+  } else {
+    node = (Proxy)nodes.size();
+    nodes.emplace_back();
+  }
+  nodes[node].parent = null_proxy;
+  nodes[node].left = null_proxy;
+  nodes[node].right = null_proxy;
+  nodes[node].height = 0;
+  return node;
+}
+
+template <class T> inline void BVH<T>::free_node(Proxy node) {
+  // Free nodes are linked through their parent index
+  nodes[node].parent = free_list;
+  nodes[node].height = -1;
+  free_list = node;
+}
+
+template <class T> inline void BVH<T>::insert_leaf(Proxy leaf) {
+  if (root == null_proxy) {
+    root = leaf;
+    nodes[root].parent = null_proxy;
+    return;
+  }
+
+  // Find the sibling that increases the surface area of the tree the least
+  auto leaf_bounds = nodes[leaf].bounds;
+  auto index = root;
+  while (!nodes[index].is_leaf()) {
+    const auto &node = nodes[index];
+    auto area = node.bounds.area();
+    auto combined_area = node.bounds.merged(leaf_bounds).area();
+
+    // Cost of making a new parent for this node and the leaf
+    auto cost = 2.0f * combined_area;
+    // Cost of pushing the leaf further down the tree
+    auto inheritance_cost = 2.0f * (combined_area - area);
+
+    auto child_cost = [&](Proxy child) {
+      const auto &bounds = nodes[child].bounds;
+      auto merged_area = bounds.merged(leaf_bounds).area();
+      if (nodes[child].is_leaf()) return merged_area + inheritance_cost;
+      return merged_area - bounds.area() + inheritance_cost;
+    };
+    auto left_cost = child_cost(node.left);
+    auto right_cost = child_cost(node.right);
+
+    if (cost < left_cost && cost < right_cost) break;
+    index = left_cost < right_cost ? node.left : node.right;
+  }
+
+  auto sibling = index;
+  auto old_parent = nodes[sibling].parent;
+  auto new_parent = allocate_node();
+  nodes[new_parent].parent = old_parent;
+  nodes[new_parent].bounds = nodes[sibling].bounds.merged(leaf_bounds);
+  nodes[new_parent].height = nodes[sibling].height + 1;
+  nodes[new_parent].left = sibling;
+  nodes[new_parent].right = leaf;
+  nodes[sibling].parent = new_parent;
+  nodes[leaf].parent = new_parent;
+
+  if (old_parent == null_proxy) {
+    root = new_parent;
+  } else if (nodes[old_parent].left == sibling) {
+    nodes[old_parent].left = new_parent;
+  } else {
+    nodes[old_parent].right = new_parent;
+  }
+
+  refit_ancestors(new_parent);
+}
+
+template <class T> inline void BVH<T>::remove_leaf(Proxy leaf) {
+  if (leaf == root) {
+    root = null_proxy;
+    return;
+  }
+
+  auto parent = nodes[leaf].parent;
+  auto grand_parent = nodes[parent].parent;
+  auto sibling =
+      nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+  nodes[sibling].parent = grand_parent;
+  if (grand_parent == null_proxy) {
+    root = sibling;
+  } else {
+    if (nodes[grand_parent].left == parent) {
+      nodes[grand_parent].left = sibling;
+    } else {
+      nodes[grand_parent].right = sibling;
+    }
+  }
+  free_node(parent);
+
+  refit_ancestors(grand_parent);
+}
+
+template <class T> inline void BVH<T>::refit_ancestors(Proxy index) {
+  while (index != null_proxy) {
+    index = balance(index);
+
+    auto &node = nodes[index];
+    const auto &left = nodes[node.left];
+    const auto &right = nodes[node.right];
+    node.height = 1 + std::max(left.height, right.height);
+    node.bounds = left.bounds.merged(right.bounds);
+
+    index = node.parent;
+  }
+}
+
+template <class T> inline typename BVH<T>::Proxy BVH<T>::balance(Proxy a) {
+  // Rotate the taller child of a up if the children heights differ by more
+  // than one, see Box2D's b2DynamicTree
+  auto &node_a = nodes[a];
+  if (node_a.is_leaf() || node_a.height < 2) return a;
+
+  auto rotate_up = [&](Proxy up, bool up_is_right) {
+    auto &node_up = nodes[up];
+    auto other = up_is_right ? node_a.left : node_a.right;
+    auto up_left = node_up.left;
+    auto up_right = node_up.right;
+
+    // up takes the place of a
+    node_up.left = a;
+    node_up.parent = node_a.parent;
+    node_a.parent = up;
+    if (node_up.parent == null_proxy) {
+      root = up;
+    } else if (nodes[node_up.parent].left == a) {
+      nodes[node_up.parent].left = up;
+    } else {
+      nodes[node_up.parent].right = up;
+    }
+
+    // The taller grandchild stays under up, the other one moves to a
+    auto keep = up_left, give = up_right;
+    if (nodes[up_left].height <= nodes[up_right].height)
+      std::swap(keep, give);
+
+    node_up.right = keep;
+    if (up_is_right) {
+      node_a.right = give;
+    } else {
+      node_a.left = give;
+    }
+    nodes[give].parent = a;
+
+    node_a.bounds = nodes[other].bounds.merged(nodes[give].bounds);
+    node_a.height = 1 + std::max(nodes[other].height, nodes[give].height);
+    node_up.bounds = node_a.bounds.merged(nodes[keep].bounds);
+    node_up.height = 1 + std::max(node_a.height, nodes[keep].height);
+    return up;
+  };
+
+  auto balance = nodes[node_a.right].height - nodes[node_a.left].height;
+  if (balance > 1) return rotate_up(node_a.right, true);
+  if (balance < -1) return rotate_up(node_a.left, false);
+  return a;
+}
+
+template <class T> inline AABB BVH<T>::fatten(const AABB &bounds) const {
+  auto extra = glm::max((bounds.max - bounds.min) * margin, glm::vec3(1e-3f));
+  return AABB{bounds.min - extra, bounds.max + extra};
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <random>
+
+TEST_CASE("BVH queries match a linear scan") {
+  auto rng = std::mt19937(1);
+  auto coord = std::uniform_real_distribution<float>(-100.0f, 100.0f);
+  auto size = std::uniform_real_distribution<float>(0.1f, 5.0f);
+  auto random_box = [&]() {
+    auto min = glm::vec3(coord(rng), coord(rng), coord(rng));
+    return gle::AABB{min, min + glm::vec3(size(rng), size(rng), size(rng))};
+  };
+
+  auto bvh = gle::BVH<int>();
+  auto boxes = std::vector<gle::AABB>();
+  auto proxies = std::vector<gle::BVH<int>::Proxy>();
+  for (int i = 0; i < 1000; i++) {
+    boxes.push_back(random_box());
+    proxies.push_back(bvh.insert(boxes.back(), i));
+  }
+  // Move half of the boxes and remove a few
+  for (int i = 0; i < 500; i++) {
+    boxes[i] = random_box();
+    bvh.move(proxies[i], boxes[i]);
+  }
+  for (int i = 990; i < 1000; i++) {
+    bvh.remove(proxies[i]);
+  }
+  boxes.resize(990);
+
+  CHECK(bvh.size() == 990);
+  CHECK(bvh.height() < 40);
+
+  auto query = gle::AABB{glm::vec3(-20), glm::vec3(20)};
+  auto found = std::vector<int>();
+  bvh.query(query, [&](int i) { found.push_back(i); });
+  std::sort(found.begin(), found.end());
+  // Leaves store fat boxes so the BVH may report a few extra values
+  std::size_t expected = 0;
+  for (std::size_t i = 0; i < boxes.size(); i++) {
+    if (!boxes[i].overlaps(query)) continue;
+    expected++;
+    CHECK(std::binary_search(found.begin(), found.end(), (int)i));
+  }
+  CHECK(found.size() >= expected);
+
+  // The closest hit of a ray matches the linear scan
+  auto ray = gle::Ray{glm::vec3(-150, 1, 2), glm::vec3(1, 0.01, 0.02)};
+  auto closest = 1e30f;
+  for (const auto &box : boxes) {
+    closest = std::min(closest, ray.intersect(box, closest));
+  }
+  auto bvh_closest = 1e30f;
+  bvh.raycast(ray, 1e30f, [&](int i, float max_t) {
+    auto t = ray.intersect(boxes[i], max_t);
+    bvh_closest = std::min(bvh_closest, t);
+    return t;
+  });
+  CHECK(bvh_closest == doctest::Approx(closest));
+}
+
+#endif
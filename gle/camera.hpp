@@ -1,6 +1,8 @@
 #ifndef GLE_CAMERA_HPP
 #define GLE_CAMERA_HPP
 
+#include <array>
+#include <gle/bounds.hpp>
 #include <gle/common.hpp>
 #include <glm/glm.hpp>
 
@@ -36,6 +38,26 @@ public:
   /// @return const glm::mat4&
   inline const glm::mat4 &projection_matrix() const;
 
+  /// @brief get the view frustum of the camera
+  ///
+  /// @return const Frustum&
+  inline const Frustum &frustum() const;
+
+  /// @brief get the world space ray through a point on the screen
+  ///
+  /// @param ndc the point in normalized device coordinates, (-1, -1) is the
+  ///        bottom left corner of the screen and (1, 1) the top right
+  /// @return Ray a ray starting on the near plane
+  inline Ray ray(const glm::vec2 &ndc) const;
+
+  /// @brief get the world space corners of a slice of the view frustum
+  ///
+  /// @param near the distance of the near side of the slice along the view
+  ///        direction
+  /// @param far the distance of the far side of the slice
+  /// @return the four near corners followed by the four far corners
+  inline std::array<glm::vec3, 8> frustum_corners(float near, float far) const;
+
   /// @brief get the camera direction
   ///
   /// @return glm::vec3
@@ -53,15 +75,36 @@ public:
   /// @param origin
   inline void origin(const glm::vec3 &origin);
 
+  /// @brief get the camera aspect ratio
+  ///
+  /// @return float
+  inline float aspect() const;
+
+  /// @brief get the camera vertical field of view in radians
+  ///
+  /// @return float
+  inline float fov() const;
+
+  /// @brief get the distance to the near clipping plane
+  ///
+  /// @return float
+  inline float z_near() const;
+
+  /// @brief get the distance to the far clipping plane
+  ///
+  /// @return float
+  inline float z_far() const;
+
 private:
   inline void update_view_projection();
   glm::mat4 _view_matrix;
   glm::mat4 _projection_matrix;
+  Frustum _frustum;
 
-  float aspect;
-  float fov;
-  float z_near;
-  float z_far;
+  float _aspect;
+  float _fov;
+  float _z_near;
+  float _z_far;
 
   glm::vec3 _origin;
   glm::vec3 _up;
@@ -1,17 +1,19 @@
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 
 GLE_NAMESPACE_BEGIN
 
 inline Camera::Camera(glm::vec3 origin, glm::vec3 up, glm::vec3 direction,
                       float aspect, float fov, float z_near, float z_far)
-    : aspect(aspect), fov(fov), z_near(z_near), z_far(z_far), _origin(origin),
-      _up(up), _direction(glm::normalize(direction)) {
+    : _aspect(aspect), _fov(fov), _z_near(z_near), _z_far(z_far),
+      _origin(origin), _up(up), _direction(glm::normalize(direction)) {
   update_view_projection();
 }
 
 inline void Camera::update_view_projection() {
   _view_matrix = glm::lookAt(_origin, _origin + _direction, _up);
-  _projection_matrix = glm::perspective(fov, aspect, z_near, z_far);
+  _projection_matrix = glm::perspective(_fov, _aspect, _z_near, _z_far);
+  _frustum = Frustum::from_matrix(_projection_matrix * _view_matrix);
 }
 
 inline const glm::mat4 &Camera::view_matrix() const { return _view_matrix; }
@@ -19,6 +21,37 @@ inline const glm::mat4 &Camera::projection_matrix() const {
   return _projection_matrix;
 }
 
+inline const Frustum &Camera::frustum() const { return _frustum; }
+
+inline std::array<glm::vec3, 8> Camera::frustum_corners(float near,
+                                                        float far) const {
+  auto inverse_view = glm::inverse(_view_matrix);
+  auto tan_half_fov = std::tan(_fov * 0.5f);
+
+  auto corners = std::array<glm::vec3, 8>();
+  auto i = 0;
+  for (auto depth : {near, far}) {
+    auto half_height = tan_half_fov * depth;
+    auto half_width = half_height * _aspect;
+    for (auto corner : {glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1),
+                        glm::vec2(-1, 1)}) {
+      auto view_corner = glm::vec4(corner.x * half_width,
+                                   corner.y * half_height, -depth, 1.0f);
+      corners[i++] = glm::vec3(inverse_view * view_corner);
+    }
+  }
+  return corners;
+}
+
+inline Ray Camera::ray(const glm::vec2 &ndc) const {
+  auto inverse = glm::inverse(_projection_matrix * _view_matrix);
+  auto near_point = inverse * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+  auto far_point = inverse * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+  auto origin = glm::vec3(near_point) / near_point.w;
+  auto target = glm::vec3(far_point) / far_point.w;
+  return Ray{origin, glm::normalize(target - origin)};
+}
+
 inline const glm::vec3 &Camera::origin() const { return _origin; };
 
 inline const glm::vec3 &Camera::direction() const { return _direction; }
@@ -33,4 +66,9 @@ inline void Camera::direction(const glm::vec3 &direction) {
   update_view_projection();
 }
 
+inline float Camera::aspect() const { return _aspect; }
+inline float Camera::fov() const { return _fov; }
+inline float Camera::z_near() const { return _z_near; }
+inline float Camera::z_far() const { return _z_far; }
+
 GLE_NAMESPACE_END
\ No newline at end of file
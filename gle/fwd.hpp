@@ -12,6 +12,7 @@ class Shader;
 struct Material;
 class Object;
 class Mesh;
+class GeometryArena;
 class MVPShaderOptions;
 class Camera;
 
@@ -0,0 +1,202 @@
+#ifndef GLE_GEOMETRY_ARENA_HPP
+#define GLE_GEOMETRY_ARENA_HPP
+
+#include <array>
+#include <cstddef>
+#include <gle/common.hpp>
+#include <gle/gl.hpp>
+#include <gle/mesh.hpp>
+#include <gle/vao.hpp>
+#include <gle/vbo.hpp>
+#include <glm/glm.hpp>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+/// @brief A first fit allocator of ranges of [0, capacity)
+///
+/// Freed ranges are merged with the free ranges around them.
+class RangeAllocator {
+public:
+  RangeAllocator(RangeAllocator &) = delete;
+  RangeAllocator(RangeAllocator &&) = delete;
+  RangeAllocator(const RangeAllocator &) = delete;
+  RangeAllocator(const RangeAllocator &&) = delete;
+
+  /// @brief Construct an allocator with everything free
+  ///
+  /// @param capacity
+  inline explicit RangeAllocator(std::size_t capacity = 0);
+
+  /// @brief Allocate size contiguous elements
+  ///
+  /// @param size
+  /// @return the first element, or nothing if no free range is large enough
+  inline std::optional<std::size_t> allocate(std::size_t size);
+
+  /// @brief Free a range returned by allocate
+  ///
+  /// @param offset
+  /// @param size
+  inline void free(std::size_t offset, std::size_t size);
+
+  /// @brief Add free elements at the end
+  ///
+  /// @param capacity the new capacity, larger than the current one
+  inline void grow(std::size_t capacity);
+
+  /// @brief Get the number of elements
+  ///
+  /// @return std::size_t
+  inline std::size_t capacity() const;
+
+  /// @brief Get the number of allocated elements
+  ///
+  /// @return std::size_t
+  inline std::size_t used() const;
+
+private:
+  // The size of every free range, by first element
+  std::map<std::size_t, std::size_t> free_ranges;
+  std::size_t _capacity;
+  std::size_t _used;
+};
+} // namespace __internal__
+
+/// @brief The layout of a glMultiDrawElementsIndirect command
+///
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20);
+
+/// @brief Shared vertex and element buffers holding many meshes, so objects
+///        of different meshes are drawn by a single glMultiDrawElementsIndirect
+///        call
+///
+/// Meshes are suballocated in one Vertex buffer and one element buffer,
+/// which grow when they are full. Each command of a frame draws instances of
+/// a mesh whose model matrices start at its base instance in a per-frame
+/// instance buffer, so the shaders read the same attributes as with the mesh
+/// buffers. Meshes keep their own buffers for the depth only passes.
+///
+/// Multi draw indirect needs OpenGL 4.3, see supported().
+class GeometryArena {
+public:
+  GeometryArena(GeometryArena &) = delete;
+  GeometryArena(GeometryArena &&) = delete;
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena(const GeometryArena &&) = delete;
+
+  /// @brief Construct an empty arena
+  ///
+  /// @param vertex_capacity the initial number of vertices
+  /// @param element_capacity the initial number of elements
+  inline explicit GeometryArena(std::size_t vertex_capacity = 1 << 16,
+                                std::size_t element_capacity = 1 << 18);
+
+  /// @brief Check if the current GL context has glMultiDrawElementsIndirect
+  ///
+  /// @return false if glad was generated without OpenGL 4.3 or the context
+  ///         is older
+  inline static bool supported();
+
+  /// @brief Gen the buffers and record the attribute layout
+  ///
+  /// Must be called after GL is initialized
+  inline void init();
+
+  /// @brief Copy a mesh and all its levels of detail to the arena
+  ///
+  /// @param mesh
+  /// @return false if the mesh vertex format is not FLOAT_VERTEX_FORMAT
+  inline bool add(const Mesh &mesh);
+
+  /// @brief Free the ranges of a mesh
+  ///
+  /// @param mesh
+  inline void remove(const Mesh &mesh);
+
+  /// @brief Check if a mesh was added
+  ///
+  /// @param mesh
+  /// @return bool
+  inline bool contains(const Mesh &mesh) const;
+
+  /// @brief Get the command drawing instances of a level of detail of a mesh
+  ///
+  /// @param mesh a mesh in the arena
+  /// @param lod
+  /// @param instance_count
+  /// @param base_instance the index of the first model matrix of upload()
+  /// @return DrawElementsIndirectCommand
+  inline DrawElementsIndirectCommand command(const Mesh &mesh, std::size_t lod,
+                                             GLuint instance_count,
+                                             GLuint base_instance) const;
+
+  /// @brief Upload the model matrices and the commands of a frame
+  ///
+  /// @param models
+  /// @param commands
+  inline void upload(const std::vector<glm::mat4> &models,
+                     const std::vector<DrawElementsIndirectCommand> &commands);
+
+  /// @brief Bind the arena VAO and the indirect command buffer
+  ///
+  inline void bind() const;
+
+  /// @brief Draw uploaded commands with a single glMultiDrawElementsIndirect
+  ///        call, bind() must have been called before
+  ///
+  /// @param first the first command
+  /// @param count the number of commands
+  inline void draw(std::size_t first, std::size_t count) const;
+
+  /// @brief Get the number of vertices of the added meshes
+  ///
+  /// @return std::size_t
+  inline std::size_t num_vertices() const;
+
+  /// @brief Get the number of elements of the added meshes
+  ///
+  /// @return std::size_t
+  inline std::size_t num_elements() const;
+
+private:
+  struct Entry {
+    std::size_t first_vertex;
+    std::size_t num_vertices;
+    std::size_t first_element;
+    std::size_t num_elements;
+    // The element range of each level of detail, relative to first_element
+    std::array<GLuint, Mesh::MAX_LODS> lod_first;
+    std::array<GLuint, Mesh::MAX_LODS> lod_count;
+  };
+
+  template <class T>
+  inline std::size_t allocate(__internal__::RangeAllocator &allocator,
+                              VBO<T> &vbo, std::size_t count);
+  inline void record_attributes();
+
+  std::unordered_map<const Mesh *, Entry> entries;
+  __internal__::RangeAllocator vertex_allocator;
+  __internal__::RangeAllocator element_allocator;
+  VBO<Vertex> vertices_vbo;
+  VBO<GLuint> elements_vbo;
+  VBO<glm::mat4> instances_vbo;
+  VBO<DrawElementsIndirectCommand> commands_vbo;
+  VAO vao;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_GEOMETRY_ARENA_HPP
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <iterator>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline RangeAllocator::RangeAllocator(std::size_t capacity)
+    : _capacity(0), _used(0) {
+  grow(capacity);
+}
+
+inline std::optional<std::size_t> RangeAllocator::allocate(std::size_t size) {
+  for (auto it = free_ranges.begin(); it != free_ranges.end(); it++) {
+    if (it->second < size) continue;
+    auto offset = it->first;
+    auto left = it->second - size;
+    free_ranges.erase(it);
+    if (left > 0) free_ranges.emplace(offset + size, left);
+    _used += size;
+    return offset;
+  }
+  return std::nullopt;
+}
+
+inline void RangeAllocator::free(std::size_t offset, std::size_t size) {
+  if (size == 0) return;
+  _used -= size;
+  auto next = free_ranges.lower_bound(offset);
+  if (next != free_ranges.end() && offset + size == next->first) {
+    size += next->second;
+    next = free_ranges.erase(next);
+  }
+  if (next != free_ranges.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += size;
+      return;
+    }
+  }
+  free_ranges.emplace(offset, size);
+}
+
+inline void RangeAllocator::grow(std::size_t capacity) {
+  if (capacity <= _capacity) return;
+  auto added = capacity - _capacity;
+  auto offset = _capacity;
+  _capacity = capacity;
+  // free() counts the range as used before
+  _used += added;
+  free(offset, added);
+}
+
+inline std::size_t RangeAllocator::capacity() const { return _capacity; }
+
+inline std::size_t RangeAllocator::used() const { return _used; }
+
+} // namespace __internal__
+
+inline GeometryArena::GeometryArena(std::size_t vertex_capacity,
+                                    std::size_t element_capacity)
+    : vertex_allocator(vertex_capacity), element_allocator(element_capacity),
+      vertices_vbo(GL_ARRAY_BUFFER, false),
+      elements_vbo(GL_ELEMENT_ARRAY_BUFFER, false),
+      instances_vbo(GL_ARRAY_BUFFER, true),
+      commands_vbo(GL_DRAW_INDIRECT_BUFFER, true) {}
+
+inline bool GeometryArena::supported() {
+#ifdef GL_VERSION_4_3
+  return GLAD_GL_VERSION_4_3 != 0;
+#else
+  return false;
+#endif
+}
+
+inline void GeometryArena::init() {
+  vao.init();
+  vao.bind();
+  vertices_vbo.init();
+  elements_vbo.init();
+  instances_vbo.init();
+  commands_vbo.init();
+  vertices_vbo.reserve(vertex_allocator.capacity());
+  elements_vbo.reserve(element_allocator.capacity());
+  record_attributes();
+}
+
+inline void GeometryArena::record_attributes() {
+  vao.attr<glm::vec3>(0, vertices_vbo, offsetof(Vertex, position));
+  vao.attr<glm::vec3>(1, vertices_vbo, offsetof(Vertex, normal));
+  vao.attr<glm::vec4>(2, vertices_vbo, offsetof(Vertex, tangent));
+  vao.attr<glm::vec2>(3, vertices_vbo, offsetof(Vertex, uv));
+  for (GLuint column = 0; column < 4; column++) {
+    vao.attr<glm::vec4>(4 + column, instances_vbo, sizeof(glm::vec4) * column);
+    vao.divisor(4 + column, 1);
+  }
+  vao.elements(elements_vbo);
+  VAO::unbind();
+}
+
+template <class T>
+inline std::size_t
+GeometryArena::allocate(__internal__::RangeAllocator &allocator, VBO<T> &vbo,
+                        std::size_t count) {
+  auto offset = allocator.allocate(count);
+  if (offset) return *offset;
+
+  // Double the buffer, the VAO must be attributed to the new one
+  auto capacity = std::max(allocator.capacity() * 2,
+                           allocator.capacity() + count);
+  vbo.resize(allocator.capacity(), capacity);
+  allocator.grow(capacity);
+  vao.bind();
+  record_attributes();
+  return *allocator.allocate(count);
+}
+
+inline bool GeometryArena::add(const Mesh &mesh) {
+  if (mesh.vertex_format() != FLOAT_VERTEX_FORMAT) return false;
+  if (contains(mesh)) return true;
+
+  auto vertices = mesh.interleaved_vertices();
+  auto entry = Entry();
+  entry.num_vertices = vertices.size();
+  entry.num_elements = 0;
+  for (std::size_t lod = 0; lod < mesh.num_lods(); lod++) {
+    entry.lod_first[lod] = entry.num_elements;
+    entry.lod_count[lod] = mesh.num_elements(lod);
+    entry.num_elements += mesh.num_elements(lod);
+  }
+  entry.first_vertex =
+      allocate(vertex_allocator, vertices_vbo, entry.num_vertices);
+  entry.first_element =
+      allocate(element_allocator, elements_vbo, entry.num_elements);
+
+  // The element buffer binding is VAO state, only change the arena one
+  vao.bind();
+  vertices_vbo.write_at(entry.first_vertex, vertices.data(), vertices.size());
+  auto write_triangles = [&](const std::vector<glm::uvec3> &triangles,
+                             std::size_t first) {
+    elements_vbo.write_at(entry.first_element + first,
+                          (const GLuint *)triangles.data(),
+                          triangles.size() * 3);
+  };
+  write_triangles(mesh.triangles(), 0);
+  for (std::size_t lod = 1; lod < mesh.num_lods(); lod++) {
+    write_triangles(mesh.lods()[lod - 1].triangles, entry.lod_first[lod]);
+  }
+  VAO::unbind();
+
+  entries.emplace(&mesh, entry);
+  return true;
+}
+
+inline void GeometryArena::remove(const Mesh &mesh) {
+  auto it = entries.find(&mesh);
+  if (it == entries.end()) return;
+  vertex_allocator.free(it->second.first_vertex, it->second.num_vertices);
+  element_allocator.free(it->second.first_element, it->second.num_elements);
+  entries.erase(it);
+}
+
+inline bool GeometryArena::contains(const Mesh &mesh) const {
+  return entries.count(&mesh) > 0;
+}
+
+inline DrawElementsIndirectCommand
+GeometryArena::command(const Mesh &mesh, std::size_t lod,
+                       GLuint instance_count, GLuint base_instance) const {
+  const auto &entry = entries.at(&mesh);
+  return DrawElementsIndirectCommand{
+      entry.lod_count[lod], instance_count,
+      (GLuint)entry.first_element + entry.lod_first[lod],
+      (GLint)entry.first_vertex, base_instance};
+}
+
+inline void GeometryArena::upload(
+    const std::vector<glm::mat4> &models,
+    const std::vector<DrawElementsIndirectCommand> &commands) {
+  instances_vbo.write(models);
+  commands_vbo.write(commands);
+}
+
+inline void GeometryArena::bind() const {
+  vao.bind();
+  commands_vbo.bind();
+}
+
+inline void GeometryArena::draw(std::size_t first, std::size_t count) const {
+#ifdef GL_VERSION_4_3
+  glMultiDrawElementsIndirect(
+      GL_TRIANGLES, GL_UNSIGNED_INT,
+      (const void *)(first * sizeof(DrawElementsIndirectCommand)),
+      (GLsizei)count, 0);
+#endif
+}
+
+inline std::size_t GeometryArena::num_vertices() const {
+  return vertex_allocator.used();
+}
+
+inline std::size_t GeometryArena::num_elements() const {
+  return element_allocator.used();
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("__internal__::RangeAllocator reuses and merges freed ranges") {
+  auto allocator = gle::__internal__::RangeAllocator(100);
+  auto a = allocator.allocate(40);
+  auto b = allocator.allocate(40);
+  REQUIRE(a);
+  REQUIRE(b);
+  CHECK(*a == 0);
+  CHECK(*b == 40);
+  CHECK_FALSE(allocator.allocate(30));
+
+  // Freeing a then b leaves a single range of 80 before the last 20
+  allocator.free(*a, 40);
+  allocator.free(*b, 40);
+  CHECK(allocator.used() == 0);
+  auto c = allocator.allocate(100);
+  REQUIRE(c);
+  CHECK(*c == 0);
+
+  allocator.grow(150);
+  auto d = allocator.allocate(50);
+  REQUIRE(d);
+  CHECK(*d == 100);
+  CHECK(allocator.used() == 150);
+}
+
+#endif
@@ -6,41 +6,79 @@
 #include <gle/fwd.hpp>
 #include <gle/logging.hpp>
 
+#include <gle/bounds.hpp>
+#include <gle/buffer_texture.hpp>
+#include <gle/bvh.hpp>
 #include <gle/camera.hpp>
+#include <gle/geometry_arena.hpp>
 #include <gle/gl.hpp>
 #include <gle/light.hpp>
+#include <gle/light_clusters.hpp>
+#include <gle/mapped_file.hpp>
 #include <gle/mesh.hpp>
+#include <gle/mesh_optimizer.hpp>
+#include <gle/mesh_simplifier.hpp>
+#include <gle/meshlet.hpp>
+#include <gle/meshs/mesh_file.hpp>
 #include <gle/meshs/obj.hpp>
 #include <gle/meshs/primitives.hpp>
 #include <gle/object.hpp>
+#include <gle/occlusion.hpp>
+#include <gle/occlusion_rasterizer.hpp>
+#include <gle/parallel.hpp>
+#include <gle/passes/depth_pre_pass.hpp>
+#include <gle/passes/hiz_occlusion_pass.hpp>
 #include <gle/passes/object_render_pass.hpp>
+#include <gle/passes/point_shadow_render_pass.hpp>
 #include <gle/passes/shadow_render_pass.hpp>
+#include <gle/passes/software_occlusion_pass.hpp>
 #include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
 #include <gle/scene.hpp>
 #include <gle/shader.hpp>
 #include <gle/shaders/debug_shader.hpp>
 #include <gle/shaders/solid_color_shader.hpp>
 #include <gle/shaders/standard_shader.hpp>
 #include <gle/texture.hpp>
+#include <gle/ubo.hpp>
 #include <gle/vao.hpp>
 #include <gle/vbo.hpp>
 #include <gle/window.hpp>
 
+#include <gle/bounds.inl>
+#include <gle/buffer_texture.inl>
+#include <gle/bvh.inl>
 #include <gle/camera.inl>
+#include <gle/geometry_arena.inl>
 #include <gle/light.inl>
+#include <gle/light_clusters.inl>
+#include <gle/mapped_file.inl>
 #include <gle/mesh.inl>
+#include <gle/mesh_optimizer.inl>
+#include <gle/mesh_simplifier.inl>
+#include <gle/meshlet.inl>
+#include <gle/meshs/mesh_file.inl>
 #include <gle/meshs/obj.inl>
 #include <gle/meshs/primitives.inl>
 #include <gle/object.inl>
+#include <gle/occlusion.inl>
+#include <gle/occlusion_rasterizer.inl>
+#include <gle/parallel.inl>
+#include <gle/passes/depth_pre_pass.inl>
+#include <gle/passes/hiz_occlusion_pass.inl>
 #include <gle/passes/object_render_pass.inl>
+#include <gle/passes/point_shadow_render_pass.inl>
 #include <gle/passes/shadow_render_pass.inl>
+#include <gle/passes/software_occlusion_pass.inl>
 #include <gle/render_pass.inl>
+#include <gle/render_queue.inl>
 #include <gle/scene.inl>
 #include <gle/shader.inl>
 #include <gle/shaders/debug_shader.inl>
 #include <gle/shaders/solid_color_shader.inl>
 #include <gle/shaders/standard_shader.inl>
 #include <gle/texture.inl>
+#include <gle/ubo.inl>
 #include <gle/vao.inl>
 #include <gle/vbo.inl>
 #include <gle/window.inl>
@@ -7,6 +7,11 @@
 
 GLE_NAMESPACE_BEGIN
 
+/// @brief The attenuation below which a point light is considered to have no
+///        effect. Used to give point lights a finite radius for clustering
+///
+constexpr float LIGHT_ATTENUATION_CUTOFF = 1.0f / 256.0f;
+
 enum LightType : std::uint32_t { POINT_LIGHT = 0, DIRECTIONAL_LIGHT = 1 };
 
 struct Light {
@@ -21,6 +26,14 @@ struct Light {
   inline Light(LightType type, const glm::vec3 &position,
                const glm::vec3 &direction, const glm::vec3 &color,
                float strength);
+
+  /// @brief Get the distance past which the light has no effect
+  ///
+  /// Point light attenuation falls off as 1 / (1 + d^2), the radius is where it
+  /// drops below LIGHT_ATTENUATION_CUTOFF. Directional lights have an infinite
+  /// radius
+  /// @return float
+  inline float radius() const;
 };
 
 GLE_NAMESPACE_END
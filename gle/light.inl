@@ -1,3 +1,5 @@
+#include <cmath>
+#include <limits>
 
 GLE_NAMESPACE_BEGIN
 
@@ -7,4 +9,11 @@ inline Light::Light(LightType type, const glm::vec3 &position,
     : type(type), position(position), direction(direction),
       attn(color * strength) {}
 
+inline float Light::radius() const {
+  if (type == DIRECTIONAL_LIGHT) return std::numeric_limits<float>::infinity();
+  auto max_attn = glm::max(attn.x, glm::max(attn.y, attn.z));
+  if (max_attn <= LIGHT_ATTENUATION_CUTOFF) return 0;
+  return std::sqrt(max_attn / LIGHT_ATTENUATION_CUTOFF - 1.0f);
+}
+
 GLE_NAMESPACE_END
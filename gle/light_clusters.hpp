@@ -0,0 +1,110 @@
+#ifndef GLE_LIGHT_CLUSTERS_HPP
+#define GLE_LIGHT_CLUSTERS_HPP
+
+#include <cstdint>
+#include <gle/camera.hpp>
+#include <gle/common.hpp>
+#include <gle/light.hpp>
+#include <gle/parallel.hpp>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Light cluster options
+///
+struct LightClusterOptions {
+  /// @brief Number of clusters along the screen x and y axes and the view depth
+  ///        Default: 16x9x24
+  ///
+  glm::uvec3 grid = glm::uvec3(16, 9, 24);
+
+  /// @brief Number of threads used to assign lights to clusters. Default: 1
+  ///
+  unsigned num_threads = 1;
+};
+
+/// @brief Assigns lights to clusters of the camera frustum for clustered
+///        forward shading
+///
+/// The view frustum is split into a grid of clusters, tiled evenly in screen
+/// space and exponentially along the view depth. Every frame each cluster gets
+/// the list of lights whose radius of influence touches it, so fragments only
+/// loop over the lights of their own cluster. Directional lights touch every
+/// cluster.
+class LightClusters {
+public:
+  LightClusters(LightClusters &) = delete;
+  LightClusters(LightClusters &&) = delete;
+  LightClusters(const LightClusters &) = delete;
+  LightClusters(const LightClusters &&) = delete;
+
+  /// @brief Construct new light clusters
+  ///
+  /// @param options
+  inline LightClusters(const LightClusterOptions &options = {});
+
+  /// @brief Assign the lights to the clusters of the camera frustum
+  ///
+  /// @param camera
+  /// @param lights
+  inline void assign(const Camera &camera,
+                     const std::vector<std::unique_ptr<Light>> &lights);
+
+  /// @brief Get the (offset, count) range into indices() of each cluster
+  ///
+  /// Clusters are ordered by x, then y, then depth slice
+  /// @return const std::vector<glm::uvec2>&
+  inline const std::vector<glm::uvec2> &ranges() const;
+
+  /// @brief Get the light indices of all clusters
+  ///
+  /// @return const std::vector<std::uint32_t>&
+  inline const std::vector<std::uint32_t> &indices() const;
+
+  /// @brief Get the cluster options
+  ///
+  /// @return LightClusterOptions&
+  inline LightClusterOptions &options();
+
+  /// @brief Get the cluster options
+  ///
+  /// @return const LightClusterOptions&
+  inline const LightClusterOptions &options() const;
+
+  /// @brief Get the index of a cluster in ranges()
+  ///
+  /// @param cluster the x, y and depth slice of the cluster
+  /// @return std::size_t
+  inline std::size_t cluster_index(const glm::uvec3 &cluster) const;
+
+  /// @brief Get the depth slice containing the given view depth
+  ///
+  /// @param camera
+  /// @param depth the distance along the view direction
+  /// @return std::uint32_t
+  inline std::uint32_t depth_slice(const Camera &camera, float depth) const;
+
+private:
+  struct ViewLight {
+    std::uint32_t index;
+    glm::vec3 center;
+    float radius;
+  };
+
+  inline void assign_slices(const Camera &camera, std::uint32_t first_slice,
+                            std::uint32_t last_slice);
+
+  LightClusterOptions _options;
+  std::vector<float> slice_depths;
+  std::vector<ViewLight> view_lights;
+  std::vector<std::uint32_t> global_lights;
+  std::vector<std::vector<std::uint32_t>> cluster_lights;
+  std::vector<glm::uvec2> _ranges;
+  std::vector<std::uint32_t> _indices;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_LIGHT_CLUSTERS_HPP
@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <cmath>
+
+GLE_NAMESPACE_BEGIN
+
+inline LightClusters::LightClusters(const LightClusterOptions &options)
+    : _options(options) {}
+
+inline void
+LightClusters::assign(const Camera &camera,
+                      const std::vector<std::unique_ptr<Light>> &lights) {
+  const auto &grid = _options.grid;
+  auto num_clusters = grid.x * grid.y * grid.z;
+
+  cluster_lights.resize(num_clusters);
+  for (auto &cluster : cluster_lights) {
+    cluster.clear();
+  }
+
+  slice_depths.resize(grid.z + 1);
+  for (std::uint32_t z = 0; z <= grid.z; z++) {
+    slice_depths[z] =
+        camera.z_near() *
+        std::pow(camera.z_far() / camera.z_near(), (float)z / (float)grid.z);
+  }
+
+  view_lights.clear();
+  global_lights.clear();
+  for (std::uint32_t i = 0; i < lights.size(); i++) {
+    const auto &light = *lights[i];
+    if (light.type == DIRECTIONAL_LIGHT) {
+      global_lights.push_back(i);
+      continue;
+    }
+    auto radius = light.radius();
+    auto center =
+        glm::vec3(camera.view_matrix() * glm::vec4(light.position, 1.0f));
+    auto depth = -center.z;
+    if (radius <= 0 || depth + radius < camera.z_near() ||
+        depth - radius > camera.z_far())
+      continue;
+    view_lights.push_back(ViewLight{i, center, radius});
+  }
+
+  // Threads work on disjoint depth slices, so they never write to the same
+  // cluster
+  __internal__::parallel_for(grid.z, _options.num_threads,
+                             [&](std::size_t first, std::size_t last) {
+                               assign_slices(camera, (std::uint32_t)first,
+                                             (std::uint32_t)last);
+                             });
+
+  _ranges.resize(num_clusters);
+  _indices.clear();
+  for (std::size_t i = 0; i < num_clusters; i++) {
+    std::uint32_t offset = _indices.size();
+    _indices.insert(_indices.end(), global_lights.begin(), global_lights.end());
+    _indices.insert(_indices.end(), cluster_lights[i].begin(),
+                    cluster_lights[i].end());
+    _ranges[i] = glm::uvec2(offset, _indices.size() - offset);
+  }
+}
+
+inline void LightClusters::assign_slices(const Camera &camera,
+                                         std::uint32_t first_slice,
+                                         std::uint32_t last_slice) {
+  const auto &grid = _options.grid;
+  const auto &projection = camera.projection_matrix();
+  auto scale = glm::vec2(projection[0][0], projection[1][1]);
+  auto tile_size = glm::vec2(2.0f) / glm::vec2(grid.x, grid.y);
+
+  for (const auto &light : view_lights) {
+    auto depth = -light.center.z;
+    auto min_depth = std::max(depth - light.radius, camera.z_near());
+    auto max_depth = std::min(depth + light.radius, camera.z_far());
+    auto first = std::max(depth_slice(camera, min_depth), first_slice);
+    auto last = std::min(depth_slice(camera, max_depth) + 1, last_slice);
+    if (first >= last) continue;
+
+    // The extremes of the projected view space box around the light are at
+    // its corners
+    auto ndc_min = glm::vec2(std::numeric_limits<float>::max());
+    auto ndc_max = glm::vec2(std::numeric_limits<float>::lowest());
+    for (auto d : {min_depth, max_depth}) {
+      for (auto dx : {-light.radius, light.radius}) {
+        for (auto dy : {-light.radius, light.radius}) {
+          auto ndc =
+              scale * glm::vec2(light.center.x + dx, light.center.y + dy) / d;
+          ndc_min = glm::min(ndc_min, ndc);
+          ndc_max = glm::max(ndc_max, ndc);
+        }
+      }
+    }
+    if (ndc_max.x < -1 || ndc_max.y < -1 || ndc_min.x > 1 || ndc_min.y > 1)
+      continue;
+
+    auto tile_min = glm::uvec2(glm::clamp(
+        glm::floor((ndc_min + 1.0f) / tile_size), glm::vec2(0),
+        glm::vec2(grid.x - 1, grid.y - 1)));
+    auto tile_max = glm::uvec2(glm::clamp(
+        glm::floor((ndc_max + 1.0f) / tile_size), glm::vec2(0),
+        glm::vec2(grid.x - 1, grid.y - 1)));
+
+    for (auto z = first; z < last; z++) {
+      auto slice_near = slice_depths[z];
+      auto slice_far = slice_depths[z + 1];
+      for (auto y = tile_min.y; y <= tile_max.y; y++) {
+        for (auto x = tile_min.x; x <= tile_max.x; x++) {
+          auto tile_lo = glm::vec2(x, y) * tile_size - 1.0f;
+          auto tile_hi = tile_lo + tile_size;
+          // View space box of the cluster
+          auto box_min = glm::vec3(
+              glm::min(tile_lo * slice_near, tile_lo * slice_far) / scale,
+              -slice_far);
+          auto box_max = glm::vec3(
+              glm::max(tile_hi * slice_near, tile_hi * slice_far) / scale,
+              -slice_near);
+          auto closest = glm::clamp(light.center, box_min, box_max);
+          auto offset = closest - light.center;
+          if (glm::dot(offset, offset) <= light.radius * light.radius)
+            cluster_lights[cluster_index(glm::uvec3(x, y, z))].push_back(
+                light.index);
+        }
+      }
+    }
+  }
+}
+
+inline const std::vector<glm::uvec2> &LightClusters::ranges() const {
+  return _ranges;
+}
+
+inline const std::vector<std::uint32_t> &LightClusters::indices() const {
+  return _indices;
+}
+
+inline LightClusterOptions &LightClusters::options() { return _options; }
+
+inline const LightClusterOptions &LightClusters::options() const {
+  return _options;
+}
+
+inline std::size_t
+LightClusters::cluster_index(const glm::uvec3 &cluster) const {
+  const auto &grid = _options.grid;
+  return cluster.x + grid.x * (cluster.y + grid.y * cluster.z);
+}
+
+inline std::uint32_t LightClusters::depth_slice(const Camera &camera,
+                                                float depth) const {
+  const auto &grid = _options.grid;
+  if (depth <= camera.z_near()) return 0;
+  auto slice = std::floor(std::log(depth / camera.z_near()) /
+                          std::log(camera.z_far() / camera.z_near()) *
+                          (float)grid.z);
+  return std::min((std::uint32_t)slice, grid.z - 1);
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("LightClusters assigns lights to the clusters they touch") {
+  auto camera = gle::Camera(glm::vec3(0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 1.0f, glm::radians(90.0f),
+                            1.0f, 100.0f);
+  auto lights = std::vector<std::unique_ptr<gle::Light>>();
+  // In front of the camera, radius ~= 1
+  lights.push_back(std::make_unique<gle::Light>(
+      gle::POINT_LIGHT, glm::vec3(0, 0, -10), glm::vec3(0), glm::vec3(1),
+      2.0f * gle::LIGHT_ATTENUATION_CUTOFF));
+  // Behind the camera, radius ~= 16
+  lights.push_back(std::make_unique<gle::Light>(
+      gle::POINT_LIGHT, glm::vec3(0, 0, 50), glm::vec3(0), glm::vec3(1), 1.0f));
+  lights.push_back(std::make_unique<gle::Light>(
+      gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(0, -1, 0), glm::vec3(1),
+      1.0f));
+
+  for (unsigned num_threads : {1u, 4u}) {
+    auto options = gle::LightClusterOptions();
+    options.grid = glm::uvec3(4, 4, 8);
+    options.num_threads = num_threads;
+    auto clusters = gle::LightClusters(options);
+    clusters.assign(camera, lights);
+
+    REQUIRE(clusters.ranges().size() == 4 * 4 * 8);
+    auto slice = clusters.depth_slice(camera, 10.0f);
+    std::size_t clusters_with_point_light = 0;
+    for (std::uint32_t z = 0; z < 8; z++) {
+      for (std::uint32_t y = 0; y < 4; y++) {
+        for (std::uint32_t x = 0; x < 4; x++) {
+          auto range =
+              clusters.ranges().at(clusters.cluster_index(glm::uvec3(x, y, z)));
+          // The directional light is always first
+          REQUIRE(range.y >= 1);
+          CHECK(clusters.indices().at(range.x) == 2);
+          for (std::uint32_t i = 1; i < range.y; i++) {
+            auto light = clusters.indices().at(range.x + i);
+            CHECK(light == 0);
+            CHECK((x == 1 || x == 2));
+            CHECK((y == 1 || y == 2));
+            CHECK((z + 1 >= slice && z <= slice + 1));
+            clusters_with_point_light++;
+          }
+        }
+      }
+    }
+    // The light sits on the corner between the four center tiles
+    CHECK(clusters_with_point_light >= 4);
+    auto center = clusters.ranges().at(
+        clusters.cluster_index(glm::uvec3(1, 1, slice)));
+    CHECK(center.y == 2);
+  }
+}
+
+#endif
\ No newline at end of file
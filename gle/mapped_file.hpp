@@ -0,0 +1,47 @@
+#ifndef GLE_MAPPED_FILE_HPP
+#define GLE_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <gle/common.hpp>
+#include <string>
+#include <string_view>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief A read only view of a whole file
+///
+/// The file is memory mapped where mmap is available, so its pages are only
+/// read from disk when they are accessed and are never copied. Other
+/// platforms read the file into memory.
+class MappedFile {
+public:
+  MappedFile(MappedFile &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile(const MappedFile &&) = delete;
+
+  /// @brief Map a file
+  ///
+  /// @param path
+  /// @throws std::runtime_error if the file can't be opened or mapped
+  inline explicit MappedFile(const std::string &path);
+
+  inline ~MappedFile();
+
+  /// @brief Get the contents of the file, valid while the MappedFile lives
+  ///
+  /// @return std::string_view
+  inline std::string_view view() const;
+
+private:
+#if defined(_WIN32)
+  std::string contents;
+#else
+  const char *data = nullptr;
+  std::size_t size = 0;
+#endif
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_MAPPED_FILE_HPP
@@ -0,0 +1,66 @@
+#include <stdexcept>
+
+#if defined(_WIN32)
+#  include <fstream>
+#  include <sstream>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+GLE_NAMESPACE_BEGIN
+
+#if defined(_WIN32)
+
+inline MappedFile::MappedFile(const std::string &path) {
+  std::ifstream stream(path, std::ios_base::in | std::ios_base::binary);
+  if (!stream) throw std::runtime_error("could not open " + path);
+  auto buffer = std::stringstream();
+  buffer << stream.rdbuf();
+  contents = buffer.str();
+}
+
+inline MappedFile::~MappedFile() {}
+
+inline std::string_view MappedFile::view() const { return contents; }
+
+#else
+
+inline MappedFile::MappedFile(const std::string &path) {
+  auto fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("could not open " + path);
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    ::close(fd);
+    throw std::runtime_error("could not stat " + path);
+  }
+
+  size = (std::size_t)info.st_size;
+  // Empty files can't be mapped, they are an empty view
+  if (size > 0) {
+    auto mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("could not map " + path);
+    }
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+    data = (const char *)mapped;
+  }
+  // The mapping stays valid after the file is closed
+  ::close(fd);
+}
+
+inline MappedFile::~MappedFile() {
+  if (data) ::munmap((void *)data, size);
+}
+
+inline std::string_view MappedFile::view() const {
+  return std::string_view(data, size);
+}
+
+#endif
+
+GLE_NAMESPACE_END
@@ -1,18 +1,98 @@
 #ifndef GLE_MESH_HPP
 #define GLE_MESH_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <gle/bounds.hpp>
 #include <gle/common.hpp>
+#include <gle/mesh_optimizer.hpp>
+#include <gle/mesh_simplifier.hpp>
+#include <gle/meshlet.hpp>
+#include <gle/parallel.hpp>
 #include <gle/vao.hpp>
 #include <gle/vbo.hpp>
 #include <glm/glm.hpp>
+#include <memory>
 #include <vector>
 
 GLE_NAMESPACE_BEGIN
 
+namespace __internal__ {
+/// @brief Get the side of the cube the positions of a mesh are quantized in,
+///        the largest extent of its bounds
+///
+/// @param bounds
+/// @return float
+inline float position_quantization_scale(const AABB &bounds);
+
+/// @brief Normalize v, or get 0 if v is 0
+///
+/// @param v
+/// @return glm::vec3
+inline glm::vec3 safe_normalize(const glm::vec3 &v);
+} // namespace __internal__
+
+/// @brief Interleaved vertex layout of the mesh vertex buffer
+///
+/// The bitangent is not stored, the shaders reconstruct it from the normal,
+/// tangent and the handedness sign stored in tangent.w
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec4 tangent;
+  glm::vec2 uv;
+};
+
+static_assert(sizeof(Vertex) == 48);
+
+/// @brief Quantized interleaved vertex layout of the mesh vertex buffer
+///
+/// The position is a 16 bit fraction of the mesh bounds, see
+/// Mesh::position_transform, the normal and tangent are 10 bit signed
+/// normalized values with the handedness in the 2 bit tangent.w, and the uv
+/// is a pair of half floats. The shaders read the same attributes as with
+/// Vertex.
+struct PackedVertex {
+  Normalized<glm::vec<4, std::uint16_t>> position;
+  PackedSnorm1010102 normal;
+  PackedSnorm1010102 tangent;
+  HalfVec<2> uv;
+};
+
+static_assert(sizeof(PackedVertex) == 20);
+
+/// @brief The layout of the mesh vertex buffer
+///
+enum VertexFormat {
+  /// @brief 48 byte Vertex, full precision
+  ///
+  FLOAT_VERTEX_FORMAT,
+  /// @brief 20 byte PackedVertex, positions are quantized to 1 / 65535 of
+  ///        the largest extent of the mesh bounds
+  ///
+  PACKED_VERTEX_FORMAT,
+};
+
+/// @brief A simplified level of detail of a mesh, indexing the vertices of
+///        the full mesh
+///
+struct MeshLod {
+  std::vector<glm::uvec3> triangles;
+
+  /// @brief the largest distance in mesh space between the simplified and
+  ///        the full surface
+  ///
+  float error = 0.0f;
+};
+
 /// @brief A 3d mesh object
 ///
 class Mesh {
 public:
+  /// @brief the largest number of levels of detail, including the full mesh
+  ///
+  static constexpr std::size_t MAX_LODS = 8;
+
   Mesh(Mesh &) = delete;
   Mesh(Mesh &&) = delete;
   Mesh(const Mesh &) = delete;
@@ -35,34 +115,209 @@ public:
   inline Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec2> uvs,
               std::vector<glm::uvec3> triangles);
 
-  /// @brief Calculate surface normals
+  /// @brief Construct a new Mesh object with precomputed normals and
+  ///        tangents
+  ///
+  /// The bitangents are rebuilt from the normals, tangents and the
+  /// handedness sign stored in tangent.w, like the shaders do
+  ///
+  /// @param vertices
+  /// @param normals
+  /// @param tangents
+  /// @param uvs
+  /// @param triangles
+  inline Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec3> normals,
+              const std::vector<glm::vec4> &tangents,
+              std::vector<glm::vec2> uvs, std::vector<glm::uvec3> triangles);
+
+  /// @brief Calculate surface normals, tangents and bitangents
+  ///
+  /// With more than one thread the face vectors are computed in parallel and
+  /// every vertex sums the vectors of its faces, so threads never write to
+  /// the same vertex. This needs extra memory for the face vectors and the
+  /// faces of each vertex.
+  ///
+  /// @param num_threads the number of threads, 1 to run on the calling thread
+  ///        and 0 for std::thread::hardware_concurrency()
+  inline void calculate_normals(unsigned num_threads = 1);
+
+  /// @brief Reorder the triangles and vertices for the GPU
+  ///
+  /// The triangles are reordered for the post-transform vertex cache with
+  /// Tipsify, then clusters of them are reordered to draw the outer surfaces
+  /// first and reduce overdraw. Finally the vertices are laid out in the
+  /// order the triangles first use them, so vertex fetches stay sequential.
+  /// The levels of detail are reordered the same way, the meshlets are
+  /// cleared. Must be called before init_buffers.
+  ///
+  /// @param options
+  /// @return the ACMR before and after
+  inline MeshOptimizeStats optimize(const MeshOptimizeOptions &options = {});
+
+  /// @brief Generate simplified levels of detail of the mesh
+  ///
+  /// Each level is simplified from the previous one with a quadric error
+  /// metric and only adds an index buffer, the vertices are shared. The chain
+  /// stops early once a level can't be simplified further. Must be called
+  /// before init_buffers.
+  ///
+  /// @param ratios the decreasing triangle count of each level relative to
+  ///        the full mesh
+  /// @throws std::out_of_range if there would be more than MAX_LODS levels
+  inline void generate_lods(const std::vector<float> &ratios = {0.5f, 0.25f,
+                                                                0.1f});
+
+  /// @brief Set the layout of the vertex buffer
+  ///
+  /// PACKED_VERTEX_FORMAT shrinks the vertex buffer from 48 to 20 bytes per
+  /// vertex and the depth only position buffer from 12 to 8 bytes, at the
+  /// cost of precision. Must be called before init_buffers.
+  ///
+  /// @param format
+  inline void vertex_format(VertexFormat format);
+
+  /// @brief Get the layout of the vertex buffer
   ///
-  inline void calculate_normals();
+  /// @return VertexFormat
+  inline VertexFormat vertex_format() const;
 
-  /// @brief Initialize the OpenGL vertex buffers and copy the data to them
+  /// @brief Split the full mesh into meshlets that can be culled separately
+  ///
+  /// The triangles are reordered so each meshlet is a contiguous range of
+  /// the element buffer, call it after optimize. The levels of detail are
+  /// not split. Must be called before init_buffers.
+  ///
+  /// @param options
+  inline void build_meshlets(const MeshletOptions &options = {});
+
+  /// @brief Get the meshlets of the full mesh, empty unless build_meshlets
+  ///        was called
+  ///
+  /// @return const std::vector<Meshlet>&
+  inline const std::vector<Meshlet> &meshlets() const;
+
+  /// @brief Initialize the OpenGL vertex buffers, copy the interleaved
+  ///        vertices to them and record the attribute layout in the VAO
   ///
   /// Must be called after GL is initialized
   inline void init_buffers();
 
-  /// @brief Bind the mesh buffers and VAO
+  /// @brief Get the interleaved vertices uploaded to the vertex buffer
   ///
-  inline void bind_buffers() const;
+  /// @return std::vector<Vertex>
+  inline std::vector<Vertex> interleaved_vertices() const;
 
-  inline void draw() const;
+  /// @brief Get the quantized vertices uploaded to the vertex buffer with
+  ///        PACKED_VERTEX_FORMAT
+  ///
+  /// @return std::vector<PackedVertex>
+  inline std::vector<PackedVertex> packed_vertices() const;
 
-  /// @brief Called after drawing the mesh elements to clean up vertexes
+  /// @brief Get the transform from the quantized positions to mesh space
+  ///
+  /// Positions are quantized in the cube of the largest extent of the
+  /// bounds, so the transform is a uniform scale and a translation that
+  /// keeps normals pointing the same way. It is folded into the model
+  /// matrices uploaded by instances(), the shaders need no dequantization.
+  /// Identity with FLOAT_VERTEX_FORMAT.
+  ///
+  /// @return glm::mat4
+  inline glm::mat4 position_transform() const;
+
+  /// @brief Upload the interleaved vertices from memory that outlives the
+  ///        mesh attributes instead of interleaving them in init_buffers
+  ///
+  /// Lets a mapped mesh file be copied to the vertex buffer straight from
+  /// its pages. The source is released once it is uploaded, or when the
+  /// vertex attributes change.
+  ///
+  /// @param vertices one interleaved vertex per mesh vertex
+  inline void interleaved_source(std::shared_ptr<const Vertex> vertices);
+
+  /// @brief Upload the model matrices of the instances drawn by draw()
+  ///
+  /// Each matrix is a per-instance vertex attribute, so all instances are
+  /// drawn with a single glDrawElementsInstanced call. The instance buffer
+  /// holds a single identity matrix until this is called. The matrices are
+  /// multiplied by position_transform() when they are uploaded.
+  ///
+  /// @param models
+  inline void instances(const std::vector<glm::mat4> &models);
+
+  /// @brief Get the number of instances drawn by draw()
+  ///
+  /// @return GLsizei
+  inline GLsizei num_instances() const;
+
+  /// @brief Bind the mesh VAO, which holds the attribute layout and element
+  ///        buffer recorded by init_buffers
   ///
   /// ## Example:
   ///     mesh->bind_buffers();
   ///     glDrawElements(GL_TRIANGLES, mesh->num_elements(),
   ///                    GL_UNSIGNED_INT, (void *)0);
-  ///     mesh->post_draw();
-  inline void post_draw() const;
+  inline void bind_buffers() const;
+
+  /// @brief Draw every instance uploaded with instances()
+  ///
+  /// @param lod the level of detail
+  inline void draw(std::size_t lod = 0) const;
+
+  /// @brief Draw every instance uploaded with instances() without binding the
+  ///        mesh buffers, bind_buffers() must have been called before
+  ///
+  /// @param lod the level of detail
+  inline void draw_instances(std::size_t lod = 0) const;
+
+  /// @brief Draw every instance uploaded with instances() with only the
+  ///        position attribute
+  ///
+  /// Uses a separate VAO reading a tightly packed position buffer, so depth
+  /// only passes fetch 12 bytes per vertex instead of a whole Vertex
+  ///
+  /// @param lod the level of detail
+  inline void draw_depth(std::size_t lod = 0) const;
+
+  /// @brief Draw some meshlets of the first instance with a single
+  ///        glMultiDrawElements call, without binding the mesh buffers
+  ///
+  /// Meshlets that follow each other in the element buffer are drawn as one
+  /// range.
+  ///
+  /// @param visible the indices of the meshlets to draw, in increasing order
+  /// @param count the number of indices
+  /// @return the number of triangles drawn
+  inline std::size_t draw_meshlets(const std::uint32_t *visible,
+                                   std::size_t count) const;
 
   /// @brief Get the number of elements (number of triangles times 3)
   ///
+  /// @param lod the level of detail
   /// @return The number of elements
-  inline GLsizei num_elements() const;
+  inline GLsizei num_elements(std::size_t lod = 0) const;
+
+  /// @brief Get the number of levels of detail, including the full mesh
+  ///
+  /// @return std::size_t
+  inline std::size_t num_lods() const;
+
+  /// @brief Get the simplified levels of detail, level i + 1 is lods()[i]
+  ///
+  /// @return const std::vector<MeshLod>&
+  inline const std::vector<MeshLod> &lods() const;
+
+  /// @brief Set the simplified levels of detail
+  ///
+  /// @param lods
+  /// @throws std::out_of_range if there are more than MAX_LODS levels or a
+  ///         triangle index is out of range
+  inline void lods(std::vector<MeshLod> lods);
+
+  /// @brief Get the coarsest level of detail within an error
+  ///
+  /// @param max_error the largest error allowed, in mesh space
+  /// @return std::size_t
+  inline std::size_t select_lod(float max_error) const;
 
   /// @brief Get the mesh vertices
   ///
@@ -94,6 +349,16 @@ public:
   /// @return const std::vector<glm::uvec3>&
   inline const std::vector<glm::uvec3> &triangles() const;
 
+  /// @brief Get the bounding box of the mesh vertices
+  ///
+  /// @return const AABB&
+  inline const AABB &bounds() const;
+
+  /// @brief Get the bounding sphere of the mesh vertices
+  ///
+  /// @return const BoundingSphere&
+  inline const BoundingSphere &bounding_sphere() const;
+
   /// @brief Set the mesh normals
   ///
   /// @param normals
@@ -105,19 +370,35 @@ public:
   inline void uvs(const std::vector<glm::vec2> &uvs);
 
 private:
+  inline void calculate_normals_serial();
+  inline void calculate_normals_parallel(unsigned num_threads);
+
   std::vector<glm::vec3> _vertices;
   std::vector<glm::vec3> _normals;
   std::vector<glm::vec3> _tangents;
   std::vector<glm::vec3> _bitangents;
   std::vector<glm::vec2> _uvs;
   std::vector<glm::uvec3> _triangles;
-  VBO<glm::vec3> vertices_vbo;
-  VBO<glm::vec3> normals_vbo;
-  VBO<glm::vec3> tangents_vbo;
-  VBO<glm::vec3> bitangents_vbo;
-  VBO<glm::vec2> uvs_vbo;
+  std::vector<MeshLod> _lods;
+  std::vector<Meshlet> _meshlets;
+  // Scratch ranges of draw_meshlets
+  mutable std::vector<GLsizei> range_counts;
+  mutable std::vector<const void *> range_offsets;
+  // The first element of each level in the element buffer
+  std::vector<std::size_t> lod_offsets;
+  AABB _bounds;
+  BoundingSphere _bounding_sphere;
+  std::shared_ptr<const Vertex> _interleaved_source;
+  VertexFormat _vertex_format;
+  VBO<Vertex> vertices_vbo;
+  VBO<PackedVertex> packed_vertices_vbo;
+  VBO<glm::vec3> positions_vbo;
+  VBO<Normalized<glm::vec<4, std::uint16_t>>> packed_positions_vbo;
   VBO<glm::uvec3> triangles_vbo;
+  VBO<glm::mat4> instances_vbo;
+  GLsizei _num_instances;
   VAO vao;
+  VAO depth_vao;
 };
 
 GLE_NAMESPACE_END
@@ -1,112 +1,514 @@
+#include <algorithm>
+#include <glm/gtc/packing.hpp>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
 GLE_NAMESPACE_BEGIN
 
 inline Mesh::Mesh(std::vector<glm::vec3> vertices,
                   std::vector<glm::uvec3> triangles)
-    : _vertices(vertices), _normals(vertices.size()),
-      _tangents(vertices.size()), _bitangents(vertices.size()),
-      _uvs(vertices.size()), _triangles(triangles),
-      vertices_vbo(GL_ARRAY_BUFFER, false), normals_vbo(GL_ARRAY_BUFFER, false),
-      tangents_vbo(GL_ARRAY_BUFFER, false),
-      bitangents_vbo(GL_ARRAY_BUFFER, false), uvs_vbo(GL_ARRAY_BUFFER, false),
-      triangles_vbo(GL_ELEMENT_ARRAY_BUFFER, false) {
+    : _vertices(std::move(vertices)), _normals(_vertices.size()),
+      _tangents(_vertices.size()), _bitangents(_vertices.size()),
+      _uvs(_vertices.size()), _triangles(std::move(triangles)),
+      _bounds(AABB::from_points(_vertices)),
+      _bounding_sphere(BoundingSphere::from_points(_vertices)),
+      _vertex_format(FLOAT_VERTEX_FORMAT),
+      vertices_vbo(GL_ARRAY_BUFFER, false),
+      packed_vertices_vbo(GL_ARRAY_BUFFER, false),
+      positions_vbo(GL_ARRAY_BUFFER, false),
+      packed_positions_vbo(GL_ARRAY_BUFFER, false),
+      triangles_vbo(GL_ELEMENT_ARRAY_BUFFER, false),
+      instances_vbo(GL_ARRAY_BUFFER, true), _num_instances(1) {
   calculate_normals();
 }
 
 inline Mesh::Mesh(std::vector<glm::vec3> vertices, std::vector<glm::vec2> uvs,
                   std::vector<glm::uvec3> triangles)
-    : _vertices(vertices), _normals(vertices.size()),
-      _tangents(vertices.size()), _bitangents(vertices.size()), _uvs(uvs),
-      _triangles(triangles), vertices_vbo(GL_ARRAY_BUFFER, false),
-      normals_vbo(GL_ARRAY_BUFFER, false), tangents_vbo(GL_ARRAY_BUFFER, false),
-      bitangents_vbo(GL_ARRAY_BUFFER, false), uvs_vbo(GL_ARRAY_BUFFER, false),
-      triangles_vbo(GL_ELEMENT_ARRAY_BUFFER, false) {
+    : _vertices(std::move(vertices)), _normals(_vertices.size()),
+      _tangents(_vertices.size()), _bitangents(_vertices.size()),
+      _uvs(std::move(uvs)), _triangles(std::move(triangles)),
+      _bounds(AABB::from_points(_vertices)),
+      _bounding_sphere(BoundingSphere::from_points(_vertices)),
+      _vertex_format(FLOAT_VERTEX_FORMAT),
+      vertices_vbo(GL_ARRAY_BUFFER, false),
+      packed_vertices_vbo(GL_ARRAY_BUFFER, false),
+      positions_vbo(GL_ARRAY_BUFFER, false),
+      packed_positions_vbo(GL_ARRAY_BUFFER, false),
+      triangles_vbo(GL_ELEMENT_ARRAY_BUFFER, false),
+      instances_vbo(GL_ARRAY_BUFFER, true), _num_instances(1) {
   calculate_normals();
 }
 
-inline void Mesh::calculate_normals() {
+inline Mesh::Mesh(std::vector<glm::vec3> vertices,
+                  std::vector<glm::vec3> normals,
+                  const std::vector<glm::vec4> &tangents,
+                  std::vector<glm::vec2> uvs, std::vector<glm::uvec3> triangles)
+    : _vertices(std::move(vertices)), _normals(std::move(normals)),
+      _tangents(_vertices.size()), _bitangents(_vertices.size()),
+      _uvs(std::move(uvs)), _triangles(std::move(triangles)),
+      _bounds(AABB::from_points(_vertices)),
+      _bounding_sphere(BoundingSphere::from_points(_vertices)),
+      _vertex_format(FLOAT_VERTEX_FORMAT),
+      vertices_vbo(GL_ARRAY_BUFFER, false),
+      packed_vertices_vbo(GL_ARRAY_BUFFER, false),
+      positions_vbo(GL_ARRAY_BUFFER, false),
+      packed_positions_vbo(GL_ARRAY_BUFFER, false),
+      triangles_vbo(GL_ELEMENT_ARRAY_BUFFER, false),
+      instances_vbo(GL_ARRAY_BUFFER, true), _num_instances(1) {
+  auto num_vertices = _vertices.size();
+  if (_normals.size() != num_vertices || tangents.size() != num_vertices ||
+      _uvs.size() != num_vertices)
+    throw std::out_of_range("mesh attributes differ in size");
+  for (const auto &triangle : _triangles) {
+    if (triangle.x >= num_vertices || triangle.y >= num_vertices ||
+        triangle.z >= num_vertices)
+      throw std::out_of_range("mesh triangle index out of range");
+  }
+
+  for (std::size_t i = 0; i < num_vertices; i++) {
+    _tangents[i] = glm::vec3(tangents[i]);
+    _bitangents[i] = glm::cross(_normals[i], _tangents[i]) * tangents[i].w;
+  }
+}
+
+namespace __internal__ {
+
+inline float position_quantization_scale(const AABB &bounds) {
+  auto extent = bounds.max - bounds.min;
+  auto scale = std::max({extent.x, extent.y, extent.z});
+  return scale > 0.0f ? scale : 1.0f;
+}
+
+inline glm::vec3 safe_normalize(const glm::vec3 &v) {
+  auto length = glm::length(v);
+  return length > 0.0f ? v / length : glm::vec3(0);
+}
+
+// Per face vectors as separate x, y and z arrays so the cross products are
+// computed on contiguous floats and vectorize
+struct FaceVectors {
+  std::vector<float> x, y, z;
+
+  inline void resize(std::size_t size) {
+    x.resize(size);
+    y.resize(size);
+    z.resize(size);
+  }
+
+  inline glm::vec3 operator[](std::size_t i) const {
+    return glm::vec3(x[i], y[i], z[i]);
+  }
+};
+
+} // namespace __internal__
+
+inline void Mesh::calculate_normals(unsigned num_threads) {
+  // A mapped vertex stream has the old normals and tangents
+  _interleaved_source.reset();
   if (_normals.size() != _vertices.size()) {
     GLE_LOG(GLE_INFO, "Realloc mesh normals array");
     _normals = std::vector<glm::vec3>(_vertices.size());
   }
+  _tangents.assign(_vertices.size(), glm::vec3(0));
+  _bitangents.assign(_vertices.size(), glm::vec3(0));
+
+  auto num_vertices = _vertices.size();
+  for (const auto &triangle : _triangles) {
+    if (triangle.x >= num_vertices || triangle.y >= num_vertices ||
+        triangle.z >= num_vertices)
+      throw std::out_of_range("mesh triangle index out of range");
+  }
+  if (_uvs.size() < num_vertices)
+    throw std::out_of_range("mesh has fewer uvs than vertices");
+
+  if (num_threads == 0) num_threads = std::thread::hardware_concurrency();
+  if (num_threads <= 1) {
+    calculate_normals_serial();
+  } else {
+    calculate_normals_parallel(num_threads);
+  }
+}
 
+inline void Mesh::calculate_normals_serial() {
   for (auto &normal : _normals) {
     normal = glm::vec3(0);
   }
 
-  for (auto &triangle : _triangles) {
+  for (const auto &triangle : _triangles) {
+    const auto &p0 = _vertices[triangle.x];
+    const auto &p1 = _vertices[triangle.y];
+    const auto &p2 = _vertices[triangle.z];
     // xz X xy
-    auto norm = glm::cross(_vertices.at(triangle.x) - _vertices.at(triangle.y),
-                           _vertices.at(triangle.x) - _vertices.at(triangle.z));
-    _normals.at(triangle.x) += norm;
-    _normals.at(triangle.y) += norm;
-    _normals.at(triangle.z) += norm;
+    auto norm = glm::cross(p0 - p1, p0 - p2);
+    _normals[triangle.x] += norm;
+    _normals[triangle.y] += norm;
+    _normals[triangle.z] += norm;
+
+    auto uv_1 = _uvs[triangle.y] - _uvs[triangle.x];
+    auto uv_2 = _uvs[triangle.z] - _uvs[triangle.x];
+    auto e_1 = p1 - p0;
+    auto e_2 = p2 - p0;
+    auto det = uv_1.x * uv_2.y - uv_1.y * uv_2.x;
+    // Faces without uv area have no tangent space
+    auto r = det != 0.0f ? 1.0f / det : 0.0f;
+    auto t = (e_1 * uv_2.y - e_2 * uv_1.y) * r;
+    auto b = (e_2 * uv_1.x - e_1 * uv_2.x) * r;
+    _tangents[triangle.x] += t;
+    _tangents[triangle.y] += t;
+    _tangents[triangle.z] += t;
+    _bitangents[triangle.x] += b;
+    _bitangents[triangle.y] += b;
+    _bitangents[triangle.z] += b;
   }
 
   for (auto &normal : _normals) {
     normal = glm::normalize(normal);
   }
+}
+
+inline void Mesh::calculate_normals_parallel(unsigned num_threads) {
+  auto num_faces = _triangles.size();
+  auto num_vertices = _vertices.size();
+
+  // Face normals and tangents, computed independently per face
+  auto normals = __internal__::FaceVectors();
+  auto tangents = __internal__::FaceVectors();
+  auto bitangents = __internal__::FaceVectors();
+  normals.resize(num_faces);
+  tangents.resize(num_faces);
+  bitangents.resize(num_faces);
+  __internal__::parallel_for(
+      num_faces, num_threads, [&](std::size_t first, std::size_t last) {
+        for (auto f = first; f < last; f++) {
+          const auto &triangle = _triangles[f];
+          const auto &p0 = _vertices[triangle.x];
+          const auto &p1 = _vertices[triangle.y];
+          const auto &p2 = _vertices[triangle.z];
+          const auto &t0 = _uvs[triangle.x];
+          const auto &t1 = _uvs[triangle.y];
+          const auto &t2 = _uvs[triangle.z];
+
+          float e1x = p1.x - p0.x, e1y = p1.y - p0.y, e1z = p1.z - p0.z;
+          float e2x = p2.x - p0.x, e2y = p2.y - p0.y, e2z = p2.z - p0.z;
+          // (p0 - p1) x (p0 - p2) == e1 x e2
+          normals.x[f] = e1y * e2z - e1z * e2y;
+          normals.y[f] = e1z * e2x - e1x * e2z;
+          normals.z[f] = e1x * e2y - e1y * e2x;
+
+          float u1 = t1.x - t0.x, v1 = t1.y - t0.y;
+          float u2 = t2.x - t0.x, v2 = t2.y - t0.y;
+          float det = u1 * v2 - v1 * u2;
+          float r = det != 0.0f ? 1.0f / det : 0.0f;
+          tangents.x[f] = (e1x * v2 - e2x * v1) * r;
+          tangents.y[f] = (e1y * v2 - e2y * v1) * r;
+          tangents.z[f] = (e1z * v2 - e2z * v1) * r;
+          bitangents.x[f] = (e2x * u1 - e1x * u2) * r;
+          bitangents.y[f] = (e2y * u1 - e1y * u2) * r;
+          bitangents.z[f] = (e2z * u1 - e1z * u2) * r;
+        }
+      });
+
+  // Faces around each vertex, so every vertex gathers its own sums and the
+  // threads never write to the same vertex
+  auto offsets = std::vector<std::uint32_t>(num_vertices + 1, 0);
+  for (const auto &triangle : _triangles) {
+    offsets[triangle.x + 1]++;
+    offsets[triangle.y + 1]++;
+    offsets[triangle.z + 1]++;
+  }
+  for (std::size_t v = 0; v < num_vertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  auto faces = std::vector<std::uint32_t>(offsets.back());
+  auto cursor = std::vector<std::uint32_t>(offsets.begin(), offsets.end() - 1);
+  for (std::size_t f = 0; f < num_faces; f++) {
+    const auto &triangle = _triangles[f];
+    faces[cursor[triangle.x]++] = f;
+    faces[cursor[triangle.y]++] = f;
+    faces[cursor[triangle.z]++] = f;
+  }
+
+  __internal__::parallel_for(
+      num_vertices, num_threads, [&](std::size_t first, std::size_t last) {
+        for (auto v = first; v < last; v++) {
+          auto normal = glm::vec3(0);
+          auto tangent = glm::vec3(0);
+          auto bitangent = glm::vec3(0);
+          for (auto i = offsets[v]; i < offsets[v + 1]; i++) {
+            normal += normals[faces[i]];
+            tangent += tangents[faces[i]];
+            bitangent += bitangents[faces[i]];
+          }
+          _normals[v] = glm::normalize(normal);
+          _tangents[v] = tangent;
+          _bitangents[v] = bitangent;
+        }
+      });
+}
+
+inline MeshOptimizeStats Mesh::optimize(const MeshOptimizeOptions &options) {
+  auto num_vertices = _vertices.size();
+  for (const auto &triangle : _triangles) {
+    if (triangle.x >= num_vertices || triangle.y >= num_vertices ||
+        triangle.z >= num_vertices)
+      throw std::out_of_range("mesh triangle index out of range");
+  }
+
+  auto stats = MeshOptimizeStats();
+  stats.acmr_before =
+      __internal__::acmr(_triangles, num_vertices, options.cache_size);
+
+  auto reorder = [&](const std::vector<glm::uvec3> &triangles) {
+    auto ordered =
+        __internal__::tipsify(triangles, num_vertices, options.cache_size);
+    return __internal__::order_overdraw_clusters(
+        ordered, _vertices, options.cache_size, options.overdraw_threshold);
+  };
+  auto triangles = reorder(_triangles);
+  auto remap = __internal__::vertex_fetch_remap(triangles, num_vertices);
+  auto apply_remap = [&](std::vector<glm::uvec3> &triangles) {
+    for (auto &triangle : triangles) {
+      triangle = glm::uvec3(remap[triangle.x], remap[triangle.y],
+                            remap[triangle.z]);
+    }
+  };
+  apply_remap(triangles);
+  // The levels of detail share the vertices laid out for the full mesh
+  for (auto &lod : _lods) {
+    lod.triangles = reorder(lod.triangles);
+    apply_remap(lod.triangles);
+  }
+  __internal__::remap_vertices(_vertices, remap);
+  __internal__::remap_vertices(_normals, remap);
+  __internal__::remap_vertices(_tangents, remap);
+  __internal__::remap_vertices(_bitangents, remap);
+  __internal__::remap_vertices(_uvs, remap);
+  _triangles = std::move(triangles);
+  _meshlets.clear();
+  // A mapped vertex stream is in the old order
+  _interleaved_source.reset();
+
+  stats.acmr_after =
+      __internal__::acmr(_triangles, num_vertices, options.cache_size);
+  return stats;
+}
+
+inline void Mesh::generate_lods(const std::vector<float> &ratios) {
+  if (ratios.size() + 1 > MAX_LODS)
+    throw std::out_of_range("too many mesh levels of detail");
+
+  _lods.clear();
+  _lods.reserve(ratios.size());
+  const auto *previous = &_triangles;
+  float error = 0.0f;
+  for (auto ratio : ratios) {
+    auto target = (std::size_t)(ratio * (float)_triangles.size());
+    float step_error = 0.0f;
+    auto triangles =
+        __internal__::simplify(_vertices, *previous, target, step_error);
+    if (triangles.empty() || triangles.size() >= previous->size()) break;
+
+    // Levels are simplified from the previous one, their errors add up
+    error += step_error;
+    _lods.push_back(MeshLod{std::move(triangles), error});
+    previous = &_lods.back().triangles;
+  }
+}
+
+inline void Mesh::build_meshlets(const MeshletOptions &options) {
+  _meshlets = __internal__::build_meshlets(_vertices, _triangles, options);
+}
+
+inline const std::vector<Meshlet> &Mesh::meshlets() const { return _meshlets; }
+
+inline std::vector<Vertex> Mesh::interleaved_vertices() const {
+  auto interleaved = std::vector<Vertex>(_vertices.size());
+  for (std::size_t i = 0; i < _vertices.size(); i++) {
+    auto handedness =
+        glm::dot(glm::cross(_normals[i], _tangents[i]), _bitangents[i]) < 0.0f
+            ? -1.0f
+            : 1.0f;
+    interleaved[i] = Vertex{_vertices[i], _normals[i],
+                            glm::vec4(_tangents[i], handedness), _uvs[i]};
+  }
+  return interleaved;
+}
 
-  for (auto &triangle : _triangles) {
-    float x1 = _uvs.at(triangle.y).x - _uvs.at(triangle.x).x;
-    float x2 = _uvs.at(triangle.z).x - _uvs.at(triangle.x).x;
-    float y1 = _uvs.at(triangle.y).y - _uvs.at(triangle.x).y;
-    float y2 = _uvs.at(triangle.z).y - _uvs.at(triangle.x).y;
-    auto e_1 = _vertices.at(triangle.y) - _vertices.at(triangle.x);
-    auto e_2 = _vertices.at(triangle.z) - _vertices.at(triangle.x);
-    auto r = 1.0f / (x1 * y2 - y1 * x2);
-    auto t = (e_1 * y2 - e_2 * y1) * r;
-    auto b = (e_2 * x1 - e_1 * x2) * r;
-    _tangents.at(triangle.x) += t;
-    _tangents.at(triangle.y) += t;
-    _tangents.at(triangle.z) += t;
-    _bitangents.at(triangle.x) += b;
-    _bitangents.at(triangle.y) += b;
-    _bitangents.at(triangle.z) += b;
+inline std::vector<PackedVertex> Mesh::packed_vertices() const {
+  auto scale = __internal__::position_quantization_scale(_bounds);
+  auto packed = std::vector<PackedVertex>(_vertices.size());
+  for (std::size_t i = 0; i < _vertices.size(); i++) {
+    auto &vertex = packed[i];
+    auto fraction = (_vertices[i] - _bounds.min) / scale;
+    for (int j = 0; j < 3; j++) {
+      vertex.position.value[j] = glm::packUnorm1x16(fraction[j]);
+    }
+    vertex.position.value[3] = 0;
+
+    auto normal = __internal__::safe_normalize(_normals[i]);
+    auto tangent = __internal__::safe_normalize(_tangents[i]);
+    auto handedness =
+        glm::dot(glm::cross(_normals[i], _tangents[i]), _bitangents[i]) < 0.0f
+            ? -1.0f
+            : 1.0f;
+    vertex.normal.bits = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    vertex.tangent.bits =
+        glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+    vertex.uv.bits.x = glm::packHalf1x16(_uvs[i].x);
+    vertex.uv.bits.y = glm::packHalf1x16(_uvs[i].y);
   }
+  return packed;
+}
+
+inline glm::mat4 Mesh::position_transform() const {
+  if (_vertex_format != PACKED_VERTEX_FORMAT) return glm::mat4(1);
+  auto transform =
+      glm::mat4(__internal__::position_quantization_scale(_bounds));
+  transform[3] = glm::vec4(_bounds.min, 1.0f);
+  return transform;
 }
 
+inline void Mesh::vertex_format(VertexFormat format) {
+  _vertex_format = format;
+}
+
+inline VertexFormat Mesh::vertex_format() const { return _vertex_format; }
+
 inline void Mesh::init_buffers() {
+  auto packed = _vertex_format == PACKED_VERTEX_FORMAT;
   vao.init();
   vao.bind();
-  vertices_vbo.init();
-  normals_vbo.init();
-  tangents_vbo.init();
-  bitangents_vbo.init();
-  uvs_vbo.init();
   triangles_vbo.init();
+  instances_vbo.init();
+
+  if (packed) {
+    packed_vertices_vbo.init();
+    packed_positions_vbo.init();
+    auto vertices = packed_vertices();
+    auto positions = std::vector<Normalized<glm::vec<4, std::uint16_t>>>(
+        vertices.size());
+    for (std::size_t i = 0; i < vertices.size(); i++) {
+      positions[i] = vertices[i].position;
+    }
+    packed_vertices_vbo.write(vertices);
+    packed_positions_vbo.write(positions);
+    _interleaved_source.reset();
+  } else {
+    vertices_vbo.init();
+    positions_vbo.init();
+    if (_interleaved_source) {
+      vertices_vbo.write(_interleaved_source.get(), _vertices.size());
+      _interleaved_source.reset();
+    } else {
+      vertices_vbo.write(interleaved_vertices());
+    }
+    positions_vbo.write(_vertices);
+  }
+  // Every level of detail is a range of the element buffer
+  lod_offsets.assign(1, 0);
+  if (_lods.empty()) {
+    triangles_vbo.write(_triangles);
+  } else {
+    auto elements = _triangles;
+    for (const auto &lod : _lods) {
+      lod_offsets.push_back(elements.size() * 3);
+      elements.insert(elements.end(), lod.triangles.begin(),
+                      lod.triangles.end());
+    }
+    triangles_vbo.write(elements);
+  }
+  instances(std::vector<glm::mat4>{glm::mat4(1)});
 
-  vertices_vbo.write(_vertices);
-  normals_vbo.write(_normals);
-  tangents_vbo.write(_tangents);
-  bitangents_vbo.write(_bitangents);
-  uvs_vbo.write(_uvs);
-  triangles_vbo.write(_triangles);
+  auto instance_attrs = [&](const VAO &target) {
+    for (GLuint column = 0; column < 4; column++) {
+      target.attr<glm::vec4>(4 + column, instances_vbo,
+                             sizeof(glm::vec4) * column);
+      target.divisor(4 + column, 1);
+    }
+  };
+
+  if (packed) {
+    vao.attr<Normalized<glm::vec<4, std::uint16_t>>>(
+        0, packed_vertices_vbo, offsetof(PackedVertex, position));
+    vao.attr<PackedSnorm1010102>(1, packed_vertices_vbo,
+                                 offsetof(PackedVertex, normal));
+    vao.attr<PackedSnorm1010102>(2, packed_vertices_vbo,
+                                 offsetof(PackedVertex, tangent));
+    vao.attr<HalfVec<2>>(3, packed_vertices_vbo, offsetof(PackedVertex, uv));
+  } else {
+    vao.attr<glm::vec3>(0, vertices_vbo, offsetof(Vertex, position));
+    vao.attr<glm::vec3>(1, vertices_vbo, offsetof(Vertex, normal));
+    vao.attr<glm::vec4>(2, vertices_vbo, offsetof(Vertex, tangent));
+    vao.attr<glm::vec2>(3, vertices_vbo, offsetof(Vertex, uv));
+  }
+  instance_attrs(vao);
+  vao.elements(triangles_vbo);
+
+  depth_vao.init();
+  depth_vao.bind();
+  if (packed) {
+    depth_vao.attr(0, packed_positions_vbo);
+  } else {
+    depth_vao.attr(0, positions_vbo);
+  }
+  instance_attrs(depth_vao);
+  depth_vao.elements(triangles_vbo);
+
+  VAO::unbind();
 }
 
-inline void Mesh::bind_buffers() const {
-  vao.attr(0, vertices_vbo);
-  glEnableVertexAttribArray(0);
-  vao.attr(1, normals_vbo);
-  glEnableVertexAttribArray(1);
-  vao.attr(2, tangents_vbo);
-  glEnableVertexAttribArray(2);
-  vao.attr(3, bitangents_vbo);
-  glEnableVertexAttribArray(3);
-  vao.attr(4, uvs_vbo);
-  glEnableVertexAttribArray(4);
+inline void
+Mesh::interleaved_source(std::shared_ptr<const Vertex> vertices) {
+  _interleaved_source = std::move(vertices);
+}
 
-  triangles_vbo.bind();
+inline void Mesh::instances(const std::vector<glm::mat4> &models) {
+  if (_vertex_format == PACKED_VERTEX_FORMAT) {
+    auto transform = position_transform();
+    auto transformed = std::vector<glm::mat4>(models.size());
+    for (std::size_t i = 0; i < models.size(); i++) {
+      transformed[i] = models[i] * transform;
+    }
+    instances_vbo.write(transformed);
+  } else {
+    instances_vbo.write(models);
+  }
+  _num_instances = models.size();
 }
 
-inline void Mesh::post_draw() const {
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
-  glDisableVertexAttribArray(2);
-  glDisableVertexAttribArray(3);
-  glDisableVertexAttribArray(4);
+inline GLsizei Mesh::num_instances() const { return _num_instances; }
+
+inline void Mesh::bind_buffers() const { vao.bind(); }
+
+inline GLsizei Mesh::num_elements(std::size_t lod) const {
+  return (lod == 0 ? _triangles.size() : _lods[lod - 1].triangles.size()) * 3;
 }
 
-inline GLsizei Mesh::num_elements() const { return _triangles.size() * 3; }
+inline std::size_t Mesh::num_lods() const { return _lods.size() + 1; }
+
+inline const std::vector<MeshLod> &Mesh::lods() const { return _lods; }
+
+inline void Mesh::lods(std::vector<MeshLod> lods) {
+  if (lods.size() + 1 > MAX_LODS)
+    throw std::out_of_range("too many mesh levels of detail");
+  auto num_vertices = _vertices.size();
+  for (const auto &lod : lods) {
+    for (const auto &triangle : lod.triangles) {
+      if (triangle.x >= num_vertices || triangle.y >= num_vertices ||
+          triangle.z >= num_vertices)
+        throw std::out_of_range("mesh triangle index out of range");
+    }
+  }
+  _lods = std::move(lods);
+}
+
+inline std::size_t Mesh::select_lod(float max_error) const {
+  for (auto lod = _lods.size(); lod > 0; lod--) {
+    if (_lods[lod - 1].error <= max_error) return lod;
+  }
+  return 0;
+}
 
 inline const std::vector<glm::vec3> &Mesh::vertices() const {
   return _vertices;
@@ -128,18 +530,62 @@ inline const std::vector<glm::uvec3> &Mesh::triangles() const {
   return _triangles;
 }
 
+inline const AABB &Mesh::bounds() const { return _bounds; }
+
+inline const BoundingSphere &Mesh::bounding_sphere() const {
+  return _bounding_sphere;
+}
+
 inline void Mesh::normals(const std::vector<glm::vec3> &normals) {
   _normals = normals;
+  _interleaved_source.reset();
 }
 
-inline void Mesh::uvs(const std::vector<glm::vec2> &uvs) { _uvs = uvs; }
+inline void Mesh::uvs(const std::vector<glm::vec2> &uvs) {
+  _uvs = uvs;
+  _interleaved_source.reset();
+}
 
-inline void Mesh::draw() const {
+inline void Mesh::draw(std::size_t lod) const {
   bind_buffers();
 
-  glDrawElements(GL_TRIANGLES, num_elements(), GL_UNSIGNED_INT, (void *)0);
+  draw_instances(lod);
+}
+
+inline void Mesh::draw_instances(std::size_t lod) const {
+  glDrawElementsInstanced(GL_TRIANGLES, num_elements(lod), GL_UNSIGNED_INT,
+                          (void *)(lod_offsets[lod] * sizeof(GLuint)),
+                          _num_instances);
+}
+
+inline std::size_t Mesh::draw_meshlets(const std::uint32_t *visible,
+                                        std::size_t count) const {
+  range_counts.clear();
+  range_offsets.clear();
+  std::size_t num_triangles = 0;
+  std::uint32_t range_end = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    const auto &meshlet = _meshlets[visible[i]];
+    num_triangles += meshlet.num_triangles;
+    auto elements = (GLsizei)meshlet.num_triangles * 3;
+    if (!range_counts.empty() && meshlet.first_triangle == range_end) {
+      range_counts.back() += elements;
+    } else {
+      range_counts.push_back(elements);
+      range_offsets.push_back(
+          (const void *)(meshlet.first_triangle * 3 * sizeof(GLuint)));
+    }
+    range_end = meshlet.first_triangle + meshlet.num_triangles;
+  }
+  glMultiDrawElements(GL_TRIANGLES, range_counts.data(), GL_UNSIGNED_INT,
+                      range_offsets.data(), (GLsizei)range_counts.size());
+  return num_triangles;
+}
+
+inline void Mesh::draw_depth(std::size_t lod) const {
+  depth_vao.bind();
 
-  post_draw();
+  draw_instances(lod);
 }
 
 GLE_NAMESPACE_END
@@ -148,6 +594,45 @@ GLE_NAMESPACE_END
 
 #  include <gle/meshs/primitives.hpp>
 
+TEST_CASE("parallel normals match the serial normals") {
+  auto mesh = gle::make_ico_sphere_mesh(3);
+  auto normals = mesh->normals();
+  auto tangents = mesh->tangents();
+
+  mesh->calculate_normals(4);
+  for (std::size_t i = 0; i < normals.size(); i++) {
+    CHECK(glm::length(mesh->normals()[i] - normals[i]) < 1e-5f);
+    CHECK(glm::length(mesh->tangents()[i] - tangents[i]) <
+          1e-4f * glm::length(tangents[i]) + 1e-6f);
+  }
+}
+
+TEST_CASE("packed vertices dequantize close to the mesh vertices") {
+  auto mesh = gle::make_ico_sphere_mesh(3);
+  mesh->vertex_format(gle::PACKED_VERTEX_FORMAT);
+  auto transform = mesh->position_transform();
+  auto packed = mesh->packed_vertices();
+  auto interleaved = mesh->interleaved_vertices();
+  REQUIRE(packed.size() == interleaved.size());
+
+  for (std::size_t i = 0; i < packed.size(); i++) {
+    auto fraction = glm::vec4(0, 0, 0, 1);
+    for (int j = 0; j < 3; j++) {
+      fraction[j] = glm::unpackUnorm1x16(packed[i].position.value[j]);
+    }
+    auto position = glm::vec3(transform * fraction);
+    CHECK(glm::length(position - interleaved[i].position) < 1e-4f);
+
+    auto normal = glm::unpackSnorm3x10_1x2(packed[i].normal.bits);
+    CHECK(glm::length(glm::vec3(normal) -
+                      glm::normalize(interleaved[i].normal)) < 5e-3f);
+    auto tangent = glm::unpackSnorm3x10_1x2(packed[i].tangent.bits);
+    CHECK(tangent.w == interleaved[i].tangent.w);
+    CHECK(glm::unpackHalf1x16(packed[i].uv.bits.x) ==
+          doctest::Approx(interleaved[i].uv.x).epsilon(1e-3));
+  }
+}
+
 TEST_CASE("normals calculate fast" * doctest::timeout(0.5) *
           doctest::may_fail()) {
   auto mesh = gle::make_ico_sphere_mesh(4);
@@ -0,0 +1,111 @@
+#ifndef GLE_MESH_OPTIMIZER_HPP
+#define GLE_MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <gle/common.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of Mesh::optimize
+///
+struct MeshOptimizeOptions {
+  /// @brief the number of entries of the simulated FIFO post-transform
+  ///        vertex cache
+  ///
+  unsigned cache_size = 16;
+
+  /// @brief how much worse than the cache order the ACMR of the overdraw
+  ///        clusters may get, larger values split the mesh into more and
+  ///        smaller clusters that trade vertex cache hits for less overdraw
+  ///
+  float overdraw_threshold = 1.05f;
+};
+
+/// @brief The average cache miss ratio (ACMR, transformed vertices per
+///        triangle) of a mesh before and after Mesh::optimize
+///
+/// 3 means every vertex is transformed for every triangle using it, a well
+/// ordered closed mesh gets close to 0.5
+struct MeshOptimizeStats {
+  float acmr_before = 0.0f;
+  float acmr_after = 0.0f;
+};
+
+namespace __internal__ {
+/// @brief Simulate a FIFO post-transform vertex cache
+///
+/// @param triangles
+/// @param num_vertices
+/// @param cache_size
+/// @return the cache misses of each triangle, from 0 to 3
+inline std::vector<std::uint8_t>
+vertex_cache_misses(const std::vector<glm::uvec3> &triangles,
+                    std::size_t num_vertices, unsigned cache_size);
+
+/// @brief Get the ACMR of a triangle order with a FIFO vertex cache
+///
+/// @param triangles
+/// @param num_vertices
+/// @param cache_size
+/// @return float
+inline float acmr(const std::vector<glm::uvec3> &triangles,
+                  std::size_t num_vertices, unsigned cache_size);
+
+/// @brief Reorder triangles for the vertex cache with Tipsify
+///
+/// Fans around one vertex at a time and picks the next fanning vertex among
+/// the vertices of the emitted triangles, preferring the ones still in the
+/// cache that have few triangles left (Sander et al., "Fast triangle
+/// reordering for vertex locality and reduced overdraw"). Triangles keep
+/// their winding.
+///
+/// @param triangles
+/// @param num_vertices
+/// @param cache_size
+/// @return std::vector<glm::uvec3>
+inline std::vector<glm::uvec3>
+tipsify(const std::vector<glm::uvec3> &triangles, std::size_t num_vertices,
+        unsigned cache_size);
+
+/// @brief Reorder clusters of cache ordered triangles to reduce overdraw
+///
+/// The triangles are split where the cache is flushed, then wherever the
+/// ACMR of the cluster so far stays within threshold of the ACMR of the
+/// whole cluster. Clusters facing away from the mesh center come first, as
+/// they are the most likely to occlude the rest of the mesh from any view.
+///
+/// @param triangles cache ordered triangles
+/// @param vertices
+/// @param cache_size
+/// @param threshold
+/// @return std::vector<glm::uvec3>
+inline std::vector<glm::uvec3>
+order_overdraw_clusters(const std::vector<glm::uvec3> &triangles,
+                        const std::vector<glm::vec3> &vertices,
+                        unsigned cache_size, float threshold);
+
+/// @brief Get the new index of every vertex, in the order the triangles first
+///        use them, unused vertices go last
+///
+/// @param triangles
+/// @param num_vertices
+/// @return std::vector<std::uint32_t>
+inline std::vector<std::uint32_t>
+vertex_fetch_remap(const std::vector<glm::uvec3> &triangles,
+                   std::size_t num_vertices);
+
+/// @brief Move every element of values to its new index
+///
+/// @param values
+/// @param remap
+template <class T>
+inline void remap_vertices(std::vector<T> &values,
+                           const std::vector<std::uint32_t> &remap);
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#endif // GLE_MESH_OPTIMIZER_HPP
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline std::vector<std::uint8_t>
+vertex_cache_misses(const std::vector<glm::uvec3> &triangles,
+                    std::size_t num_vertices, unsigned cache_size) {
+  // A vertex is in the cache until cache_size other vertices were inserted
+  // after it, time counts the insertions
+  auto inserted = std::vector<std::uint32_t>(num_vertices, 0);
+  std::uint32_t time = cache_size + 1;
+
+  auto misses = std::vector<std::uint8_t>(triangles.size(), 0);
+  for (std::size_t t = 0; t < triangles.size(); t++) {
+    for (int i = 0; i < 3; i++) {
+      auto v = triangles[t][i];
+      if (time - inserted[v] > cache_size) {
+        inserted[v] = time++;
+        misses[t]++;
+      }
+    }
+  }
+  return misses;
+}
+
+inline float acmr(const std::vector<glm::uvec3> &triangles,
+                  std::size_t num_vertices, unsigned cache_size) {
+  if (triangles.empty()) return 0.0f;
+  auto misses = vertex_cache_misses(triangles, num_vertices, cache_size);
+  auto total = std::accumulate(misses.begin(), misses.end(), (std::size_t)0);
+  return (float)total / (float)triangles.size();
+}
+
+inline std::vector<glm::uvec3>
+tipsify(const std::vector<glm::uvec3> &triangles, std::size_t num_vertices,
+        unsigned cache_size) {
+  // Triangles around each vertex
+  auto offsets = std::vector<std::uint32_t>(num_vertices + 1, 0);
+  for (const auto &triangle : triangles) {
+    offsets[triangle.x + 1]++;
+    offsets[triangle.y + 1]++;
+    offsets[triangle.z + 1]++;
+  }
+  for (std::size_t v = 0; v < num_vertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  auto faces = std::vector<std::uint32_t>(offsets.back());
+  auto cursor = std::vector<std::uint32_t>(offsets.begin(), offsets.end() - 1);
+  for (std::size_t t = 0; t < triangles.size(); t++) {
+    for (int i = 0; i < 3; i++) {
+      faces[cursor[triangles[t][i]]++] = t;
+    }
+  }
+
+  // The triangles not emitted yet around each vertex
+  auto live = std::vector<std::uint32_t>(num_vertices);
+  for (std::size_t v = 0; v < num_vertices; v++) {
+    live[v] = offsets[v + 1] - offsets[v];
+  }
+  auto inserted = std::vector<std::uint32_t>(num_vertices, 0);
+  std::uint32_t time = cache_size + 1;
+  auto emitted = std::vector<bool>(triangles.size(), false);
+  auto dead_ends = std::vector<std::uint32_t>();
+  auto candidates = std::vector<std::uint32_t>();
+
+  auto result = std::vector<glm::uvec3>();
+  result.reserve(triangles.size());
+  std::size_t next_unvisited = 0;
+  const auto none = (std::size_t)-1;
+  auto fanning = num_vertices > 0 ? (std::size_t)0 : none;
+  while (fanning != none) {
+    candidates.clear();
+    for (auto i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+      auto t = faces[i];
+      if (emitted[t]) continue;
+      emitted[t] = true;
+      result.push_back(triangles[t]);
+      for (int j = 0; j < 3; j++) {
+        auto v = triangles[t][j];
+        dead_ends.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if (time - inserted[v] > cache_size) inserted[v] = time++;
+      }
+    }
+
+    // The oldest candidate that stays in the cache while its remaining
+    // triangles are emitted, or any candidate with triangles left
+    fanning = none;
+    int best_priority = -1;
+    for (auto v : candidates) {
+      if (live[v] == 0) continue;
+      auto age = time - inserted[v];
+      int priority = age + 2 * live[v] <= cache_size ? (int)age : 0;
+      if (priority > best_priority) {
+        best_priority = priority;
+        fanning = v;
+      }
+    }
+    // Dead end, go back to a recently used vertex or the next unvisited one
+    while (fanning == none && !dead_ends.empty()) {
+      auto v = dead_ends.back();
+      dead_ends.pop_back();
+      if (live[v] > 0) fanning = v;
+    }
+    while (fanning == none && next_unvisited < num_vertices) {
+      if (live[next_unvisited] > 0) fanning = next_unvisited;
+      next_unvisited++;
+    }
+  }
+  return result;
+}
+
+inline std::vector<glm::uvec3>
+order_overdraw_clusters(const std::vector<glm::uvec3> &triangles,
+                        const std::vector<glm::vec3> &vertices,
+                        unsigned cache_size, float threshold) {
+  auto misses = vertex_cache_misses(triangles, vertices.size(), cache_size);
+
+  // Hard boundaries where the cache was flushed, then soft boundaries where
+  // splitting the cluster keeps its ACMR within threshold
+  auto starts = std::vector<std::size_t>();
+  for (std::size_t t = 0; t < triangles.size(); t++) {
+    if (t == 0 || misses[t] == 3) starts.push_back(t);
+  }
+  starts.push_back(triangles.size());
+  // The soft clusters are simulated with a cold cache each, as they won't
+  // follow the triangles before them once reordered
+  auto inserted = std::vector<std::uint32_t>(vertices.size(), 0);
+  std::uint32_t time = cache_size + 1;
+  auto cold_misses = [&](const glm::uvec3 &triangle) {
+    std::size_t count = 0;
+    for (int i = 0; i < 3; i++) {
+      if (time - inserted[triangle[i]] > cache_size) {
+        inserted[triangle[i]] = time++;
+        count++;
+      }
+    }
+    return count;
+  };
+
+  auto clusters = std::vector<std::size_t>();
+  for (std::size_t c = 0; c + 1 < starts.size(); c++) {
+    auto first = starts[c], last = starts[c + 1];
+    auto total = std::accumulate(misses.begin() + first, misses.begin() + last,
+                                 (std::size_t)0);
+    auto cluster_threshold = threshold * (float)total / (float)(last - first);
+
+    auto start = first;
+    std::size_t cluster_misses = 0;
+    clusters.push_back(first);
+    time += cache_size + 1;
+    for (auto t = first; t + 1 < last; t++) {
+      cluster_misses += cold_misses(triangles[t]);
+      if ((float)cluster_misses <= cluster_threshold * (float)(t + 1 - start)) {
+        start = t + 1;
+        cluster_misses = 0;
+        clusters.push_back(start);
+        time += cache_size + 1;
+      }
+    }
+  }
+  clusters.push_back(triangles.size());
+
+  // Area weighted centroid and normal of the mesh and each cluster
+  auto center = glm::vec3(0);
+  auto area = 0.0f;
+  auto cluster_centers = std::vector<glm::vec3>(clusters.size() - 1);
+  auto cluster_normals = std::vector<glm::vec3>(clusters.size() - 1);
+  for (std::size_t c = 0; c + 1 < clusters.size(); c++) {
+    auto cluster_center = glm::vec3(0);
+    auto cluster_area = 0.0f;
+    auto normal = glm::vec3(0);
+    for (auto t = clusters[c]; t < clusters[c + 1]; t++) {
+      const auto &p0 = vertices[triangles[t].x];
+      const auto &p1 = vertices[triangles[t].y];
+      const auto &p2 = vertices[triangles[t].z];
+      auto cross = glm::cross(p1 - p0, p2 - p0);
+      auto triangle_area = glm::length(cross);
+      cluster_center += (p0 + p1 + p2) * (triangle_area / 3.0f);
+      cluster_area += triangle_area;
+      normal += cross;
+    }
+    center += cluster_center;
+    area += cluster_area;
+    cluster_centers[c] =
+        cluster_area > 0.0f ? cluster_center / cluster_area : cluster_center;
+    cluster_normals[c] = normal;
+  }
+  if (area > 0.0f) center /= area;
+
+  auto keys = std::vector<float>(cluster_centers.size());
+  for (std::size_t c = 0; c < keys.size(); c++) {
+    auto length = glm::length(cluster_normals[c]);
+    keys[c] = length > 0.0f ? glm::dot(cluster_centers[c] - center,
+                                       cluster_normals[c] / length)
+                            : 0.0f;
+  }
+  auto order = std::vector<std::size_t>(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](auto a, auto b) { return keys[a] > keys[b]; });
+
+  auto result = std::vector<glm::uvec3>();
+  result.reserve(triangles.size());
+  for (auto c : order) {
+    result.insert(result.end(), triangles.begin() + clusters[c],
+                  triangles.begin() + clusters[c + 1]);
+  }
+  return result;
+}
+
+inline std::vector<std::uint32_t>
+vertex_fetch_remap(const std::vector<glm::uvec3> &triangles,
+                   std::size_t num_vertices) {
+  const auto unused = (std::uint32_t)-1;
+  auto remap = std::vector<std::uint32_t>(num_vertices, unused);
+  std::uint32_t next = 0;
+  for (const auto &triangle : triangles) {
+    for (int i = 0; i < 3; i++) {
+      if (remap[triangle[i]] == unused) remap[triangle[i]] = next++;
+    }
+  }
+  for (auto &index : remap) {
+    if (index == unused) index = next++;
+  }
+  return remap;
+}
+
+template <class T>
+inline void remap_vertices(std::vector<T> &values,
+                           const std::vector<std::uint32_t> &remap) {
+  auto remapped = std::vector<T>(values.size());
+  for (std::size_t i = 0; i < values.size(); i++) {
+    remapped[remap[i]] = values[i];
+  }
+  values = std::move(remapped);
+}
+
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <tuple>
+
+TEST_CASE("tipsify lowers the ACMR of a shuffled grid") {
+  // A 32x32 quad grid, two triangles per quad
+  const std::uint32_t n = 32;
+  auto vertices = std::vector<glm::vec3>();
+  auto triangles = std::vector<glm::uvec3>();
+  for (std::uint32_t i = 0; i <= n; i++) {
+    for (std::uint32_t j = 0; j <= n; j++) {
+      vertices.emplace_back(i, 0, j);
+    }
+  }
+  for (std::uint32_t i = 0; i < n; i++) {
+    for (std::uint32_t j = 0; j < n; j++) {
+      auto a = i * (n + 1) + j, b = a + n + 1;
+      triangles.emplace_back(a, a + 1, b + 1);
+      triangles.emplace_back(a, b + 1, b);
+    }
+  }
+  // Deterministic shuffle
+  for (std::size_t i = triangles.size() - 1; i > 0; i--) {
+    std::swap(triangles[i], triangles[(i * 7919) % (i + 1)]);
+  }
+
+  auto shuffled = gle::__internal__::acmr(triangles, vertices.size(), 16);
+  auto ordered = gle::__internal__::tipsify(triangles, vertices.size(), 16);
+  CHECK(ordered.size() == triangles.size());
+  auto optimized = gle::__internal__::acmr(ordered, vertices.size(), 16);
+  INFO("ACMR ", shuffled, " -> ", optimized);
+  CHECK(optimized < 0.8f);
+  CHECK(optimized < shuffled);
+
+  // Every triangle is kept with its winding
+  auto sorted = [](std::vector<glm::uvec3> list) {
+    auto key = [](const glm::uvec3 &t) { return std::tie(t.x, t.y, t.z); };
+    std::sort(list.begin(), list.end(),
+              [&](const auto &a, const auto &b) { return key(a) < key(b); });
+    return list;
+  };
+  auto clustered = gle::__internal__::order_overdraw_clusters(ordered, vertices,
+                                                              16, 1.05f);
+  CHECK(sorted(ordered) == sorted(triangles));
+  CHECK(sorted(clustered) == sorted(triangles));
+
+  auto remap =
+      gle::__internal__::vertex_fetch_remap(clustered, vertices.size());
+  CHECK(remap[clustered[0].x] == 0);
+  CHECK(remap[clustered[0].y] == 1);
+  CHECK(remap[clustered[0].z] == 2);
+}
+
+#endif
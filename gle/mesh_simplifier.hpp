@@ -0,0 +1,85 @@
+#ifndef GLE_MESH_SIMPLIFIER_HPP
+#define GLE_MESH_SIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <gle/common.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+/// @brief A quadric error metric, the weighted sum of squared distances to a
+///        set of planes
+///
+struct Quadric {
+  double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+  double b0 = 0, b1 = 0, b2 = 0, c = 0, weight = 0;
+
+  /// @brief Get the quadric of the plane dot(normal, p) + d = 0
+  ///
+  /// @param normal the unit plane normal
+  /// @param d
+  /// @param weight
+  /// @return Quadric
+  inline static Quadric plane(const glm::vec3 &normal, float d, float weight);
+
+  inline Quadric &operator+=(const Quadric &other);
+
+  /// @brief Get the weighted mean squared distance of a point to the planes
+  ///
+  /// @param p
+  /// @return double
+  inline double error(const glm::vec3 &p) const;
+};
+
+/// @brief How a vertex may move when simplifying
+///
+enum class SimplifyVertexKind : std::uint8_t {
+  /// @brief may collapse into any neighbor
+  ///
+  MANIFOLD,
+  /// @brief on an open border, may only collapse along the border
+  ///
+  BORDER,
+  /// @brief on a uv or normal seam (other vertices share its position) or
+  ///        a non-manifold edge, never moves
+  ///
+  LOCKED,
+};
+
+/// @brief Classify the vertices of a mesh for simplify
+///
+/// @param vertices
+/// @param triangles
+/// @return std::vector<SimplifyVertexKind>
+inline std::vector<SimplifyVertexKind>
+simplify_vertex_kinds(const std::vector<glm::vec3> &vertices,
+                      const std::vector<glm::uvec3> &triangles);
+
+/// @brief Simplify a mesh with edge collapses ordered by a quadric error
+///        metric (Garland and Heckbert)
+///
+/// Vertices collapse into one of their neighbors, so the simplified
+/// triangles index the same vertex buffer. Every pass collapses the cheapest
+/// edges that don't touch each other and don't flip a triangle, until the
+/// target is reached or no edge can collapse. Vertices on seams are locked
+/// so the uvs and normals stay continuous, and open borders only shrink along
+/// themselves.
+///
+/// @param vertices
+/// @param triangles
+/// @param target the wanted number of triangles
+/// @param error set to the largest error of a collapse, as a distance in
+///        mesh space
+/// @return std::vector<glm::uvec3>
+inline std::vector<glm::uvec3>
+simplify(const std::vector<glm::vec3> &vertices,
+         const std::vector<glm::uvec3> &triangles, std::size_t target,
+         float &error);
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#endif // GLE_MESH_SIMPLIFIER_HPP
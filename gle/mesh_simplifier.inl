@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cmath>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline Quadric Quadric::plane(const glm::vec3 &normal, float d, float weight) {
+  auto q = Quadric();
+  double w = weight;
+  q.a00 = w * normal.x * normal.x;
+  q.a11 = w * normal.y * normal.y;
+  q.a22 = w * normal.z * normal.z;
+  q.a01 = w * normal.x * normal.y;
+  q.a02 = w * normal.x * normal.z;
+  q.a12 = w * normal.y * normal.z;
+  q.b0 = w * normal.x * d;
+  q.b1 = w * normal.y * d;
+  q.b2 = w * normal.z * d;
+  q.c = w * d * d;
+  q.weight = w;
+  return q;
+}
+
+inline Quadric &Quadric::operator+=(const Quadric &other) {
+  a00 += other.a00;
+  a11 += other.a11;
+  a22 += other.a22;
+  a01 += other.a01;
+  a02 += other.a02;
+  a12 += other.a12;
+  b0 += other.b0;
+  b1 += other.b1;
+  b2 += other.b2;
+  c += other.c;
+  weight += other.weight;
+  return *this;
+}
+
+inline double Quadric::error(const glm::vec3 &p) const {
+  double x = p.x, y = p.y, z = p.z;
+  // p^T A p + 2 b.p + c
+  auto e = a00 * x * x + a11 * y * y + a22 * z * z +
+           2 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+           2 * (b0 * x + b1 * y + b2 * z) + c;
+  return weight > 0 ? std::max(e, 0.0) / weight : 0.0;
+}
+
+// Directed edges packed as from << 32 | to, sorted to look edges up
+inline std::uint64_t simplify_edge(std::uint32_t from, std::uint32_t to) {
+  return (std::uint64_t)from << 32 | to;
+}
+
+inline std::vector<std::uint64_t>
+simplify_edges(const std::vector<glm::uvec3> &triangles) {
+  auto edges = std::vector<std::uint64_t>();
+  edges.reserve(triangles.size() * 3);
+  for (const auto &triangle : triangles) {
+    for (int i = 0; i < 3; i++) {
+      edges.push_back(simplify_edge(triangle[i], triangle[(i + 1) % 3]));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  return edges;
+}
+
+inline bool simplify_has_edge(const std::vector<std::uint64_t> &edges,
+                              std::uint32_t from, std::uint32_t to) {
+  return std::binary_search(edges.begin(), edges.end(),
+                            simplify_edge(from, to));
+}
+
+inline std::vector<SimplifyVertexKind>
+simplify_vertex_kinds(const std::vector<glm::vec3> &vertices,
+                      const std::vector<glm::uvec3> &triangles) {
+  auto kinds = std::vector<SimplifyVertexKind>(vertices.size(),
+                                               SimplifyVertexKind::MANIFOLD);
+
+  // Vertices sharing a position are the sides of a seam
+  auto order = std::vector<std::uint32_t>(vertices.size());
+  for (std::size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  auto less = [&](std::uint32_t a, std::uint32_t b) {
+    const auto &p = vertices[a], &q = vertices[b];
+    if (p.x != q.x) return p.x < q.x;
+    if (p.y != q.y) return p.y < q.y;
+    return p.z < q.z;
+  };
+  std::sort(order.begin(), order.end(), less);
+  for (std::size_t i = 1; i < order.size(); i++) {
+    if (vertices[order[i]] == vertices[order[i - 1]]) {
+      kinds[order[i]] = SimplifyVertexKind::LOCKED;
+      kinds[order[i - 1]] = SimplifyVertexKind::LOCKED;
+    }
+  }
+
+  // Edges without a reverse edge are borders, edges used twice the same way
+  // are non-manifold
+  auto edges = simplify_edges(triangles);
+  for (std::size_t i = 0; i < edges.size(); i++) {
+    auto from = (std::uint32_t)(edges[i] >> 32);
+    auto to = (std::uint32_t)edges[i];
+    if (i > 0 && edges[i] == edges[i - 1]) {
+      kinds[from] = SimplifyVertexKind::LOCKED;
+      kinds[to] = SimplifyVertexKind::LOCKED;
+    } else if (!simplify_has_edge(edges, to, from)) {
+      for (auto v : {from, to}) {
+        if (kinds[v] == SimplifyVertexKind::MANIFOLD)
+          kinds[v] = SimplifyVertexKind::BORDER;
+      }
+    }
+  }
+  return kinds;
+}
+
+inline std::vector<glm::uvec3>
+simplify(const std::vector<glm::vec3> &vertices,
+         const std::vector<glm::uvec3> &triangles, std::size_t target,
+         float &error) {
+  auto num_vertices = vertices.size();
+  auto kinds = simplify_vertex_kinds(vertices, triangles);
+
+  // Triangle planes weighted by area, and planes perpendicular to the
+  // borders so they keep their shape
+  const float border_weight = 10.0f;
+  auto quadrics = std::vector<Quadric>(num_vertices);
+  auto edges = simplify_edges(triangles);
+  for (const auto &triangle : triangles) {
+    const auto &p0 = vertices[triangle.x];
+    auto normal =
+        glm::cross(vertices[triangle.y] - p0, vertices[triangle.z] - p0);
+    auto length = glm::length(normal);
+    if (length <= 0.0f) continue;
+    normal /= length;
+    auto q = Quadric::plane(normal, -glm::dot(normal, p0), length * 0.5f);
+    for (int i = 0; i < 3; i++) {
+      quadrics[triangle[i]] += q;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      auto a = triangle[i], b = triangle[(i + 1) % 3];
+      if (simplify_has_edge(edges, b, a)) continue;
+      auto edge = vertices[b] - vertices[a];
+      auto edge_length = glm::length(edge);
+      if (edge_length <= 0.0f) continue;
+      auto border_normal =
+          glm::normalize(glm::cross(edge / edge_length, normal));
+      auto border = Quadric::plane(border_normal,
+                                   -glm::dot(border_normal, vertices[a]),
+                                   border_weight * edge_length * edge_length);
+      quadrics[a] += border;
+      quadrics[b] += border;
+    }
+  }
+
+  struct Collapse {
+    double cost;
+    std::uint32_t from, to;
+  };
+  auto collapses = std::vector<Collapse>();
+  auto offsets = std::vector<std::uint32_t>();
+  auto faces = std::vector<std::uint32_t>();
+  auto remap = std::vector<std::uint32_t>(num_vertices);
+  auto locked = std::vector<bool>(num_vertices);
+
+  auto result = triangles;
+  double max_error = 0;
+  while (result.size() > target) {
+    // Triangles around each vertex
+    offsets.assign(num_vertices + 1, 0);
+    for (const auto &triangle : result) {
+      offsets[triangle.x + 1]++;
+      offsets[triangle.y + 1]++;
+      offsets[triangle.z + 1]++;
+    }
+    for (std::size_t v = 0; v < num_vertices; v++) {
+      offsets[v + 1] += offsets[v];
+    }
+    faces.resize(offsets.back());
+    auto cursor =
+        std::vector<std::uint32_t>(offsets.begin(), offsets.end() - 1);
+    for (std::size_t t = 0; t < result.size(); t++) {
+      for (int i = 0; i < 3; i++) {
+        faces[cursor[result[t][i]]++] = t;
+      }
+    }
+
+    collapses.clear();
+    for (const auto &triangle : result) {
+      for (int i = 0; i < 3; i++) {
+        auto a = triangle[i], b = triangle[(i + 1) % 3];
+        for (auto [from, to] : {std::make_pair(a, b), std::make_pair(b, a)}) {
+          if (kinds[from] == SimplifyVertexKind::LOCKED) continue;
+          if (kinds[from] == SimplifyVertexKind::BORDER &&
+              kinds[to] == SimplifyVertexKind::MANIFOLD)
+            continue;
+          auto q = quadrics[from];
+          q += quadrics[to];
+          collapses.push_back(Collapse{q.error(vertices[to]), from, to});
+        }
+      }
+    }
+    if (collapses.empty()) break;
+    std::sort(collapses.begin(), collapses.end(),
+              [](const auto &a, const auto &b) { return a.cost < b.cost; });
+
+    // Each collapse removes about two triangles and has about four candidates
+    // (both directions in both triangles of its edge), allow collapses up to
+    // a bit more than the cost of the one that would reach the target
+    auto excess = result.size() - target;
+    auto goal = std::min(collapses.size() - 1, excess);
+    auto cost_limit = collapses[goal].cost * 1.5 + 1e-12;
+
+    for (std::size_t v = 0; v < num_vertices; v++) {
+      remap[v] = v;
+    }
+    locked.assign(num_vertices, false);
+    std::size_t removed = 0;
+    for (const auto &[cost, from, to] : collapses) {
+      if (removed >= excess || cost > cost_limit) break;
+      if (locked[from] || locked[to]) continue;
+
+      // The triangles around from must not flip when it moves to to, border
+      // vertices must move along their border
+      std::size_t shared = 0;
+      auto valid = true;
+      for (auto i = offsets[from]; i < offsets[from + 1] && valid; i++) {
+        const auto &triangle = result[faces[i]];
+        if (triangle.x == to || triangle.y == to || triangle.z == to) {
+          shared++;
+          continue;
+        }
+        glm::vec3 before[3], after[3];
+        for (int j = 0; j < 3; j++) {
+          before[j] = vertices[triangle[j]];
+          after[j] = triangle[j] == from ? vertices[to] : before[j];
+        }
+        auto normal_before =
+            glm::cross(before[1] - before[0], before[2] - before[0]);
+        auto normal_after =
+            glm::cross(after[1] - after[0], after[2] - after[0]);
+        valid = glm::dot(normal_before, normal_after) > 0.0f;
+      }
+      if (!valid) continue;
+      if (kinds[from] == SimplifyVertexKind::BORDER && shared != 1) continue;
+      if (kinds[from] == SimplifyVertexKind::MANIFOLD && shared != 2) continue;
+
+      remap[from] = to;
+      quadrics[to] += quadrics[from];
+      removed += shared;
+      max_error = std::max(max_error, cost);
+      // Lock the ring of from so the triangles checked above don't change
+      // again in this pass
+      for (auto i = offsets[from]; i < offsets[from + 1]; i++) {
+        const auto &triangle = result[faces[i]];
+        locked[triangle.x] = locked[triangle.y] = locked[triangle.z] = true;
+      }
+    }
+    if (removed == 0) break;
+
+    std::size_t kept = 0;
+    for (const auto &triangle : result) {
+      auto moved =
+          glm::uvec3(remap[triangle.x], remap[triangle.y], remap[triangle.z]);
+      if (moved.x == moved.y || moved.y == moved.z || moved.x == moved.z)
+        continue;
+      result[kept++] = moved;
+    }
+    result.resize(kept);
+  }
+
+  error = (float)std::sqrt(max_error);
+  return result;
+}
+
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <gle/meshs/primitives.hpp>
+
+TEST_CASE("simplify reaches the target and keeps seams in place") {
+  auto sphere = gle::make_ico_sphere_mesh(3);
+  const auto &vertices = sphere->vertices();
+  const auto &triangles = sphere->triangles();
+
+  float error = 0.0f;
+  auto half = gle::__internal__::simplify(vertices, triangles,
+                                          triangles.size() / 2, error);
+  CHECK(half.size() <= triangles.size() / 2);
+  CHECK(half.size() > triangles.size() / 4);
+  CHECK(error > 0.0f);
+  CHECK(error < 0.1f);
+
+  // A plane split in two halves by a seam, the seam vertices never move
+  auto plane = gle::make_plane_mesh(8);
+  auto seam_vertices = plane->vertices();
+  auto seam_triangles = plane->triangles();
+  auto duplicate = std::vector<std::uint32_t>(seam_vertices.size(), 0);
+  auto num_vertices = seam_vertices.size();
+  for (auto &triangle : seam_triangles) {
+    auto center = (seam_vertices[triangle.x] + seam_vertices[triangle.y] +
+                   seam_vertices[triangle.z]) /
+                  3.0f;
+    if (center.x < 0.5f) continue;
+    for (int i = 0; i < 3; i++) {
+      auto v = triangle[i];
+      if (seam_vertices[v].x != 0.5f) continue;
+      if (!duplicate[v]) {
+        duplicate[v] = seam_vertices.size();
+        seam_vertices.push_back(seam_vertices[v]);
+      }
+      triangle[i] = duplicate[v];
+    }
+  }
+  REQUIRE(seam_vertices.size() > num_vertices);
+
+  auto kinds =
+      gle::__internal__::simplify_vertex_kinds(seam_vertices, seam_triangles);
+  for (std::size_t v = num_vertices; v < seam_vertices.size(); v++) {
+    CHECK(kinds[v] == gle::__internal__::SimplifyVertexKind::LOCKED);
+  }
+  auto simplified = gle::__internal__::simplify(seam_vertices, seam_triangles,
+                                                seam_triangles.size() / 4,
+                                                error);
+  CHECK(simplified.size() < seam_triangles.size());
+  // Both sides of the seam still reach every seam vertex
+  for (std::size_t v = num_vertices; v < seam_vertices.size(); v++) {
+    auto used = std::any_of(simplified.begin(), simplified.end(),
+                            [&](const glm::uvec3 &t) {
+                              return t.x == v || t.y == v || t.z == v;
+                            });
+    CHECK(used);
+  }
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef GLE_MESHLET_HPP
+#define GLE_MESHLET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <gle/bounds.hpp>
+#include <gle/common.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of Mesh::build_meshlets
+///
+struct MeshletOptions {
+  /// @brief the largest number of unique vertices of a meshlet
+  ///
+  std::size_t max_vertices = 64;
+
+  /// @brief the largest number of triangles of a meshlet
+  ///
+  std::size_t max_triangles = 124;
+
+  /// @brief how much the triangles added to a meshlet are picked for facing
+  ///        the same way rather than sharing vertices, larger values give
+  ///        tighter normal cones and more back-face culling
+  ///
+  float cone_weight = 0.25f;
+};
+
+/// @brief A small cluster of triangles that is culled as a whole
+///
+/// The triangles of a meshlet are contiguous in the mesh element buffer.
+struct Meshlet {
+  std::uint32_t first_triangle = 0;
+  std::uint32_t num_triangles = 0;
+  std::uint32_t num_vertices = 0;
+
+  /// @brief the bounding sphere of the meshlet vertices, in mesh space
+  ///
+  BoundingSphere bounds;
+
+  /// @brief every triangle faces away from a camera at position c when
+  ///        dot(normalize(cone_apex - c), cone_axis) >= cone_cutoff
+  ///
+  glm::vec3 cone_apex = glm::vec3(0);
+
+  /// @brief the average direction of the triangle normals, 0 when the
+  ///        normals are too spread out to ever face away together
+  ///
+  glm::vec3 cone_axis = glm::vec3(0);
+
+  /// @brief the sine of the angle between cone_axis and the normal furthest
+  ///        from it
+  ///
+  float cone_cutoff = 1.0f;
+};
+
+namespace __internal__ {
+/// @brief Split a mesh into meshlets
+///
+/// Meshlets are grown greedily from a seed triangle, adding the neighboring
+/// triangle that brings the fewest new vertices and faces the closest to
+/// the meshlet normal, until the vertex or triangle limit is reached.
+/// The triangles are reordered so every meshlet is a contiguous range.
+///
+/// @param vertices
+/// @param triangles reordered in meshlet order
+/// @param options
+/// @return std::vector<Meshlet>
+inline std::vector<Meshlet>
+build_meshlets(const std::vector<glm::vec3> &vertices,
+               std::vector<glm::uvec3> &triangles,
+               const MeshletOptions &options);
+
+/// @brief Check if every triangle of a meshlet faces away from a camera
+///
+/// @param meshlet
+/// @param camera_position in mesh space
+/// @return true if the meshlet can be culled
+inline bool meshlet_backfacing(const Meshlet &meshlet,
+                               const glm::vec3 &camera_position);
+
+/// @brief Get the meshlets that may be visible
+///
+/// @param meshlets
+/// @param frustum the view frustum in mesh space
+/// @param camera_position in mesh space
+/// @param cone_culling if back-facing meshlets are culled, only valid when
+///        the model matrix has a uniform scale
+/// @param visible cleared, then set to the indices of the visible meshlets
+inline void cull_meshlets(const std::vector<Meshlet> &meshlets,
+                          const Frustum &frustum,
+                          const glm::vec3 &camera_position, bool cone_culling,
+                          std::vector<std::uint32_t> &visible);
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#endif // GLE_MESHLET_HPP
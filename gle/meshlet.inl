@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cmath>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline std::vector<Meshlet>
+build_meshlets(const std::vector<glm::vec3> &vertices,
+               std::vector<glm::uvec3> &triangles,
+               const MeshletOptions &options) {
+  auto num_vertices = vertices.size();
+  auto max_vertices = std::max<std::size_t>(options.max_vertices, 3);
+  auto max_triangles = std::max<std::size_t>(options.max_triangles, 1);
+
+  // Triangles around each vertex
+  auto offsets = std::vector<std::uint32_t>(num_vertices + 1, 0);
+  for (const auto &triangle : triangles) {
+    offsets[triangle.x + 1]++;
+    offsets[triangle.y + 1]++;
+    offsets[triangle.z + 1]++;
+  }
+  for (std::size_t v = 0; v < num_vertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+  auto faces = std::vector<std::uint32_t>(offsets.back());
+  auto cursor = std::vector<std::uint32_t>(offsets.begin(), offsets.end() - 1);
+  for (std::size_t t = 0; t < triangles.size(); t++) {
+    for (int i = 0; i < 3; i++) {
+      faces[cursor[triangles[t][i]]++] = t;
+    }
+  }
+
+  // Unit face normals, 0 for degenerate triangles
+  auto normals = std::vector<glm::vec3>(triangles.size());
+  for (std::size_t t = 0; t < triangles.size(); t++) {
+    const auto &p0 = vertices[triangles[t].x];
+    auto cross = glm::cross(vertices[triangles[t].y] - p0,
+                            vertices[triangles[t].z] - p0);
+    auto length = glm::length(cross);
+    normals[t] = length > 0.0f ? cross / length : glm::vec3(0);
+  }
+
+  auto used = std::vector<bool>(triangles.size(), false);
+  // The meshlet that last took each vertex, plus one
+  auto taken_by = std::vector<std::uint32_t>(num_vertices, 0);
+  auto meshlets = std::vector<Meshlet>();
+  auto ordered = std::vector<glm::uvec3>();
+  ordered.reserve(triangles.size());
+  auto members = std::vector<std::uint32_t>();
+  auto positions = std::vector<glm::vec3>();
+  auto candidates = std::vector<std::uint32_t>();
+
+  for (std::size_t seed = 0; seed < triangles.size(); seed++) {
+    if (used[seed]) continue;
+    auto stamp = (std::uint32_t)meshlets.size() + 1;
+    auto normal_sum = glm::vec3(0);
+    members.clear();
+    positions.clear();
+    candidates.clear();
+
+    auto add = [&](std::uint32_t t) {
+      used[t] = true;
+      members.push_back(t);
+      normal_sum += normals[t];
+      for (int i = 0; i < 3; i++) {
+        auto v = triangles[t][i];
+        if (taken_by[v] == stamp) continue;
+        taken_by[v] = stamp;
+        positions.push_back(vertices[v]);
+        for (auto j = offsets[v]; j < offsets[v + 1]; j++) {
+          if (!used[faces[j]]) candidates.push_back(faces[j]);
+        }
+      }
+    };
+    add(seed);
+
+    while (members.size() < max_triangles) {
+      auto length = glm::length(normal_sum);
+      auto axis = length > 0.0f ? normal_sum / length : glm::vec3(0);
+      const auto none = (std::uint32_t)-1;
+      auto best = none;
+      auto best_score = 0.0f;
+      for (std::size_t i = 0; i < candidates.size();) {
+        auto t = candidates[i];
+        if (used[t]) {
+          candidates[i] = candidates.back();
+          candidates.pop_back();
+          continue;
+        }
+        i++;
+        std::size_t new_vertices = 0;
+        for (int j = 0; j < 3; j++) {
+          if (taken_by[triangles[t][j]] != stamp) new_vertices++;
+        }
+        if (positions.size() + new_vertices > max_vertices) continue;
+        auto score = (float)new_vertices -
+                     options.cone_weight * glm::dot(normals[t], axis);
+        if (best == none || score < best_score) {
+          best = t;
+          best_score = score;
+        }
+      }
+      if (best == none) break;
+      add(best);
+    }
+
+    auto meshlet = Meshlet();
+    meshlet.first_triangle = ordered.size();
+    meshlet.num_triangles = members.size();
+    meshlet.num_vertices = positions.size();
+    meshlet.bounds = BoundingSphere::from_points(positions);
+    for (auto t : members) {
+      ordered.push_back(triangles[t]);
+    }
+
+    // The cone of the normals, see "Optimizing the graphics pipeline with
+    // compute" (Wihlidal) and meshoptimizer
+    meshlet.cone_apex = meshlet.bounds.center;
+    auto length = glm::length(normal_sum);
+    if (length > 0.0f) {
+      auto axis = normal_sum / length;
+      auto min_dot = 1.0f;
+      for (auto t : members) {
+        if (normals[t] != glm::vec3(0))
+          min_dot = std::min(min_dot, glm::dot(normals[t], axis));
+      }
+      // Wider than about 84 degrees, the apex would be too far to be useful
+      if (min_dot > 0.1f) {
+        auto max_t = 0.0f;
+        for (auto t : members) {
+          if (normals[t] == glm::vec3(0)) continue;
+          auto to_center = meshlet.bounds.center - vertices[triangles[t].x];
+          max_t = std::max(max_t, glm::dot(to_center, normals[t]) /
+                                      glm::dot(axis, normals[t]));
+        }
+        meshlet.cone_apex = meshlet.bounds.center - axis * max_t;
+        meshlet.cone_axis = axis;
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+      }
+    }
+    meshlets.push_back(meshlet);
+  }
+
+  triangles = std::move(ordered);
+  return meshlets;
+}
+
+inline bool meshlet_backfacing(const Meshlet &meshlet,
+                               const glm::vec3 &camera_position) {
+  auto to_apex = meshlet.cone_apex - camera_position;
+  auto length = glm::length(to_apex);
+  if (length <= 0.0f) return false;
+  return glm::dot(to_apex, meshlet.cone_axis) >= meshlet.cone_cutoff * length;
+}
+
+inline void cull_meshlets(const std::vector<Meshlet> &meshlets,
+                          const Frustum &frustum,
+                          const glm::vec3 &camera_position, bool cone_culling,
+                          std::vector<std::uint32_t> &visible) {
+  visible.clear();
+  for (std::size_t i = 0; i < meshlets.size(); i++) {
+    const auto &meshlet = meshlets[i];
+    if (!frustum.intersects(meshlet.bounds)) continue;
+    if (cone_culling && meshlet_backfacing(meshlet, camera_position)) continue;
+    visible.push_back(i);
+  }
+}
+
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <gle/meshs/primitives.hpp>
+#  include <tuple>
+
+TEST_CASE("meshlets cover the mesh and cull only back-facing triangles") {
+  auto mesh = gle::make_ico_sphere_mesh(4);
+  const auto &vertices = mesh->vertices();
+  auto triangles = mesh->triangles();
+  auto options = gle::MeshletOptions();
+  auto meshlets =
+      gle::__internal__::build_meshlets(vertices, triangles, options);
+
+  // Every triangle is kept, in contiguous meshlets within the limits
+  auto sorted = [](std::vector<glm::uvec3> list) {
+    auto key = [](const glm::uvec3 &t) { return std::tie(t.x, t.y, t.z); };
+    std::sort(list.begin(), list.end(),
+              [&](const auto &a, const auto &b) { return key(a) < key(b); });
+    return list;
+  };
+  CHECK(sorted(triangles) == sorted(mesh->triangles()));
+  std::uint32_t next = 0;
+  for (const auto &meshlet : meshlets) {
+    CHECK(meshlet.first_triangle == next);
+    CHECK(meshlet.num_triangles <= options.max_triangles);
+    CHECK(meshlet.num_vertices <= options.max_vertices);
+    next += meshlet.num_triangles;
+  }
+  CHECK(next == triangles.size());
+
+  // Seen from far along +z, about half the sphere faces away
+  auto camera = glm::vec3(0, 0, 100);
+  std::size_t culled = 0;
+  for (const auto &meshlet : meshlets) {
+    if (!gle::__internal__::meshlet_backfacing(meshlet, camera)) continue;
+    culled++;
+    for (auto t = meshlet.first_triangle;
+         t < meshlet.first_triangle + meshlet.num_triangles; t++) {
+      const auto &p0 = vertices[triangles[t].x];
+      auto normal = glm::cross(vertices[triangles[t].y] - p0,
+                               vertices[triangles[t].z] - p0);
+      CHECK(glm::dot(p0 - camera, normal) >= -1e-6f);
+    }
+  }
+  INFO(culled, " of ", meshlets.size(), " meshlets culled");
+  CHECK(culled > meshlets.size() / 4);
+}
+
+#endif
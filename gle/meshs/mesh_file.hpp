@@ -0,0 +1,189 @@
+#ifndef GLE_MESHS_MESH_FILE_HPP
+#define GLE_MESHS_MESH_FILE_HPP
+
+#include <cstdint>
+#include <gle/common.hpp>
+#include <gle/mapped_file.hpp>
+#include <gle/mesh.hpp>
+#include <gle/meshs/obj.hpp>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of written mesh files
+///
+struct MeshFileOptions {
+  /// @brief store positions as 16 bit fractions of the mesh bounds, normals
+  ///        and tangents as 16 bit signed normalized and uvs as half floats
+  ///
+  /// Halves the vertex stream, but the vertices have to be expanded when the
+  /// file is read instead of being uploaded straight from the file
+  bool quantize = false;
+
+  /// @brief reorder parsed meshes with Mesh::optimize before writing them,
+  ///        only used by load_obj_cached
+  ///
+  bool optimize = true;
+
+  /// @brief generate levels of detail of parsed meshes with
+  ///        Mesh::generate_lods before writing them, none if empty, only
+  ///        used by load_obj_cached
+  ///
+  std::vector<float> lod_ratios;
+};
+
+namespace __internal__ {
+constexpr char mesh_file_magic[4] = {'G', 'L', 'E', 'M'};
+constexpr std::uint32_t mesh_file_version = 2;
+constexpr std::uint32_t mesh_file_quantized = 1;
+
+/// @brief The source file a mesh file was made from, the mesh file is stale
+///        once the source size and either its mtime or hash change
+///
+struct MeshFileSource {
+  std::uint64_t size = 0;
+  std::uint64_t mtime = 0;
+  std::uint64_t hash = 0;
+};
+
+/// @brief The header at the start of a mesh file, followed by the vertex
+///        stream at vertices_offset, the triangles at triangles_offset and
+///        the table of levels of detail at lods_offset
+///
+/// Every field is stored in the byte order of the machine that wrote it,
+/// files from machines with another byte order fail the magic check
+struct MeshFileHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t flags;
+  std::uint32_t num_vertices;
+  std::uint32_t num_triangles;
+  std::uint32_t vertex_size;
+  MeshFileSource source;
+  glm::vec3 bounds_min;
+  glm::vec3 bounds_max;
+  glm::vec4 bounding_sphere;
+  std::uint64_t vertices_offset;
+  std::uint64_t triangles_offset;
+  std::uint64_t lods_offset;
+  std::uint32_t num_lods;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 120);
+
+/// @brief An entry of the table of levels of detail of a mesh file
+///
+struct MeshFileLod {
+  std::uint64_t triangles_offset;
+  std::uint32_t num_triangles;
+  float error;
+};
+
+static_assert(sizeof(MeshFileLod) == 16);
+
+/// @brief Vertex layout of quantized mesh files
+///
+struct QuantizedVertex {
+  // unorm16 fractions of the mesh bounds
+  std::uint16_t position[3];
+  // snorm16, the tangent is normalized and w is the handedness sign
+  std::uint16_t normal[3];
+  std::uint16_t tangent[4];
+  // half floats
+  std::uint16_t uv[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 24);
+
+/// @brief 64 bit FNV-1a hash of some bytes
+///
+/// @param bytes
+/// @return std::uint64_t
+inline std::uint64_t fnv1a(std::string_view bytes);
+
+/// @brief Get the size and mtime of a file, the hash is left 0
+///
+/// @param path
+/// @return MeshFileSource
+/// @throws std::runtime_error if the file doesn't exist
+inline MeshFileSource mesh_file_source(const std::string &path);
+
+/// @brief Write a mesh file, first to a temporary file that is then renamed
+///        so meshes still mapping the old file keep valid pages
+///
+/// @param mesh
+/// @param path
+/// @param options
+/// @param source
+/// @throws std::runtime_error if the file can't be written
+inline void write_mesh_file(const Mesh &mesh, const std::string &path,
+                            const MeshFileOptions &options,
+                            const MeshFileSource &source);
+
+/// @brief Check the header of a mapped mesh file
+///
+/// @param file
+/// @return const MeshFileHeader&
+/// @throws std::runtime_error if the file isn't a valid mesh file
+inline const MeshFileHeader &
+read_mesh_file_header(const std::shared_ptr<const MappedFile> &file);
+
+/// @brief Read a mesh from a mapped mesh file
+///
+/// @param file
+/// @return std::unique_ptr<Mesh>
+/// @throws std::runtime_error if the file isn't a valid mesh file
+inline std::unique_ptr<Mesh>
+read_mesh_file(const std::shared_ptr<const MappedFile> &file);
+} // namespace __internal__
+
+/// @brief Write a mesh with its normals, tangents and levels of detail to a
+///        binary mesh file
+///
+/// @param mesh
+/// @param path
+/// @param options
+/// @throws std::runtime_error if the file can't be written
+inline void write_mesh(const Mesh &mesh, const std::string &path,
+                       const MeshFileOptions &options = {});
+
+/// @brief Read a mesh from a binary mesh file
+///
+/// The file is memory mapped. The normals and tangents are read instead of
+/// calculated, and the vertex stream of files that aren't quantized is
+/// uploaded to the vertex buffer straight from the mapped pages by
+/// Mesh::init_buffers, so the file stays mapped until then.
+///
+/// @param path
+/// @return std::unique_ptr<Mesh>
+/// @throws std::runtime_error if the file can't be read or isn't a valid mesh
+///         file
+inline std::unique_ptr<Mesh> read_mesh(const std::string &path);
+
+/// @brief Load an obj file through a binary mesh file next to it
+///
+/// The mesh file is read when it was made from the same obj file: the size
+/// must match, and the mtime or, when the file was touched, a hash of the
+/// contents. Otherwise the obj file is parsed like load_obj_from_file, gets
+/// the levels of detail of options.lod_ratios, is optimized unless
+/// options.optimize is false, and the mesh file is written again. Failing to
+/// write the mesh file is not an error, the mesh is returned anyway.
+///
+/// @param obj_path
+/// @param mesh_path the mesh file, obj_path + ".glemesh" if empty
+/// @param options the options of the mesh file written on a cache miss
+/// @param num_threads the number of obj parser threads, 0 for
+///        std::thread::hardware_concurrency()
+/// @return std::unique_ptr<Mesh>
+/// @throws std::runtime_error if the obj file can't be read or parsed
+inline std::unique_ptr<Mesh>
+load_obj_cached(const std::string &obj_path, std::string mesh_path = "",
+                const MeshFileOptions &options = {}, unsigned num_threads = 0);
+
+GLE_NAMESPACE_END
+
+#endif // GLE_MESHS_MESH_FILE_HPP
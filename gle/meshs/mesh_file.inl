@@ -0,0 +1,401 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glm/gtc/packing.hpp>
+#include <stdexcept>
+#include <system_error>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline std::uint64_t fnv1a(std::string_view bytes) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  for (auto byte : bytes) {
+    hash ^= (unsigned char)byte;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+inline MeshFileSource mesh_file_source(const std::string &path) {
+  auto error = std::error_code();
+  auto size = std::filesystem::file_size(path, error);
+  if (error) throw std::runtime_error("could not stat " + path);
+  auto mtime = std::filesystem::last_write_time(path, error);
+  if (error) throw std::runtime_error("could not stat " + path);
+
+  auto source = MeshFileSource();
+  source.size = size;
+  source.mtime = (std::uint64_t)mtime.time_since_epoch().count();
+  return source;
+}
+
+inline std::uint64_t mesh_file_align(std::uint64_t offset) {
+  return (offset + 15) & ~(std::uint64_t)15;
+}
+
+inline std::uint32_t mesh_file_vertex_size(std::uint32_t flags) {
+  return flags & mesh_file_quantized ? sizeof(QuantizedVertex)
+                                     : sizeof(Vertex);
+}
+
+inline QuantizedVertex quantize_vertex(const Vertex &vertex,
+                                       const AABB &bounds) {
+  auto extent = bounds.max - bounds.min;
+  auto tangent = glm::vec3(vertex.tangent);
+  if (glm::dot(tangent, tangent) > 0.0f) tangent = glm::normalize(tangent);
+
+  auto quantized = QuantizedVertex();
+  for (int i = 0; i < 3; i++) {
+    auto fraction = extent[i] > 0.0f
+                        ? (vertex.position[i] - bounds.min[i]) / extent[i]
+                        : 0.0f;
+    quantized.position[i] = glm::packUnorm1x16(fraction);
+    quantized.normal[i] = glm::packSnorm1x16(vertex.normal[i]);
+    quantized.tangent[i] = glm::packSnorm1x16(tangent[i]);
+  }
+  quantized.tangent[3] = glm::packSnorm1x16(vertex.tangent.w);
+  quantized.uv[0] = glm::packHalf1x16(vertex.uv.x);
+  quantized.uv[1] = glm::packHalf1x16(vertex.uv.y);
+  return quantized;
+}
+
+inline Vertex dequantize_vertex(const QuantizedVertex &quantized,
+                                const AABB &bounds) {
+  auto extent = bounds.max - bounds.min;
+  auto vertex = Vertex();
+  for (int i = 0; i < 3; i++) {
+    vertex.position[i] =
+        bounds.min[i] + glm::unpackUnorm1x16(quantized.position[i]) * extent[i];
+    vertex.normal[i] = glm::unpackSnorm1x16(quantized.normal[i]);
+    vertex.tangent[i] = glm::unpackSnorm1x16(quantized.tangent[i]);
+  }
+  vertex.tangent.w = glm::unpackSnorm1x16(quantized.tangent[3]);
+  vertex.uv.x = glm::unpackHalf1x16(quantized.uv[0]);
+  vertex.uv.y = glm::unpackHalf1x16(quantized.uv[1]);
+  return vertex;
+}
+
+inline void write_mesh_file(const Mesh &mesh, const std::string &path,
+                            const MeshFileOptions &options,
+                            const MeshFileSource &source) {
+  auto header = MeshFileHeader();
+  std::memcpy(header.magic, mesh_file_magic, sizeof(header.magic));
+  header.version = mesh_file_version;
+  header.flags = options.quantize ? mesh_file_quantized : 0;
+  header.num_vertices = mesh.vertices().size();
+  header.num_triangles = mesh.triangles().size();
+  header.vertex_size = mesh_file_vertex_size(header.flags);
+  header.source = source;
+  header.bounds_min = mesh.bounds().min;
+  header.bounds_max = mesh.bounds().max;
+  header.bounding_sphere = glm::vec4(mesh.bounding_sphere().center,
+                                     mesh.bounding_sphere().radius);
+  header.vertices_offset = mesh_file_align(sizeof(header));
+  header.triangles_offset =
+      mesh_file_align(header.vertices_offset +
+                      (std::uint64_t)header.vertex_size * header.num_vertices);
+  header.lods_offset = mesh_file_align(
+      header.triangles_offset + sizeof(glm::uvec3) * header.num_triangles);
+  header.num_lods = mesh.lods().size();
+  header.reserved = 0;
+
+  auto lods = std::vector<MeshFileLod>();
+  auto offset = mesh_file_align(header.lods_offset +
+                                sizeof(MeshFileLod) * header.num_lods);
+  for (const auto &lod : mesh.lods()) {
+    lods.push_back(MeshFileLod{offset, (std::uint32_t)lod.triangles.size(),
+                               lod.error});
+    offset =
+        mesh_file_align(offset + sizeof(glm::uvec3) * lod.triangles.size());
+  }
+
+  auto vertices = mesh.interleaved_vertices();
+  auto temporary = path + ".tmp";
+  {
+    auto file = std::ofstream(temporary, std::ios_base::binary);
+    if (!file) throw std::runtime_error("could not open " + temporary);
+
+    const char padding[16] = {};
+    auto pad_to = [&](std::uint64_t offset) {
+      file.write(padding, offset - (std::uint64_t)file.tellp());
+    };
+    file.write((const char *)&header, sizeof(header));
+    pad_to(header.vertices_offset);
+    if (options.quantize) {
+      for (const auto &vertex : vertices) {
+        auto quantized = quantize_vertex(vertex, mesh.bounds());
+        file.write((const char *)&quantized, sizeof(quantized));
+      }
+    } else {
+      file.write((const char *)vertices.data(),
+                 sizeof(Vertex) * vertices.size());
+    }
+    pad_to(header.triangles_offset);
+    file.write((const char *)mesh.triangles().data(),
+               sizeof(glm::uvec3) * mesh.triangles().size());
+    pad_to(header.lods_offset);
+    file.write((const char *)lods.data(), sizeof(MeshFileLod) * lods.size());
+    for (std::size_t i = 0; i < lods.size(); i++) {
+      pad_to(lods[i].triangles_offset);
+      const auto &triangles = mesh.lods()[i].triangles;
+      file.write((const char *)triangles.data(),
+                 sizeof(glm::uvec3) * triangles.size());
+    }
+    if (!file) throw std::runtime_error("could not write " + temporary);
+  }
+
+  auto error = std::error_code();
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    throw std::runtime_error("could not write " + path);
+  }
+}
+
+inline const MeshFileHeader &
+read_mesh_file_header(const std::shared_ptr<const MappedFile> &file) {
+  auto bytes = file->view();
+  auto invalid = [&](const char *reason) {
+    return std::runtime_error(std::string("invalid mesh file: ") + reason);
+  };
+  if (bytes.size() < sizeof(MeshFileHeader)) throw invalid("truncated header");
+
+  const auto &header = *(const MeshFileHeader *)bytes.data();
+  if (std::memcmp(header.magic, mesh_file_magic, sizeof(header.magic)) != 0)
+    throw invalid("bad magic");
+  if (header.version != mesh_file_version) throw invalid("unknown version");
+  if ((header.flags & ~mesh_file_quantized) != 0)
+    throw invalid("unknown flags");
+  if (header.vertex_size != mesh_file_vertex_size(header.flags))
+    throw invalid("bad vertex size");
+
+  auto fits = [&](std::uint64_t offset, std::uint64_t size) {
+    return offset % 16 == 0 && offset <= bytes.size() &&
+           size <= bytes.size() - offset;
+  };
+  if (!fits(header.vertices_offset,
+            (std::uint64_t)header.vertex_size * header.num_vertices) ||
+      !fits(header.triangles_offset,
+            sizeof(glm::uvec3) * (std::uint64_t)header.num_triangles))
+    throw invalid("truncated streams");
+  if (header.num_lods + 1 > Mesh::MAX_LODS) throw invalid("too many lods");
+  if (!fits(header.lods_offset, sizeof(MeshFileLod) * header.num_lods))
+    throw invalid("truncated lods");
+  auto lods = (const MeshFileLod *)(bytes.data() + header.lods_offset);
+  for (std::uint32_t i = 0; i < header.num_lods; i++) {
+    if (!fits(lods[i].triangles_offset,
+              sizeof(glm::uvec3) * (std::uint64_t)lods[i].num_triangles))
+      throw invalid("truncated lods");
+  }
+
+  return header;
+}
+
+inline std::unique_ptr<Mesh>
+read_mesh_file(const std::shared_ptr<const MappedFile> &file) {
+  const auto &header = read_mesh_file_header(file);
+  auto data = file->view().data();
+  auto bounds = AABB{header.bounds_min, header.bounds_max};
+  std::size_t num_vertices = header.num_vertices;
+
+  auto read_triangles = [&](std::uint64_t offset, std::size_t count) {
+    auto triangles = std::vector<glm::uvec3>(count);
+    std::memcpy(triangles.data(), data + offset,
+                sizeof(glm::uvec3) * triangles.size());
+    for (const auto &triangle : triangles) {
+      if (triangle.x >= num_vertices || triangle.y >= num_vertices ||
+          triangle.z >= num_vertices)
+        throw std::runtime_error("invalid mesh file: index out of range");
+    }
+    return triangles;
+  };
+  auto triangles =
+      read_triangles(header.triangles_offset, header.num_triangles);
+  auto lods = std::vector<MeshLod>();
+  auto lod_table = (const MeshFileLod *)(data + header.lods_offset);
+  for (std::uint32_t i = 0; i < header.num_lods; i++) {
+    lods.push_back(MeshLod{read_triangles(lod_table[i].triangles_offset,
+                                          lod_table[i].num_triangles),
+                           lod_table[i].error});
+  }
+
+  auto positions = std::vector<glm::vec3>(num_vertices);
+  auto normals = std::vector<glm::vec3>(num_vertices);
+  auto tangents = std::vector<glm::vec4>(num_vertices);
+  auto uvs = std::vector<glm::vec2>(num_vertices);
+  auto store = [&](std::size_t i, const Vertex &vertex) {
+    positions[i] = vertex.position;
+    normals[i] = vertex.normal;
+    tangents[i] = vertex.tangent;
+    uvs[i] = vertex.uv;
+  };
+
+  auto stream = data + header.vertices_offset;
+  const Vertex *interleaved = nullptr;
+  if (header.flags & mesh_file_quantized) {
+    auto quantized = (const QuantizedVertex *)stream;
+    for (std::size_t i = 0; i < num_vertices; i++) {
+      store(i, dequantize_vertex(quantized[i], bounds));
+    }
+  } else {
+    interleaved = (const Vertex *)stream;
+    for (std::size_t i = 0; i < num_vertices; i++) {
+      store(i, interleaved[i]);
+    }
+  }
+
+  auto mesh = std::make_unique<Mesh>(std::move(positions), std::move(normals),
+                                     tangents, std::move(uvs),
+                                     std::move(triangles));
+  mesh->lods(std::move(lods));
+  // The vertex buffer is filled from the mapped pages, which the aliasing
+  // pointer keeps mapped until init_buffers
+  if (interleaved)
+    mesh->interleaved_source(std::shared_ptr<const Vertex>(file, interleaved));
+  return mesh;
+}
+
+} // namespace __internal__
+
+inline void write_mesh(const Mesh &mesh, const std::string &path,
+                       const MeshFileOptions &options) {
+  __internal__::write_mesh_file(mesh, path, options,
+                                __internal__::MeshFileSource());
+}
+
+inline std::unique_ptr<Mesh> read_mesh(const std::string &path) {
+  return __internal__::read_mesh_file(std::make_shared<const MappedFile>(path));
+}
+
+inline std::unique_ptr<Mesh> load_obj_cached(const std::string &obj_path,
+                                             std::string mesh_path,
+                                             const MeshFileOptions &options,
+                                             unsigned num_threads) {
+  if (mesh_path.empty()) mesh_path = obj_path + ".glemesh";
+
+  auto source = __internal__::mesh_file_source(obj_path);
+  // The obj file is only mapped and hashed when the mtimes differ or the
+  // mesh file has to be written
+  auto obj = std::unique_ptr<MappedFile>();
+  auto map_obj = [&]() {
+    if (obj) return;
+    obj = std::make_unique<MappedFile>(obj_path);
+    source.hash = __internal__::fnv1a(obj->view());
+  };
+
+  auto error = std::error_code();
+  if (std::filesystem::exists(mesh_path, error)) {
+    try {
+      auto file = std::make_shared<const MappedFile>(mesh_path);
+      const auto &header = __internal__::read_mesh_file_header(file);
+      auto fresh = header.source.size == source.size;
+      if (fresh && header.source.mtime != source.mtime) {
+        map_obj();
+        fresh = header.source.hash == source.hash;
+      }
+      if (fresh) return __internal__::read_mesh_file(file);
+    } catch (const std::runtime_error &) {
+      // Unreadable mesh files are written again below
+    }
+  }
+
+  map_obj();
+  auto mesh = load_obj(obj->view(), num_threads);
+  if (!options.lod_ratios.empty()) mesh->generate_lods(options.lod_ratios);
+  if (options.optimize) {
+    [[maybe_unused]] auto stats = mesh->optimize();
+    GLE_LOG(GLE_INFO, "Optimized %s, ACMR %.3f -> %.3f", obj_path.c_str(),
+            stats.acmr_before, stats.acmr_after);
+  }
+  try {
+    __internal__::write_mesh_file(*mesh, mesh_path, options, source);
+  } catch (const std::runtime_error &) {
+    GLE_LOG(GLE_WARN, "Could not write mesh file %s", mesh_path.c_str());
+  }
+  return mesh;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <gle/meshs/primitives.hpp>
+
+namespace {
+// A path in the temporary directory, removed with its cache when the test
+// ends
+struct TemporaryPath {
+  std::string path;
+
+  explicit TemporaryPath(const char *name)
+      : path((std::filesystem::temp_directory_path() / name).string()) {}
+
+  ~TemporaryPath() {
+    auto error = std::error_code();
+    std::filesystem::remove(path, error);
+    std::filesystem::remove(path + ".glemesh", error);
+  }
+};
+} // namespace
+
+TEST_CASE("mesh files read back the written mesh") {
+  auto mesh = gle::make_ico_sphere_mesh(2);
+  mesh->generate_lods({0.5f});
+  auto expected = mesh->interleaved_vertices();
+  auto temporary = TemporaryPath("gle_test.glemesh");
+  const auto &path = temporary.path;
+
+  gle::write_mesh(*mesh, path);
+  auto read = gle::read_mesh(path);
+  CHECK(read->triangles() == mesh->triangles());
+  REQUIRE(read->num_lods() == 2);
+  CHECK(read->lods()[0].triangles == mesh->lods()[0].triangles);
+  CHECK(read->lods()[0].error == mesh->lods()[0].error);
+  CHECK(read->vertices() == mesh->vertices());
+  CHECK(read->normals() == mesh->normals());
+  auto interleaved = read->interleaved_vertices();
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    CHECK(interleaved[i].tangent.w == expected[i].tangent.w);
+  }
+
+  auto options = gle::MeshFileOptions();
+  options.quantize = true;
+  gle::write_mesh(*mesh, path, options);
+  auto quantized = gle::read_mesh(path);
+  CHECK(quantized->triangles() == mesh->triangles());
+  for (std::size_t i = 0; i < expected.size(); i++) {
+    CHECK(glm::length(quantized->vertices()[i] - expected[i].position) <
+          1e-4f);
+    CHECK(glm::length(quantized->normals()[i] - expected[i].normal) < 1e-4f);
+  }
+
+  // Truncated files are rejected
+  {
+    auto file = std::ofstream(path, std::ios_base::binary);
+    file << "GLEM";
+  }
+  CHECK_THROWS_AS(gle::read_mesh(path), std::runtime_error);
+}
+
+TEST_CASE("cached obj files are parsed again when the obj file changes") {
+  auto temporary = TemporaryPath("gle_test.obj");
+  const auto &obj_path = temporary.path;
+  auto mesh_path = obj_path + ".glemesh";
+  auto write = [&](const char *contents) {
+    auto file = std::ofstream(obj_path, std::ios_base::binary);
+    file << contents;
+  };
+
+  write("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  CHECK(gle::load_obj_cached(obj_path)->triangles().size() == 1);
+  CHECK(std::ifstream(mesh_path).good());
+  CHECK(gle::load_obj_cached(obj_path)->triangles().size() == 1);
+
+  write("v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\nf 1 2 3\nf 2 4 3\n");
+  CHECK(gle::load_obj_cached(obj_path)->triangles().size() == 2);
+  CHECK(gle::read_mesh(mesh_path)->triangles().size() == 2);
+}
+
+#endif
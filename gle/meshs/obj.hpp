@@ -1,27 +1,80 @@
 #ifndef GLE_MESHS_OBJ_HPP
 #define GLE_MESHS_OBJ_HPP
 
+#include <cstdint>
 #include <gle/common.hpp>
 #include <gle/mesh.hpp>
+#include <gle/parallel.hpp>
 #include <istream>
 #include <memory>
+#include <string_view>
+#include <vector>
 
 GLE_NAMESPACE_BEGIN
 
-/// @brief Load an obj file to a mesh from a file path
+/// @brief The vertices and triangles of an obj file
+///
+/// Every distinct v/vt/vn combination used by a face is one vertex, so the
+/// attributes share a single index buffer. Files where the nth position, uv
+/// and normal belong together keep their vertices in file order.
+struct ObjData {
+  std::vector<glm::vec3> vertices;
+
+  /// @brief the vertex uvs, empty if the file has no texture coordinates
+  ///
+  std::vector<glm::vec2> uvs;
+
+  /// @brief the vertex normals, empty unless every face vertex has a normal
+  ///
+  std::vector<glm::vec3> normals;
+
+  std::vector<glm::uvec3> triangles;
+};
+
+/// @brief Parse the contents of an obj file
+///
+/// Supports v, vt and vn lines and f lines with v, v/vt, v//vn and v/vt/vn
+/// vertices, including negative (relative) indices. Polygons are split into
+/// triangle fans. When a face vertex has no vt or vn index and the file has
+/// as many of them as positions, the position index is used, as load_obj
+/// always did. Other lines are ignored.
+///
+/// The source is split into chunks at line boundaries that are parsed in
+/// parallel with std::from_chars, which is locale independent.
 ///
 /// @param source
+/// @param num_threads the number of threads, 0 for
+///        std::thread::hardware_concurrency()
+/// @return ObjData
+/// @throws std::runtime_error on malformed numbers or out of range indices
+inline ObjData parse_obj(std::string_view source, unsigned num_threads = 1);
+
+/// @brief Load an obj file to a mesh from a file path
+///
+/// The file is memory mapped and parsed in place with parse_obj
+///
+/// @param file
+/// @param num_threads the number of parser threads, 0 for
+///        std::thread::hardware_concurrency()
 /// @return std::unique_ptr<Mesh>
-inline std::unique_ptr<Mesh> load_obj_from_file(const std::string &file);
+inline std::unique_ptr<Mesh> load_obj_from_file(const std::string &file,
+                                                unsigned num_threads = 0);
 
 /// @brief Load an obj file to a mesh
 ///
-/// @param source
+/// @param source the contents of the obj file, parsed with parse_obj
+/// @param num_threads the number of parser threads
 /// @return std::unique_ptr<Mesh>
-inline std::unique_ptr<Mesh> load_obj(const std::string &source);
+inline std::unique_ptr<Mesh> load_obj(std::string_view source,
+                                      unsigned num_threads = 1);
 
 /// @brief Load an obj file to a mesh
 ///
+/// Streaming parser for triangles without slashes, where the nth position,
+/// uv and normal belong together. Prefer load_obj_from_file or the
+/// std::string_view overload, which are much faster and support more of
+/// the format.
+///
 /// @param source
 /// @return std::unique_ptr<Mesh>
 inline std::unique_ptr<Mesh> load_obj(std::istream &source);
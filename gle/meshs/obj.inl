@@ -1,17 +1,309 @@
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 
 GLE_NAMESPACE_BEGIN
 
-inline std::unique_ptr<Mesh> load_obj_from_file(const std::string &file) {
-  std::ifstream stream(file, std::ios_base::in);
-  if (!stream) throw std::runtime_error("obj file not found");
-  return load_obj(stream);
+namespace __internal__ {
+
+// A missing vt or vn index
+constexpr std::uint32_t obj_no_index = 0xffffffff;
+// Set on negative indices, which are relative to the elements parsed so far
+// by their chunk and are resolved once the chunk offsets are known. The low
+// bits hold the chunk local index plus obj_relative_bias, as it is negative
+// when the index reaches into a previous chunk.
+constexpr std::uint32_t obj_chunk_relative = 0x80000000;
+constexpr long long obj_relative_bias = 0x40000000;
+
+struct ObjCorner {
+  std::uint32_t v;
+  std::uint32_t vt;
+  std::uint32_t vn;
+};
+
+struct ObjChunk {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  // Three corners per triangle
+  std::vector<ObjCorner> corners;
+};
+
+inline bool obj_is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *obj_skip_spaces(const char *p, const char *end) {
+  while (p < end && obj_is_space(*p)) p++;
+  return p;
+}
+
+inline const char *obj_parse_float(const char *p, const char *end,
+                                   float &value) {
+  p = obj_skip_spaces(p, end);
+  // from_chars doesn't accept a leading +
+  if (p < end && *p == '+') p++;
+  auto [next, error] = std::from_chars(p, end, value);
+  if (error != std::errc())
+    throw std::runtime_error("invalid number in obj file");
+  return next;
+}
+
+inline const char *obj_parse_index(const char *p, const char *end,
+                                   std::size_t count, std::uint32_t &index) {
+  long long value = 0;
+  auto [next, error] = std::from_chars(p, end, value);
+  if (error != std::errc() || value == 0)
+    throw std::runtime_error("invalid index in obj file");
+
+  if (value > 0) {
+    if (value > (long long)obj_chunk_relative)
+      throw std::runtime_error("obj index out of range");
+    index = (std::uint32_t)(value - 1);
+  } else {
+    // The largest biased index would be obj_no_index
+    auto local = (long long)count + value;
+    if (local < -obj_relative_bias || local >= obj_relative_bias - 1)
+      throw std::runtime_error("obj index out of range");
+    index = obj_chunk_relative | (std::uint32_t)(local + obj_relative_bias);
+  }
+  return next;
+}
+
+inline void parse_obj_chunk(std::string_view source, ObjChunk &chunk) {
+  auto polygon = std::vector<ObjCorner>();
+  auto p = source.data();
+  auto end = p + source.size();
+  while (p < end) {
+    auto line_end = (const char *)std::memchr(p, '\n', end - p);
+    if (!line_end) line_end = end;
+    p = obj_skip_spaces(p, line_end);
+
+    if (line_end - p > 2 && p[0] == 'v' && obj_is_space(p[1])) {
+      auto &position = chunk.positions.emplace_back();
+      auto q = obj_parse_float(p + 1, line_end, position.x);
+      q = obj_parse_float(q, line_end, position.y);
+      obj_parse_float(q, line_end, position.z);
+    } else if (line_end - p > 3 && p[0] == 'v' && p[1] == 't' &&
+               obj_is_space(p[2])) {
+      auto &uv = chunk.uvs.emplace_back();
+      auto q = obj_parse_float(p + 2, line_end, uv.x);
+      obj_parse_float(q, line_end, uv.y);
+    } else if (line_end - p > 3 && p[0] == 'v' && p[1] == 'n' &&
+               obj_is_space(p[2])) {
+      auto &normal = chunk.normals.emplace_back();
+      auto q = obj_parse_float(p + 2, line_end, normal.x);
+      q = obj_parse_float(q, line_end, normal.y);
+      obj_parse_float(q, line_end, normal.z);
+    } else if (line_end - p > 2 && p[0] == 'f' && obj_is_space(p[1])) {
+      polygon.clear();
+      auto q = p + 1;
+      while (true) {
+        q = obj_skip_spaces(q, line_end);
+        if (q == line_end || *q == '#') break;
+
+        auto corner = ObjCorner{0, obj_no_index, obj_no_index};
+        q = obj_parse_index(q, line_end, chunk.positions.size(), corner.v);
+        if (q < line_end && *q == '/') {
+          q++;
+          if (q < line_end && *q != '/')
+            q = obj_parse_index(q, line_end, chunk.uvs.size(), corner.vt);
+          if (q < line_end && *q == '/')
+            q = obj_parse_index(q + 1, line_end, chunk.normals.size(),
+                                corner.vn);
+        }
+        polygon.push_back(corner);
+      }
+
+      if (polygon.size() < 3)
+        throw std::runtime_error("obj face with less than 3 vertices");
+      for (std::size_t i = 1; i + 1 < polygon.size(); i++) {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i]);
+        chunk.corners.push_back(polygon[i + 1]);
+      }
+    }
+
+    p = line_end == end ? end : line_end + 1;
+  }
 }
 
-inline std::unique_ptr<Mesh> load_obj(const std::string &source) {
-  auto str = std::stringstream(source);
-  return load_obj(str);
+inline std::uint32_t obj_resolve_index(std::uint32_t index, std::size_t offset,
+                                       std::size_t count) {
+  if (index == obj_no_index) return index;
+  auto resolved = (long long)index;
+  if (index & obj_chunk_relative)
+    resolved = (long long)(index & ~obj_chunk_relative) - obj_relative_bias +
+               (long long)offset;
+  if (resolved < 0 || resolved >= (long long)count)
+    throw std::runtime_error("obj index out of range");
+  return (std::uint32_t)resolved;
+}
+
+} // namespace __internal__
+
+inline ObjData parse_obj(std::string_view source, unsigned num_threads) {
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // Split at line ends into chunks of at least 1MB, so small files are parsed
+  // on the calling thread
+  auto num_chunks = std::max<std::size_t>(
+      1, std::min<std::size_t>(num_threads, source.size() >> 20));
+  auto bounds = std::vector<std::size_t>{0};
+  for (std::size_t i = 1; i < num_chunks; i++) {
+    auto at = std::max(source.size() * i / num_chunks, bounds.back());
+    at = source.find('\n', at);
+    bounds.push_back(at == std::string_view::npos ? source.size() : at + 1);
+  }
+  bounds.push_back(source.size());
+
+  // Exceptions can't leave the parser threads, they are rethrown after
+  auto chunks = std::vector<__internal__::ObjChunk>(num_chunks);
+  auto errors = std::vector<std::exception_ptr>(num_chunks);
+  __internal__::parallel_for(
+      num_chunks, num_chunks, [&](std::size_t first, std::size_t last) {
+        for (auto c = first; c < last; c++) {
+          try {
+            __internal__::parse_obj_chunk(
+                source.substr(bounds[c], bounds[c + 1] - bounds[c]),
+                chunks[c]);
+          } catch (...) {
+            errors[c] = std::current_exception();
+          }
+        }
+      });
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+
+  auto positions = std::vector<glm::vec3>();
+  auto uvs = std::vector<glm::vec2>();
+  auto normals = std::vector<glm::vec3>();
+  std::size_t num_corners = 0;
+  for (const auto &chunk : chunks) {
+    num_corners += chunk.corners.size();
+  }
+  // The offsets of each chunk are the sizes of the arrays before it
+  auto offsets = std::vector<glm::uvec3>();
+  for (auto &chunk : chunks) {
+    offsets.push_back(glm::uvec3(positions.size(), uvs.size(), normals.size()));
+    positions.insert(positions.end(), chunk.positions.begin(),
+                     chunk.positions.end());
+    uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+    normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    chunk.positions = std::vector<glm::vec3>();
+    chunk.uvs = std::vector<glm::vec2>();
+    chunk.normals = std::vector<glm::vec3>();
+  }
+
+  // Files that only have position indices pair the nth position, uv and
+  // normal
+  auto uvs_by_position = uvs.size() == positions.size();
+  auto normals_by_position = normals.size() == positions.size();
+  auto all_normals = !normals.empty();
+
+  using __internal__::obj_no_index;
+  auto by_position = true;
+  for (std::size_t c = 0; c < chunks.size(); c++) {
+    for (auto &corner : chunks[c].corners) {
+      corner.v = __internal__::obj_resolve_index(corner.v, offsets[c].x,
+                                                 positions.size());
+      corner.vt = __internal__::obj_resolve_index(corner.vt, offsets[c].y,
+                                                  uvs.size());
+      corner.vn = __internal__::obj_resolve_index(corner.vn, offsets[c].z,
+                                                  normals.size());
+      if (corner.vt == obj_no_index && uvs_by_position) corner.vt = corner.v;
+      if (corner.vn == obj_no_index && normals_by_position)
+        corner.vn = corner.v;
+      if (corner.vn == obj_no_index) all_normals = false;
+      by_position = by_position &&
+                    (corner.vt == corner.v || corner.vt == obj_no_index) &&
+                    (corner.vn == corner.v || corner.vn == obj_no_index);
+    }
+  }
+
+  auto data = ObjData();
+  data.triangles.resize(num_corners / 3);
+  std::size_t corner_index = 0;
+  if (by_position && (uvs_by_position || uvs.empty()) &&
+      (normals_by_position || normals.empty())) {
+    // Every position has one uv and normal, the vertices are the positions
+    // in file order
+    for (const auto &chunk : chunks) {
+      for (const auto &corner : chunk.corners) {
+        data.triangles[corner_index / 3][corner_index % 3] = corner.v;
+        corner_index++;
+      }
+    }
+    data.vertices = std::move(positions);
+    data.uvs = std::move(uvs);
+    data.normals = std::move(normals);
+    if (!all_normals) data.normals.clear();
+    return data;
+  }
+
+  // The vertices sharing a position are chained through next, so finding the
+  // vertex of a v/vt/vn combination only compares against the few vertices
+  // with the same position
+  auto head = std::vector<std::uint32_t>(positions.size(), obj_no_index);
+  auto next = std::vector<std::uint32_t>();
+  auto keys = std::vector<std::pair<std::uint32_t, std::uint32_t>>();
+  next.reserve(positions.size());
+  keys.reserve(positions.size());
+  data.vertices.reserve(positions.size());
+  for (auto &chunk : chunks) {
+    for (const auto &[v, vt, vn] : chunk.corners) {
+      auto key = std::make_pair(vt, vn);
+      auto index = head[v];
+      while (index != obj_no_index && keys[index] != key) {
+        index = next[index];
+      }
+      if (index == obj_no_index) {
+        index = data.vertices.size();
+        data.vertices.push_back(positions[v]);
+        if (!uvs.empty())
+          data.uvs.push_back(vt == obj_no_index ? glm::vec2(0) : uvs[vt]);
+        if (!normals.empty())
+          data.normals.push_back(vn == obj_no_index ? glm::vec3(0)
+                                                    : normals[vn]);
+        keys.push_back(key);
+        next.push_back(head[v]);
+        head[v] = index;
+      }
+
+      data.triangles[corner_index / 3][corner_index % 3] = index;
+      corner_index++;
+    }
+    chunk.corners = std::vector<__internal__::ObjCorner>();
+  }
+  if (!all_normals) data.normals.clear();
+
+  return data;
+}
+
+inline std::unique_ptr<Mesh> load_obj_from_file(const std::string &file,
+                                                unsigned num_threads) {
+  auto mapped = MappedFile(file);
+  return load_obj(mapped.view(), num_threads);
+}
+
+inline std::unique_ptr<Mesh> load_obj(std::string_view source,
+                                      unsigned num_threads) {
+  auto data = parse_obj(source, num_threads);
+
+  auto mesh = data.uvs.empty()
+                  ? std::make_unique<Mesh>(std::move(data.vertices),
+                                           std::move(data.triangles))
+                  : std::make_unique<Mesh>(std::move(data.vertices),
+                                           std::move(data.uvs),
+                                           std::move(data.triangles));
+  if (!data.normals.empty()) mesh->normals(data.normals);
+
+  return mesh;
 }
 
 inline std::unique_ptr<Mesh> load_obj(std::istream &source) {
@@ -102,4 +394,60 @@ f 3 2 1
   CHECK(mesh->triangles().at(1) == glm::uvec3(2, 1, 0));
 }
 
+TEST_CASE("parse_obj shares vertices of faces with v/vt/vn indices") {
+  std::string obj = R"(
+v 0 0 0
+v 1 0 0
+v 1 1 0
+v 0 1 0
+vt 0 0
+vt 1 0
+vt 1 1
+vt 0 1
+vt 0.5 0.5
+vn 0 0 1
+f 1/1/1 2/2/1 3/3/1 4/4/1
+f -4/5/-1 -2/3/-1 -1/4/-1
+)";
+  auto data = gle::parse_obj(obj);
+
+  // The quad is split in two triangles, the last face shares 2 of its
+  // vertices with the quad and uses the first position with a new uv
+  CHECK(data.triangles.size() == 3);
+  CHECK(data.triangles.at(0) == glm::uvec3(0, 1, 2));
+  CHECK(data.triangles.at(1) == glm::uvec3(0, 2, 3));
+  CHECK(data.triangles.at(2) == glm::uvec3(4, 2, 3));
+  CHECK(data.vertices.size() == 5);
+  CHECK(data.vertices.at(4) == glm::vec3(0, 0, 0));
+  CHECK(data.uvs.at(4) == glm::vec2(0.5, 0.5));
+  CHECK(data.normals.size() == 5);
+  CHECK(data.normals.at(4) == glm::vec3(0, 0, 1));
+
+  CHECK_THROWS_AS(gle::parse_obj("v 0 0 0\nf 1 2 3\n"), std::runtime_error);
+  CHECK_THROWS_AS(gle::parse_obj("v 0 x 0\n"), std::runtime_error);
+}
+
+TEST_CASE("parse_obj resolves negative indices across chunks") {
+  // Large enough to be split into chunks, whose faces reach back to the
+  // positions of the first one
+  auto obj = std::string();
+  for (int i = 0; i < 20000; i++) {
+    obj += "v " + std::to_string(i) + " 0 0\n";
+  }
+  for (int i = 0; i < 200000; i++) {
+    obj += "f -1 -2 -3\n";
+  }
+  REQUIRE(obj.size() > (std::size_t)2 << 20);
+
+  auto single = gle::parse_obj(obj, 1);
+  auto parallel = gle::parse_obj(obj, 4);
+  CHECK(single.triangles.size() == 200000);
+  CHECK(single.triangles.back() == glm::uvec3(19999, 19998, 19997));
+  CHECK(parallel.triangles == single.triangles);
+  CHECK(parallel.vertices == single.vertices);
+
+  CHECK_THROWS_AS(gle::parse_obj(obj + "f -1 -2 -20001\n", 4),
+                  std::runtime_error);
+}
+
 #endif
\ No newline at end of file
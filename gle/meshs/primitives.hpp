@@ -1,12 +1,32 @@
 #ifndef GLE_MESHS_PRIMITIVES_HPP
 #define GLE_MESHS_PRIMITIVES_HPP
 
+#include <cstdint>
 #include <gle/common.hpp>
 #include <gle/mesh.hpp>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 GLE_NAMESPACE_BEGIN
 
+namespace __internal__ {
+// Midpoint vertex index of each edge, keyed on the sorted vertex index pair
+using MidpointCache = std::unordered_map<std::uint64_t, std::uint32_t>;
+
+/// @brief Get the index of the midpoint vertex of an edge, the vertex is added
+///        the first time the edge is seen
+///
+/// @param vertices
+/// @param cache
+/// @param a
+/// @param b
+/// @return std::uint32_t
+inline std::uint32_t vertex_midpoint(std::vector<glm::vec3> &vertices,
+                                     MidpointCache &cache, std::uint32_t a,
+                                     std::uint32_t b);
+} // namespace __internal__
+
 /// @brief Create a cube mesh with width 2
 ///
 /// @return std::shared_ptr<Mesh>
@@ -18,6 +38,20 @@ inline std::unique_ptr<Mesh> make_cube_mesh();
 /// @return std::shared_ptr<Mesh>
 inline std::unique_ptr<Mesh> make_ico_sphere_mesh(int subdivisions = 0);
 
+/// @brief Generate the vertices, uvs and triangles of an ico sphere with
+///        radius 1 into the given arrays
+///
+/// The arrays are cleared and reserved to their final size, so arrays reused
+/// across calls are not reallocated
+///
+/// @param subdivisions the number of ico subdivisions
+/// @param vertices
+/// @param uvs
+/// @param triangles
+inline void make_ico_sphere(int subdivisions, std::vector<glm::vec3> &vertices,
+                            std::vector<glm::vec2> &uvs,
+                            std::vector<glm::uvec3> &triangles);
+
 /// @brief Create a plane mesh
 ///
 /// @param subdivisions the number of grid lines
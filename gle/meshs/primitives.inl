@@ -1,16 +1,19 @@
+#include <cmath>
+#include <utility>
+
 GLE_NAMESPACE_BEGIN
 
 namespace __internal__ {
 
-inline int vertex_midpoint(std::vector<glm::vec3> &vertices, int a, int b) {
-  auto mid = (vertices.at(a) + vertices.at(b)) / 2.0f;
-  for (size_t i = 0; i < vertices.size(); i++) {
-    if (vertices.at(i) == mid) {
-      return i;
-    }
-  }
-  vertices.push_back(mid);
-  return vertices.size() - 1;
+inline std::uint32_t vertex_midpoint(std::vector<glm::vec3> &vertices,
+                                     MidpointCache &cache, std::uint32_t a,
+                                     std::uint32_t b) {
+  // Both triangles sharing an edge must find the same midpoint
+  if (a > b) std::swap(a, b);
+  auto key = ((std::uint64_t)a << 32) | b;
+  auto [it, inserted] = cache.try_emplace(key, (std::uint32_t)vertices.size());
+  if (inserted) vertices.push_back((vertices[a] + vertices[b]) / 2.0f);
+  return it->second;
 }
 
 } // namespace __internal__
@@ -44,10 +47,23 @@ inline std::unique_ptr<Mesh> make_cube_mesh() {
   return std::make_unique<gle::Mesh>(vertices, triangles);
 }
 
-inline std::unique_ptr<Mesh> make_ico_sphere_mesh(int subdivisions) {
-  auto vertices = std::vector<glm::vec3>();
-  auto triangles = std::vector<glm::uvec3>();
-  auto uvs = std::vector<glm::vec2>();
+inline void make_ico_sphere(int subdivisions, std::vector<glm::vec3> &vertices,
+                            std::vector<glm::vec2> &uvs,
+                            std::vector<glm::uvec3> &triangles) {
+  // Every subdivision splits each triangle in 4 and adds a vertex per edge
+  std::size_t num_triangles = 20;
+  std::size_t num_vertices = 12;
+  for (int i = 0; i < subdivisions; i++) {
+    num_vertices += num_triangles * 3 / 2;
+    num_triangles *= 4;
+  }
+
+  vertices.clear();
+  uvs.clear();
+  triangles.clear();
+  vertices.reserve(num_vertices);
+  uvs.reserve(num_vertices);
+  triangles.reserve(num_triangles);
 
   auto t = (1.0 + sqrt(5.0)) / 2.0;
 
@@ -85,30 +101,32 @@ inline std::unique_ptr<Mesh> make_ico_sphere_mesh(int subdivisions) {
   triangles.push_back(glm::uvec3(8, 6, 7));
   triangles.push_back(glm::uvec3(9, 8, 1));
 
+  auto new_triangles = std::vector<glm::uvec3>();
+  new_triangles.reserve(num_triangles);
+  auto cache = __internal__::MidpointCache();
   for (int i = 0; i < subdivisions; i++) {
-    std::vector<glm::uvec3> new_triangles;
-
-    int j = 0;
+    new_triangles.clear();
+    cache.clear();
+    cache.reserve(triangles.size() * 3 / 2);
 
     for (auto &triangle : triangles) {
       //       x
       //    zx/_\xy
       //   z/_\/_\y
       //      yz
-      int x = triangle.x;
-      int y = triangle.y;
-      int z = triangle.z;
-      int xy = __internal__::vertex_midpoint(vertices, x, y);
-      int yz = __internal__::vertex_midpoint(vertices, y, z);
-      int zx = __internal__::vertex_midpoint(vertices, z, x);
+      auto x = triangle.x;
+      auto y = triangle.y;
+      auto z = triangle.z;
+      auto xy = __internal__::vertex_midpoint(vertices, cache, x, y);
+      auto yz = __internal__::vertex_midpoint(vertices, cache, y, z);
+      auto zx = __internal__::vertex_midpoint(vertices, cache, z, x);
       new_triangles.push_back(glm::uvec3(x, xy, zx));
       new_triangles.push_back(glm::uvec3(xy, y, yz));
       new_triangles.push_back(glm::uvec3(zx, yz, z));
       new_triangles.push_back(glm::uvec3(zx, xy, yz));
-      j++;
     }
 
-    triangles = new_triangles;
+    std::swap(triangles, new_triangles);
   }
 
   for (auto &vertex : vertices) {
@@ -116,8 +134,16 @@ inline std::unique_ptr<Mesh> make_ico_sphere_mesh(int subdivisions) {
     uvs.push_back(glm::vec2(0.5 + atan2(vertex.x, vertex.z) / (2 * M_PI),
                             0.5 - asin(vertex.y) / M_PI));
   }
+}
 
-  return std::make_unique<gle::Mesh>(vertices, uvs, triangles);
+inline std::unique_ptr<Mesh> make_ico_sphere_mesh(int subdivisions) {
+  auto vertices = std::vector<glm::vec3>();
+  auto uvs = std::vector<glm::vec2>();
+  auto triangles = std::vector<glm::uvec3>();
+  make_ico_sphere(subdivisions, vertices, uvs, triangles);
+
+  return std::make_unique<gle::Mesh>(std::move(vertices), std::move(uvs),
+                                     std::move(triangles));
 }
 
 inline std::unique_ptr<Mesh> make_plane_mesh(int subdivisions) {
@@ -205,15 +231,35 @@ GLE_NAMESPACE_END
 
 TEST_CASE("__internal__::vertex_midpoint finds midpoint") {
   auto vertices = std::vector<glm::vec3>();
+  auto cache = gle::__internal__::MidpointCache();
 
   vertices.push_back(glm::vec3(1, 1, 1));
   vertices.push_back(glm::vec3(2, 2, 2));
 
-  int i = gle::__internal__::vertex_midpoint(vertices, 0, 1);
+  auto i = gle::__internal__::vertex_midpoint(vertices, cache, 0, 1);
 
   CHECK(i == 2);
   CHECK(vertices.size() == 3);
   CHECK(vertices.at(i) == glm::vec3(1.5, 1.5, 1.5));
+
+  // The reversed edge shares the midpoint
+  CHECK(gle::__internal__::vertex_midpoint(vertices, cache, 1, 0) == i);
+  CHECK(vertices.size() == 3);
+}
+
+TEST_CASE("make_ico_sphere shares edge midpoints") {
+  auto vertices = std::vector<glm::vec3>();
+  auto uvs = std::vector<glm::vec2>();
+  auto triangles = std::vector<glm::uvec3>();
+  gle::make_ico_sphere(3, vertices, uvs, triangles);
+
+  // A closed mesh with V - E + F = 2 and E = 3F / 2
+  CHECK(triangles.size() == 1280);
+  CHECK(vertices.size() == 642);
+  CHECK(uvs.size() == vertices.size());
+  for (const auto &vertex : vertices) {
+    CHECK(glm::length(vertex) == doctest::Approx(1.0f));
+  }
 }
 
 TEST_CASE("make_plane_mesh 1 subdivision") {
@@ -1,6 +1,7 @@
 #ifndef GLE_OBJECT_HPP
 #define GLE_OBJECT_HPP
 
+#include <gle/bounds.hpp>
 #include <gle/common.hpp>
 #include <gle/shader.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -99,12 +100,41 @@ public:
   /// @param value
   inline void rotation(const glm::quat &value);
 
+  /// @brief check if the object is rendered into the shadow map
+  ///
+  /// @return true by default
+  inline bool casts_shadows() const;
+
+  /// @brief set whether the object is rendered into the shadow map
+  ///
+  /// @param value
+  inline void casts_shadows(bool value);
+
   /// @brief get the model matrix for this object
   ///
   /// @return const glm::mat4&
   inline const glm::mat4 &model_matrix() const;
 
+  /// @brief get the world space bounding box of the object's mesh
+  ///
+  /// @return const AABB&
+  inline const AABB &world_bounds() const;
+
+  /// @brief get the world space bounding sphere of the object's mesh
+  ///
+  /// @return const BoundingSphere&
+  inline const BoundingSphere &world_bounding_sphere() const;
+
+  /// @brief Intersect a world space ray with the object's mesh triangles
+  ///
+  /// @param ray
+  /// @param max_t only hits closer than max_t are reported
+  /// @return the ray parameter of the closest hit, or max_t if it misses
+  inline float raycast(const Ray &ray, float max_t) const;
+
 private:
+  friend class Scene;
+
   inline void update_model_matrix();
   Shader &_shader;
   Material &_material;
@@ -112,8 +142,15 @@ private:
   glm::vec3 _position;
   glm::vec3 _scale;
   glm::quat _rotation;
+  bool _casts_shadows = true;
 
   glm::mat4 _model;
+  AABB _world_bounds;
+  BoundingSphere _world_bounding_sphere;
+
+  // The scene BVH containing this object, refit when the object moves
+  ObjectBVH *bvh = nullptr;
+  ObjectBVH::Proxy bvh_proxy = ObjectBVH::null_proxy;
 };
 
 GLE_NAMESPACE_END
@@ -26,6 +26,10 @@ inline glm::vec3 Object::rotation_euler() const {
   return glm::eulerAngles(_rotation);
 }
 
+inline bool Object::casts_shadows() const { return _casts_shadows; }
+
+inline void Object::casts_shadows(bool value) { _casts_shadows = value; }
+
 inline void Object::position(const glm::vec3 &value) {
   _position = value;
   update_model_matrix();
@@ -48,11 +52,32 @@ inline void Object::rotation(const glm::quat &value) {
 
 inline const glm::mat4 &Object::model_matrix() const { return _model; }
 
+inline const AABB &Object::world_bounds() const { return _world_bounds; }
+
+inline const BoundingSphere &Object::world_bounding_sphere() const {
+  return _world_bounding_sphere;
+}
+
 inline void Object::update_model_matrix() {
   auto translate = glm::translate(glm::mat4(1), _position);
   auto scale = glm::scale(glm::mat4(1), _scale);
   auto rotate = glm::toMat4(_rotation);
   _model = translate * scale * rotate;
+  _world_bounds = _mesh.bounds().transformed(_model);
+  _world_bounding_sphere = _mesh.bounding_sphere().transformed(_model);
+  if (bvh) bvh->move(bvh_proxy, _world_bounds);
+}
+
+inline float Object::raycast(const Ray &ray, float max_t) const {
+  if (ray.intersect(_world_bounds, max_t) >= max_t) return max_t;
+
+  auto local_ray = ray.transformed(glm::inverse(_model));
+  const auto &vertices = _mesh.vertices();
+  for (const auto &triangle : _mesh.triangles()) {
+    max_t = local_ray.intersect(vertices[triangle.x], vertices[triangle.y],
+                                vertices[triangle.z], max_t);
+  }
+  return max_t;
 }
 
 GLE_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef GLE_OCCLUSION_HPP
+#define GLE_OCCLUSION_HPP
+
+#include <cstddef>
+#include <gle/bounds.hpp>
+#include <gle/common.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+/// @brief Get the fraction of the view height covered by a bounding sphere
+///
+/// @param view_projection a perspective or orthographic view projection
+/// @param sphere
+/// @return float
+inline float view_fraction(const glm::mat4 &view_projection,
+                           const BoundingSphere &sphere);
+} // namespace __internal__
+
+/// @brief Tests if objects are hidden behind the occluders of a frame
+///
+class OcclusionCuller {
+public:
+  inline virtual ~OcclusionCuller();
+
+  /// @brief Check if world space bounds may be visible
+  ///
+  /// @pure
+  /// @param bounds
+  /// @return false only if the bounds are hidden behind the occluders
+  virtual bool visible(const AABB &bounds) const = 0;
+};
+
+/// @brief A hierarchical-Z pyramid, the mip chain of a depth buffer where
+///        each texel is the largest depth of the four texels below it
+///
+/// A box whose closest depth is behind the largest depth of the texels its
+/// screen rectangle covers is hidden. The rectangle is tested at the level
+/// where it covers at most 2x2 texels, so every test reads four texels.
+class DepthPyramid : public OcclusionCuller {
+public:
+  DepthPyramid(DepthPyramid &) = delete;
+  DepthPyramid(DepthPyramid &&) = delete;
+  DepthPyramid(const DepthPyramid &) = delete;
+  DepthPyramid(const DepthPyramid &&) = delete;
+
+  /// @brief Construct an empty pyramid, that culls nothing
+  ///
+  inline DepthPyramid();
+
+  /// @brief Build the pyramid of a depth buffer
+  ///
+  /// @param depth window space depths in [0, 1], in rows from the bottom of
+  ///        the screen as read by glReadPixels
+  /// @param width
+  /// @param height
+  /// @param view_projection the matrix the depth buffer was rendered with
+  inline void build(const float *depth, std::size_t width, std::size_t height,
+                    const glm::mat4 &view_projection);
+
+  /// @brief Empty the pyramid, so it culls nothing
+  ///
+  inline void clear();
+
+  /// @brief Check if world space bounds may be visible from the view
+  ///        projection of the depth buffer
+  ///
+  /// Bounds crossing the near plane or outside the screen are visible.
+  ///
+  /// @param bounds
+  /// @return bool
+  inline virtual bool visible(const AABB &bounds) const override;
+
+  /// @brief Check if the pyramid was built
+  ///
+  /// @return bool
+  inline bool empty() const;
+
+  /// @brief Get the number of levels, the first one is the depth buffer
+  ///
+  /// @return std::size_t
+  inline std::size_t num_levels() const;
+
+  /// @brief Get the size in texels of a level
+  ///
+  /// @param level
+  /// @return glm::uvec2
+  inline glm::uvec2 size(std::size_t level) const;
+
+  /// @brief Get the depth of a texel
+  ///
+  /// @param level
+  /// @param x
+  /// @param y
+  /// @return float
+  inline float depth(std::size_t level, std::size_t x, std::size_t y) const;
+
+  /// @brief Get the view projection matrix of the depth buffer
+  ///
+  /// @return const glm::mat4&
+  inline const glm::mat4 &view_projection() const;
+
+private:
+  // Each level is half the size of the one below it, rounded up
+  std::vector<std::vector<float>> levels;
+  std::vector<glm::uvec2> sizes;
+  glm::mat4 _view_projection;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_OCCLUSION_HPP
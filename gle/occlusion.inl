@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <limits>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+inline float view_fraction(const glm::mat4 &view_projection,
+                           const BoundingSphere &sphere) {
+  auto w = (view_projection * glm::vec4(sphere.center, 1.0f)).w;
+  // The view rotation keeps the length of the y row of the projection
+  auto scale = glm::length(glm::vec3(view_projection[0][1],
+                                     view_projection[1][1],
+                                     view_projection[2][1]));
+  return sphere.radius * scale / std::max(w, 1e-6f);
+}
+} // namespace __internal__
+
+inline OcclusionCuller::~OcclusionCuller() {}
+
+inline DepthPyramid::DepthPyramid() : _view_projection(1.0f) {}
+
+inline void DepthPyramid::build(const float *depth, std::size_t width,
+                                std::size_t height,
+                                const glm::mat4 &view_projection) {
+  if (width == 0 || height == 0) {
+    clear();
+    return;
+  }
+  _view_projection = view_projection;
+  sizes.clear();
+  auto size = glm::uvec2(width, height);
+  sizes.push_back(size);
+  while (size.x > 1 || size.y > 1) {
+    size = (size + 1u) / 2u;
+    sizes.push_back(size);
+  }
+
+  // The vectors are kept from frame to frame
+  levels.resize(sizes.size());
+  levels[0].assign(depth, depth + width * height);
+  for (std::size_t level = 1; level < sizes.size(); level++) {
+    const auto &below = levels[level - 1];
+    auto below_size = sizes[level - 1];
+    auto &texels = levels[level];
+    texels.resize(sizes[level].x * sizes[level].y);
+    for (std::size_t y = 0; y < sizes[level].y; y++) {
+      // The last row or column of an odd level has no neighbor
+      auto y0 = 2 * y * below_size.x;
+      auto y1 = std::min<std::size_t>(2 * y + 1, below_size.y - 1) *
+                below_size.x;
+      for (std::size_t x = 0; x < sizes[level].x; x++) {
+        auto x0 = 2 * x;
+        auto x1 = std::min<std::size_t>(2 * x + 1, below_size.x - 1);
+        texels[y * sizes[level].x + x] =
+            std::max({below[y0 + x0], below[y0 + x1], below[y1 + x0],
+                      below[y1 + x1]});
+      }
+    }
+  }
+}
+
+inline void DepthPyramid::clear() {
+  levels.clear();
+  sizes.clear();
+}
+
+inline bool DepthPyramid::visible(const AABB &bounds) const {
+  if (levels.empty()) return true;
+
+  auto min_ndc = glm::vec3(std::numeric_limits<float>::max());
+  auto max_ndc = glm::vec2(std::numeric_limits<float>::lowest());
+  for (int i = 0; i < 8; i++) {
+    auto corner = glm::vec3(i & 1 ? bounds.max.x : bounds.min.x,
+                            i & 2 ? bounds.max.y : bounds.min.y,
+                            i & 4 ? bounds.max.z : bounds.min.z);
+    auto clip = _view_projection * glm::vec4(corner, 1.0f);
+    // The projection of points behind the near plane is meaningless
+    if (clip.w <= 0.0f || clip.z < -clip.w) return true;
+    auto ndc = glm::vec3(clip) / clip.w;
+    min_ndc = glm::min(min_ndc, ndc);
+    max_ndc = glm::max(max_ndc, glm::vec2(ndc));
+  }
+  // Nothing is known outside of the screen
+  if (max_ndc.x < -1.0f || max_ndc.y < -1.0f || min_ndc.x > 1.0f ||
+      min_ndc.y > 1.0f)
+    return true;
+
+  auto to_texel = [](float ndc, unsigned size) {
+    return (std::size_t)std::clamp((ndc * 0.5f + 0.5f) * (float)size, 0.0f,
+                                   (float)size - 1.0f);
+  };
+  auto x0 = to_texel(min_ndc.x, sizes[0].x);
+  auto x1 = to_texel(max_ndc.x, sizes[0].x);
+  auto y0 = to_texel(min_ndc.y, sizes[0].y);
+  auto y1 = to_texel(max_ndc.y, sizes[0].y);
+  std::size_t level = 0;
+  while (level + 1 < levels.size() &&
+         ((x1 >> level) - (x0 >> level) > 1 ||
+          (y1 >> level) - (y0 >> level) > 1)) {
+    level++;
+  }
+
+  auto max_depth = 0.0f;
+  for (auto y = y0 >> level; y <= y1 >> level; y++) {
+    for (auto x = x0 >> level; x <= x1 >> level; x++) {
+      max_depth = std::max(max_depth, depth(level, x, y));
+    }
+  }
+  // The GPU and the CPU round the depth of the same surface differently
+  auto closest = min_ndc.z * 0.5f + 0.5f;
+  return closest <= max_depth + 1e-6f;
+}
+
+inline bool DepthPyramid::empty() const { return levels.empty(); }
+
+inline std::size_t DepthPyramid::num_levels() const { return levels.size(); }
+
+inline glm::uvec2 DepthPyramid::size(std::size_t level) const {
+  return sizes.at(level);
+}
+
+inline float DepthPyramid::depth(std::size_t level, std::size_t x,
+                                 std::size_t y) const {
+  return levels[level][y * sizes[level].x + x];
+}
+
+inline const glm::mat4 &DepthPyramid::view_projection() const {
+  return _view_projection;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <gle/camera.hpp>
+
+TEST_CASE("DepthPyramid culls boxes behind the occluders only") {
+  auto camera = gle::Camera(glm::vec3(0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 2.0f, glm::radians(90.0f),
+                            0.1f, 100.0f);
+  auto view_projection = camera.projection_matrix() * camera.view_matrix();
+
+  // A wall at z = -10 covering the left half of a 63x32 depth buffer
+  auto wall = view_projection * glm::vec4(0, 0, -10, 1);
+  auto wall_depth = wall.z / wall.w * 0.5f + 0.5f;
+  const std::size_t width = 63, height = 32;
+  auto depth = std::vector<float>(width * height, 1.0f);
+  for (std::size_t y = 0; y < height; y++) {
+    for (std::size_t x = 0; x < width / 2; x++) {
+      depth[y * width + x] = wall_depth;
+    }
+  }
+  auto pyramid = gle::DepthPyramid();
+  CHECK(pyramid.visible(gle::AABB{glm::vec3(-20), glm::vec3(-19)}));
+  pyramid.build(depth.data(), width, height, view_projection);
+
+  REQUIRE(pyramid.num_levels() == 7);
+  CHECK(pyramid.size(1) == glm::uvec2(32, 16));
+  CHECK(pyramid.size(6) == glm::uvec2(1, 1));
+  CHECK(pyramid.depth(1, 14, 0) == doctest::Approx(wall_depth));
+  CHECK(pyramid.depth(1, 15, 0) == 1.0f);
+  CHECK(pyramid.depth(6, 0, 0) == 1.0f);
+
+  auto box = [](glm::vec3 center) {
+    return gle::AABB{center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+  };
+  CHECK_FALSE(pyramid.visible(box(glm::vec3(-8, 0, -20))));
+  CHECK(pyramid.visible(box(glm::vec3(8, 0, -20))));
+  CHECK(pyramid.visible(box(glm::vec3(-2, 0, -5))));
+  // Straddling the edge of the wall
+  CHECK(pyramid.visible(box(glm::vec3(0, 0, -20))));
+  // Crossing the near plane
+  CHECK(pyramid.visible(gle::AABB{glm::vec3(-8, -1, -20),
+                                  glm::vec3(-7, 1, 1)}));
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef GLE_OCCLUSION_RASTERIZER_HPP
+#define GLE_OCCLUSION_RASTERIZER_HPP
+
+#include <cstddef>
+#include <gle/bounds.hpp>
+#include <gle/common.hpp>
+#include <gle/occlusion.hpp>
+#include <gle/parallel.hpp>
+#include <gle/scene.hpp>
+#include <glm/glm.hpp>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of the CPU occlusion rasterizer
+///
+struct OcclusionRasterizerOptions {
+  /// @brief the width in pixels of the depth buffer, a multiple of 8
+  ///
+  unsigned width = 256;
+
+  /// @brief the height in pixels of the depth buffer
+  ///
+  unsigned height = 128;
+
+  /// @brief the smallest fraction of the view height the bounding sphere of
+  ///        an object must cover for update() to rasterize it
+  ///
+  float min_occluder_size = 0.1f;
+
+  /// @brief the number of threads rasterizing bands of rows, 1 to rasterize
+  ///        on the calling thread and 0 for std::thread::hardware_concurrency()
+  ///
+  unsigned num_threads = 1;
+};
+
+namespace __internal__ {
+/// @brief A screen space triangle set up for rasterization
+///
+/// The edge functions and the depth are planes over the pixel coordinates,
+/// evaluated at the pixel centers: a pixel is covered when the three edge
+/// functions are positive.
+struct OcclusionTriangle {
+  /// @brief the first and last covered column and row, inclusive
+  ///
+  glm::ivec4 bounds;
+
+  /// @brief the x coefficient of each edge function
+  ///
+  glm::vec3 edge_x;
+
+  /// @brief the y coefficient of each edge function
+  ///
+  glm::vec3 edge_y;
+
+  /// @brief the constant of each edge function
+  ///
+  glm::vec3 edge_c;
+
+  /// @brief the depth is depth.x * x + depth.y * y + depth.z
+  ///
+  glm::vec3 depth;
+};
+
+/// @brief Set up a triangle given in pixel coordinates and window depth
+///
+/// @param p0
+/// @param p1
+/// @param p2 counter-clockwise from p0 and p1
+/// @param width the size of the depth buffer
+/// @param height
+/// @param triangle set if it covers a pixel center
+/// @return false if the triangle faces away or covers no pixel center
+inline bool setup_occlusion_triangle(const glm::vec3 &p0, const glm::vec3 &p1,
+                                     const glm::vec3 &p2, int width, int height,
+                                     OcclusionTriangle &triangle);
+
+/// @brief Rasterize triangles in some rows of a depth buffer one pixel at a
+///        time, keeping the closest depth
+///
+/// @param triangles
+/// @param depth the depth buffer, width pixels per row
+/// @param width
+/// @param first_row
+/// @param last_row the row after the last one
+inline void
+rasterize_rows_scalar(const std::vector<OcclusionTriangle> &triangles,
+                      float *depth, std::size_t width, std::size_t first_row,
+                      std::size_t last_row);
+
+/// @brief Rasterize triangles in some rows of a depth buffer 8 pixels at a
+///        time with AVX2 or 4 pixels at a time with SSE2, and with
+///        rasterize_rows_scalar without either
+///
+/// @param triangles
+/// @param depth the depth buffer, width pixels per row
+/// @param width a multiple of 8
+/// @param first_row
+/// @param last_row the row after the last one
+inline void rasterize_rows(const std::vector<OcclusionTriangle> &triangles,
+                           float *depth, std::size_t width,
+                           std::size_t first_row, std::size_t last_row);
+} // namespace __internal__
+
+/// @brief A small depth buffer rasterized on the CPU from occluder meshes
+///
+/// Objects are tested against the DepthPyramid of the depth buffer, without
+/// any GL context or readback latency. Triangles crossing the near plane or
+/// facing away are skipped, which only makes the buffer hide less. The rows
+/// are split into bands rasterized by different threads.
+class OcclusionRasterizer : public OcclusionCuller {
+public:
+  OcclusionRasterizer(OcclusionRasterizer &) = delete;
+  OcclusionRasterizer(OcclusionRasterizer &&) = delete;
+  OcclusionRasterizer(const OcclusionRasterizer &) = delete;
+  OcclusionRasterizer(const OcclusionRasterizer &&) = delete;
+
+  /// @brief Construct a rasterizer
+  ///
+  /// @param options
+  inline explicit OcclusionRasterizer(OcclusionRasterizerOptions options = {});
+
+  /// @brief Start a frame, the occluders are added seen from view_projection
+  ///
+  /// @param view_projection
+  inline void begin(const glm::mat4 &view_projection);
+
+  /// @brief Add the triangles of an occluder
+  ///
+  /// @param vertices
+  /// @param triangles counter-clockwise when seen from the front
+  /// @param model
+  inline void add(const std::vector<glm::vec3> &vertices,
+                  const std::vector<glm::uvec3> &triangles,
+                  const glm::mat4 &model);
+
+  /// @brief Rasterize the added occluders and build the pyramid
+  ///
+  inline void end();
+
+  /// @brief Rasterize the objects of a scene large enough in a view
+  ///
+  /// @param scene
+  /// @param view_projection
+  /// @param is_occluder bool(const Object &), objects for which it is false
+  ///        are never rasterized
+  template <class F>
+  inline void update(const Scene &scene, const glm::mat4 &view_projection,
+                     F &&is_occluder);
+
+  /// @brief Rasterize the objects of a scene large enough from its camera
+  ///
+  /// @param scene
+  inline void update(const Scene &scene);
+
+  /// @brief Check if world space bounds may be visible, against the last
+  ///        depth buffer rasterized
+  ///
+  /// @param bounds
+  /// @return bool
+  inline virtual bool visible(const AABB &bounds) const override;
+
+  /// @brief Get the depth of a pixel of the last depth buffer rasterized,
+  ///        end() must have been called
+  ///
+  /// @param x
+  /// @param y from the bottom
+  /// @return float the window space depth, 1 where nothing was rasterized
+  inline float depth(std::size_t x, std::size_t y) const;
+
+  /// @brief Get the pyramid of the last depth buffer rasterized
+  ///
+  /// @return const DepthPyramid&
+  inline const DepthPyramid &pyramid() const;
+
+  /// @brief Get the number of triangles rasterized by the last end(), after
+  ///        skipping the ones facing away or crossing the near plane
+  ///
+  /// @return std::size_t
+  inline std::size_t num_triangles() const;
+
+  /// @brief Get the number of occluders added since begin()
+  ///
+  /// @return std::size_t
+  inline std::size_t num_occluders() const;
+
+  /// @brief Get the options
+  ///
+  /// @return const OcclusionRasterizerOptions&
+  inline const OcclusionRasterizerOptions &options() const;
+
+private:
+  OcclusionRasterizerOptions _options;
+  glm::mat4 _view_projection;
+  std::vector<float> _depth;
+  // The vertices of the last occluder in pixels and window depth
+  std::vector<glm::vec3> screen;
+  std::vector<__internal__::OcclusionTriangle> screen_triangles;
+  std::size_t _num_triangles = 0;
+  std::size_t _num_occluders = 0;
+  DepthPyramid _pyramid;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_OCCLUSION_RASTERIZER_HPP
@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#  include <immintrin.h>
+#endif
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+inline bool setup_occlusion_triangle(const glm::vec3 &p0, const glm::vec3 &p1,
+                                     const glm::vec3 &p2, int width, int height,
+                                     OcclusionTriangle &triangle) {
+  auto e1 = p1 - p0;
+  auto e2 = p2 - p0;
+  auto area = e1.x * e2.y - e2.x * e1.y;
+  // Facing away or degenerate, also false for NaN
+  if (!(area > 0.0f)) return false;
+
+  // The pixels whose center is in the bounding box. Clamped to the screen
+  // the coordinates are positive, so truncating rounds them down, which is
+  // much faster than std::floor without SSE4.1.
+  auto min = glm::max(glm::vec2(glm::min(glm::min(p0, p1), p2)) - 0.5f, 0.0f);
+  auto max = glm::vec2(glm::max(glm::max(p0, p1), p2)) - 0.5f;
+  if (max.x < 0.0f || max.y < 0.0f) return false;
+  max = glm::min(max, glm::vec2(width - 1, height - 1));
+  auto first = glm::ivec2(min);
+  first += glm::ivec2(glm::lessThan(glm::vec2(first), min));
+  auto last = glm::ivec2(max);
+  auto bounds = glm::ivec4(first.x, first.y, last.x, last.y);
+  if (bounds.x > bounds.z || bounds.y > bounds.w) return false;
+  triangle.bounds = bounds;
+
+  // Edge i goes from point i to the next one, positive on its left
+  const glm::vec3 *points[3] = {&p0, &p1, &p2};
+  for (int i = 0; i < 3; i++) {
+    const auto &a = *points[i];
+    const auto &b = *points[(i + 1) % 3];
+    triangle.edge_x[i] = a.y - b.y;
+    triangle.edge_y[i] = b.x - a.x;
+    triangle.edge_c[i] = (b.y - a.y) * a.x - (b.x - a.x) * a.y;
+  }
+  auto dz_dx = (e1.z * e2.y - e2.z * e1.y) / area;
+  auto dz_dy = (e1.x * e2.z - e2.x * e1.z) / area;
+  triangle.depth = glm::vec3(dz_dx, dz_dy, p0.z - dz_dx * p0.x - dz_dy * p0.y);
+
+  // Move the planes to the pixel centers
+  triangle.edge_c += 0.5f * (triangle.edge_x + triangle.edge_y);
+  triangle.depth.z += 0.5f * (dz_dx + dz_dy);
+  return true;
+}
+
+inline void
+rasterize_rows_scalar(const std::vector<OcclusionTriangle> &triangles,
+                      float *depth, std::size_t width, std::size_t first_row,
+                      std::size_t last_row) {
+  for (const auto &triangle : triangles) {
+    auto y0 = std::max(triangle.bounds.y, (int)first_row);
+    auto y1 = std::min(triangle.bounds.w, (int)last_row - 1);
+    for (auto y = y0; y <= y1; y++) {
+      auto fy = (float)y;
+      auto row_edge = triangle.edge_y * fy + triangle.edge_c;
+      auto row_depth = triangle.depth.y * fy + triangle.depth.z;
+      auto row = depth + y * width;
+      for (auto x = triangle.bounds.x; x <= triangle.bounds.z; x++) {
+        auto fx = (float)x;
+        auto edge = triangle.edge_x * fx + row_edge;
+        if (edge.x < 0.0f || edge.y < 0.0f || edge.z < 0.0f) continue;
+        row[x] = std::min(row[x], triangle.depth.x * fx + row_depth);
+      }
+    }
+  }
+}
+
+inline void rasterize_rows(const std::vector<OcclusionTriangle> &triangles,
+                           float *depth, std::size_t width,
+                           std::size_t first_row, std::size_t last_row) {
+  // Each step tests the pixels from an aligned x, the width being a multiple
+  // of 8 the last step stays in the row. Pixels outside the bounding box
+  // fail the edge tests.
+#if defined(__AVX2__)
+  const auto lanes = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  const auto zero = _mm256_setzero_ps();
+  for (const auto &triangle : triangles) {
+    auto y0 = std::max(triangle.bounds.y, (int)first_row);
+    auto y1 = std::min(triangle.bounds.w, (int)last_row - 1);
+    auto edge_x0 = _mm256_set1_ps(triangle.edge_x.x);
+    auto edge_x1 = _mm256_set1_ps(triangle.edge_x.y);
+    auto edge_x2 = _mm256_set1_ps(triangle.edge_x.z);
+    auto depth_x = _mm256_set1_ps(triangle.depth.x);
+    for (auto y = y0; y <= y1; y++) {
+      auto fy = (float)y;
+      auto row_edge = triangle.edge_y * fy + triangle.edge_c;
+      auto row_edge0 = _mm256_set1_ps(row_edge.x);
+      auto row_edge1 = _mm256_set1_ps(row_edge.y);
+      auto row_edge2 = _mm256_set1_ps(row_edge.z);
+      auto row_depth = _mm256_set1_ps(triangle.depth.y * fy + triangle.depth.z);
+      auto row = depth + y * width;
+      for (auto x = triangle.bounds.x & ~7; x <= triangle.bounds.z; x += 8) {
+        auto fx = _mm256_add_ps(_mm256_set1_ps((float)x), lanes);
+        auto edge0 = _mm256_add_ps(_mm256_mul_ps(edge_x0, fx), row_edge0);
+        auto edge1 = _mm256_add_ps(_mm256_mul_ps(edge_x1, fx), row_edge1);
+        auto edge2 = _mm256_add_ps(_mm256_mul_ps(edge_x2, fx), row_edge2);
+        auto inside = _mm256_and_ps(
+            _mm256_and_ps(_mm256_cmp_ps(edge0, zero, _CMP_GE_OQ),
+                          _mm256_cmp_ps(edge1, zero, _CMP_GE_OQ)),
+            _mm256_cmp_ps(edge2, zero, _CMP_GE_OQ));
+        if (_mm256_movemask_ps(inside) == 0) continue;
+        auto z = _mm256_add_ps(_mm256_mul_ps(depth_x, fx), row_depth);
+        auto old = _mm256_loadu_ps(row + x);
+        _mm256_storeu_ps(
+            row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+      }
+    }
+  }
+#elif defined(__SSE2__)
+  const auto lanes = _mm_setr_ps(0, 1, 2, 3);
+  const auto zero = _mm_setzero_ps();
+  for (const auto &triangle : triangles) {
+    auto y0 = std::max(triangle.bounds.y, (int)first_row);
+    auto y1 = std::min(triangle.bounds.w, (int)last_row - 1);
+    auto edge_x0 = _mm_set1_ps(triangle.edge_x.x);
+    auto edge_x1 = _mm_set1_ps(triangle.edge_x.y);
+    auto edge_x2 = _mm_set1_ps(triangle.edge_x.z);
+    auto depth_x = _mm_set1_ps(triangle.depth.x);
+    for (auto y = y0; y <= y1; y++) {
+      auto fy = (float)y;
+      auto row_edge = triangle.edge_y * fy + triangle.edge_c;
+      auto row_edge0 = _mm_set1_ps(row_edge.x);
+      auto row_edge1 = _mm_set1_ps(row_edge.y);
+      auto row_edge2 = _mm_set1_ps(row_edge.z);
+      auto row_depth = _mm_set1_ps(triangle.depth.y * fy + triangle.depth.z);
+      auto row = depth + y * width;
+      for (auto x = triangle.bounds.x & ~3; x <= triangle.bounds.z; x += 4) {
+        auto fx = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+        auto edge0 = _mm_add_ps(_mm_mul_ps(edge_x0, fx), row_edge0);
+        auto edge1 = _mm_add_ps(_mm_mul_ps(edge_x1, fx), row_edge1);
+        auto edge2 = _mm_add_ps(_mm_mul_ps(edge_x2, fx), row_edge2);
+        auto inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge0, zero),
+                                            _mm_cmpge_ps(edge1, zero)),
+                                 _mm_cmpge_ps(edge2, zero));
+        if (_mm_movemask_ps(inside) == 0) continue;
+        auto z = _mm_add_ps(_mm_mul_ps(depth_x, fx), row_depth);
+        auto old = _mm_loadu_ps(row + x);
+        // SSE2 has no blend, select with the mask
+        auto closest = _mm_min_ps(old, z);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, closest),
+                                         _mm_andnot_ps(inside, old)));
+      }
+    }
+  }
+#else
+  rasterize_rows_scalar(triangles, depth, width, first_row, last_row);
+#endif
+}
+
+} // namespace __internal__
+
+inline OcclusionRasterizer::OcclusionRasterizer(
+    OcclusionRasterizerOptions options)
+    : _options(options), _view_projection(1.0f) {
+  if (options.width == 0 || options.width % 8 != 0 || options.height == 0)
+    throw std::runtime_error(
+        "occlusion buffer width must be a multiple of 8 and height positive");
+}
+
+inline void OcclusionRasterizer::begin(const glm::mat4 &view_projection) {
+  _view_projection = view_projection;
+  _depth.assign((std::size_t)_options.width * _options.height, 1.0f);
+  screen_triangles.clear();
+  _num_occluders = 0;
+}
+
+inline void OcclusionRasterizer::add(const std::vector<glm::vec3> &vertices,
+                                     const std::vector<glm::uvec3> &triangles,
+                                     const glm::mat4 &model) {
+  _num_occluders++;
+  auto transform = _view_projection * model;
+  auto size = glm::vec2(_options.width, _options.height);
+  screen.resize(vertices.size());
+  for (std::size_t i = 0; i < vertices.size(); i++) {
+    auto clip = transform * glm::vec4(vertices[i], 1.0f);
+    // Clipping would only add occluder area close to the camera, the NaN
+    // vertices make the setup skip their triangles
+    if (clip.w <= 0.0f || clip.z < -clip.w) {
+      screen[i] = glm::vec3(std::numeric_limits<float>::quiet_NaN());
+      continue;
+    }
+    auto ndc = glm::vec3(clip) / clip.w;
+    screen[i] = glm::vec3((glm::vec2(ndc) * 0.5f + 0.5f) * size,
+                          ndc.z * 0.5f + 0.5f);
+  }
+
+  auto triangle = __internal__::OcclusionTriangle();
+  for (const auto &indices : triangles) {
+    if (__internal__::setup_occlusion_triangle(
+            screen[indices.x], screen[indices.y], screen[indices.z],
+            _options.width, _options.height, triangle))
+      screen_triangles.push_back(triangle);
+  }
+}
+
+inline void OcclusionRasterizer::end() {
+  auto num_threads = _options.num_threads > 0
+                         ? _options.num_threads
+                         : std::thread::hardware_concurrency();
+  __internal__::parallel_for(
+      _options.height, num_threads, [&](std::size_t first, std::size_t last) {
+        __internal__::rasterize_rows(screen_triangles, _depth.data(),
+                                     _options.width, first, last);
+      });
+  _num_triangles = screen_triangles.size();
+  _pyramid.build(_depth.data(), _options.width, _options.height,
+                 _view_projection);
+}
+
+template <class F>
+inline void OcclusionRasterizer::update(const Scene &scene,
+                                        const glm::mat4 &view_projection,
+                                        F &&is_occluder) {
+  begin(view_projection);
+  auto frustum = Frustum::from_matrix(view_projection);
+  scene.bvh().query(frustum, [&](Object *object) {
+    if (!is_occluder(*object)) return;
+    if (!frustum.intersects(object->world_bounds())) return;
+    if (__internal__::view_fraction(view_projection,
+                                    object->world_bounding_sphere()) <
+        _options.min_occluder_size)
+      return;
+    const auto &mesh = object->mesh();
+    add(mesh.vertices(), mesh.triangles(), object->model_matrix());
+  });
+  end();
+}
+
+inline void OcclusionRasterizer::update(const Scene &scene) {
+  const auto &camera = scene.camera();
+  update(scene, camera.projection_matrix() * camera.view_matrix(),
+         [](const Object &) { return true; });
+}
+
+inline bool OcclusionRasterizer::visible(const AABB &bounds) const {
+  return _pyramid.visible(bounds);
+}
+
+inline float OcclusionRasterizer::depth(std::size_t x, std::size_t y) const {
+  return _pyramid.depth(0, x, y);
+}
+
+inline const DepthPyramid &OcclusionRasterizer::pyramid() const {
+  return _pyramid;
+}
+
+inline std::size_t OcclusionRasterizer::num_triangles() const {
+  return _num_triangles;
+}
+
+inline std::size_t OcclusionRasterizer::num_occluders() const {
+  return _num_occluders;
+}
+
+inline const OcclusionRasterizerOptions &OcclusionRasterizer::options() const {
+  return _options;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <random>
+
+TEST_CASE("OcclusionRasterizer hides boxes behind a wall") {
+  auto camera = gle::Camera(glm::vec3(0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 2.0f, glm::radians(90.0f),
+                            0.1f, 100.0f);
+  auto view_projection = camera.projection_matrix() * camera.view_matrix();
+
+  // A wall at z = -10 over the left half of the view, facing the camera
+  auto vertices = std::vector<glm::vec3>{
+      {-30, -15, -10}, {0, -15, -10}, {0, 15, -10}, {-30, 15, -10}};
+  auto front = std::vector<glm::uvec3>{{0, 1, 2}, {0, 2, 3}};
+  auto back = std::vector<glm::uvec3>{{0, 2, 1}, {0, 3, 2}};
+
+  auto options = gle::OcclusionRasterizerOptions();
+  options.num_threads = 3;
+  auto rasterizer = gle::OcclusionRasterizer(options);
+  rasterizer.begin(view_projection);
+  rasterizer.add(vertices, back, glm::mat4(1.0f));
+  rasterizer.end();
+  CHECK(rasterizer.num_triangles() == 0);
+  CHECK(rasterizer.depth(64, 64) == 1.0f);
+
+  rasterizer.begin(view_projection);
+  rasterizer.add(vertices, front, glm::mat4(1.0f));
+  rasterizer.end();
+  CHECK(rasterizer.num_triangles() == 2);
+  auto wall = view_projection * glm::vec4(0, 0, -10, 1);
+  CHECK(rasterizer.depth(64, 64) == doctest::Approx(wall.z / wall.w * 0.5f +
+                                                     0.5f));
+  CHECK(rasterizer.depth(192, 64) == 1.0f);
+
+  auto box = [](glm::vec3 center) {
+    return gle::AABB{center - glm::vec3(0.5f), center + glm::vec3(0.5f)};
+  };
+  CHECK_FALSE(rasterizer.visible(box(glm::vec3(-8, 0, -20))));
+  CHECK(rasterizer.visible(box(glm::vec3(8, 0, -20))));
+  CHECK(rasterizer.visible(box(glm::vec3(-2, 0, -5))));
+  CHECK(rasterizer.visible(box(glm::vec3(0, 0, -20))));
+
+  CHECK_THROWS_AS(gle::OcclusionRasterizer(gle::OcclusionRasterizerOptions{
+                      100, 50}),
+                  std::runtime_error);
+}
+
+TEST_CASE("__internal__::rasterize_rows matches the scalar rasterizer") {
+  const int width = 64, height = 32;
+  auto random = std::mt19937(7);
+  auto coordinate = std::uniform_real_distribution<float>(-8.0f, 72.0f);
+  auto depth = std::uniform_real_distribution<float>(0.0f, 1.0f);
+  auto triangles = std::vector<gle::__internal__::OcclusionTriangle>();
+  auto triangle = gle::__internal__::OcclusionTriangle();
+  while (triangles.size() < 200) {
+    auto point = [&]() {
+      return glm::vec3(coordinate(random), coordinate(random) * 0.5f,
+                       depth(random));
+    };
+    if (gle::__internal__::setup_occlusion_triangle(point(), point(), point(),
+                                                    width, height, triangle))
+      triangles.push_back(triangle);
+  }
+
+  auto scalar = std::vector<float>(width * height, 1.0f);
+  auto simd = std::vector<float>(width * height, 1.0f);
+  gle::__internal__::rasterize_rows_scalar(triangles, scalar.data(), width, 0,
+                                           height);
+  gle::__internal__::rasterize_rows(triangles, simd.data(), width, 0, height);
+  // The SIMD paths may round differently only if the compiler fuses the
+  // scalar multiplies and adds
+  std::size_t different = 0;
+  for (std::size_t i = 0; i < scalar.size(); i++) {
+    if (std::abs(scalar[i] - simd[i]) > 1e-5f) different++;
+  }
+  CHECK(different <= scalar.size() / 200);
+  CHECK(std::count(scalar.begin(), scalar.end(), 1.0f) < (long)scalar.size());
+}
+
+#endif
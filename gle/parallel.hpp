@@ -0,0 +1,22 @@
+#ifndef GLE_PARALLEL_HPP
+#define GLE_PARALLEL_HPP
+
+#include <cstddef>
+#include <gle/common.hpp>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+/// @brief Call fn(first, last) on num_threads disjoint ranges covering
+///        [0, count), on the calling thread if num_threads is 1
+///
+/// @param count
+/// @param num_threads
+/// @param fn
+template <class F>
+inline void parallel_for(std::size_t count, unsigned num_threads, F &&fn);
+} // namespace __internal__
+
+GLE_NAMESPACE_END
+
+#endif // GLE_PARALLEL_HPP
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+template <class F>
+inline void parallel_for(std::size_t count, unsigned num_threads, F &&fn) {
+  num_threads = (unsigned)std::max<std::size_t>(
+      1, std::min<std::size_t>(num_threads, count));
+  if (num_threads == 1) {
+    fn((std::size_t)0, count);
+    return;
+  }
+
+  auto threads = std::vector<std::thread>();
+  for (unsigned t = 0; t < num_threads; t++) {
+    std::size_t first = count * t / num_threads;
+    std::size_t last = count * (t + 1) / num_threads;
+    threads.emplace_back([&fn, first, last]() { fn(first, last); });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+} // namespace __internal__
+
+GLE_NAMESPACE_END
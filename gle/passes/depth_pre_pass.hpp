@@ -0,0 +1,53 @@
+#ifndef GLE_PASSES_DEPTH_PRE_PASS_HPP
+#define GLE_PASSES_DEPTH_PRE_PASS_HPP
+
+#include <cstdint>
+#include <gle/common.hpp>
+#include <gle/passes/object_render_pass.hpp>
+#include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
+#include <gle/shader.hpp>
+#include <memory>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Writes the depth of the objects whose material opts in, see
+///        Material::depth_prepass, so an ObjectRenderPass with
+///        ObjectRenderOptions::depth_prepass only shades their visible
+///        fragments
+///
+/// The objects are drawn front to back without writing color, with the
+/// level of detail and meshlets the object pass draws them with. The pass
+/// must be added right before the object pass and take the same options, so
+/// both queue the same objects.
+class DepthPrePass : public RenderPass {
+public:
+  DepthPrePass(DepthPrePass &) = delete;
+  DepthPrePass(DepthPrePass &&) = delete;
+  DepthPrePass(const DepthPrePass &) = delete;
+  DepthPrePass(const DepthPrePass &&) = delete;
+
+  /// @brief Construct a depth pre-pass
+  ///
+  /// @param options the options of the object pass
+  inline explicit DepthPrePass(ObjectRenderOptions options = {});
+
+  inline virtual void load(Scene &scene) override;
+  inline virtual void render(const Scene &scene) const override;
+
+  /// @brief Get the draws of the last rendered frame
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
+private:
+  ObjectRenderOptions options;
+  mutable RenderQueue queue;
+  mutable std::vector<std::uint32_t> visible_meshlets;
+  std::unique_ptr<Shader> shader;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_PASSES_DEPTH_PRE_PASS_HPP
@@ -0,0 +1,48 @@
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+const char *depth_pre_pass_vertex = R"(
+invariant gl_Position;
+
+void main() {
+  gl_Position = projection * view * model * vec4(position, 1.0);
+}
+)";
+const char *depth_pre_pass_fragment = R"(
+void main() {}
+)";
+} // namespace __internal__
+
+inline DepthPrePass::DepthPrePass(ObjectRenderOptions options)
+    : options(options) {
+  shader = std::make_unique<Shader>(__internal__::depth_pre_pass_vertex,
+                                    __internal__::depth_pre_pass_fragment);
+}
+
+inline void DepthPrePass::load(Scene &) { shader->load(); }
+
+inline void DepthPrePass::render(const Scene &scene) const {
+  queue.clear();
+  const auto &camera = scene.camera();
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  __internal__::queue_visible_objects(
+      scene, options, (float)viewport[3], visible_meshlets,
+      [&](const Object &object) {
+        return object.material().depth_prepass ? &queue : nullptr;
+      });
+  queue.sort_front_to_back();
+
+  auto uniforms =
+      MVPShaderUniforms(camera.view_matrix(), camera.projection_matrix());
+  auto arena = options.multi_draw_indirect ? scene.geometry_arena() : nullptr;
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  queue.submit(scene, uniforms, shader.get(), arena);
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+inline const RenderQueueStats &DepthPrePass::stats() const {
+  return queue.stats();
+}
+
+GLE_NAMESPACE_END
@@ -0,0 +1,100 @@
+#ifndef GLE_PASSES_HIZ_OCCLUSION_PASS_HPP
+#define GLE_PASSES_HIZ_OCCLUSION_PASS_HPP
+
+#include <array>
+#include <gle/common.hpp>
+#include <gle/occlusion.hpp>
+#include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
+#include <gle/shader.hpp>
+#include <map>
+#include <memory>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of the hierarchical-Z occlusion pass
+///
+struct HiZOcclusionOptions {
+  /// @brief the width in texels of the occluder depth buffer
+  ///
+  GLuint width = 256;
+
+  /// @brief the height in texels of the occluder depth buffer
+  ///
+  GLuint height = 128;
+
+  /// @brief the smallest fraction of the view height the bounding sphere of
+  ///        an object must cover for it to be an occluder
+  ///
+  float min_occluder_size = 0.1f;
+};
+
+/// @brief Renders the depth of the large objects to a small depth buffer and
+///        culls the objects hidden behind them, see
+///        ObjectRenderOptions::occlusion
+///
+/// The depth buffer is read back asynchronously and turned into a
+/// DepthPyramid once the GPU is done with it, so the objects of a frame are
+/// tested against the occluders of a previous frame, seen from the camera of
+/// that frame. Objects that were hidden may show up a frame late when the
+/// camera moves fast.
+class HiZOcclusionPass : public RenderPass, public OcclusionCuller {
+public:
+  HiZOcclusionPass(HiZOcclusionPass &) = delete;
+  HiZOcclusionPass(HiZOcclusionPass &&) = delete;
+  HiZOcclusionPass(const HiZOcclusionPass &) = delete;
+  HiZOcclusionPass(const HiZOcclusionPass &&) = delete;
+
+  /// @brief Construct an occlusion pass
+  ///
+  /// @param options
+  inline explicit HiZOcclusionPass(HiZOcclusionOptions options = {});
+  inline virtual ~HiZOcclusionPass();
+
+  inline virtual void load(Scene &scene) override;
+  inline virtual void render(const Scene &scene) const override;
+
+  /// @brief Check if world space bounds may be visible, against the last
+  ///        depth buffer read back
+  ///
+  /// @param bounds
+  /// @return bool
+  inline virtual bool visible(const AABB &bounds) const override;
+
+  /// @brief Get the pyramid of the last depth buffer read back
+  ///
+  /// @return const DepthPyramid&
+  inline const DepthPyramid &pyramid() const;
+
+  /// @brief Get the occluders and draws of the last rendered frame
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
+private:
+  // A depth buffer being copied to a pixel pack buffer
+  struct Readback {
+    GLuint pbo = 0;
+    GLsync fence = nullptr;
+    glm::mat4 view_projection = glm::mat4(1.0f);
+  };
+
+  // Build the pyramid of a readback, waiting for the GPU if wait is set
+  inline void consume(Readback &readback, bool wait) const;
+
+  HiZOcclusionOptions options;
+  mutable RenderQueueStats _stats;
+  // Model matrices of the occluders of each mesh, kept to reuse the vectors
+  mutable std::map<Mesh *, std::vector<glm::mat4>> instances;
+  mutable std::array<Readback, 2> readbacks;
+  mutable std::size_t frame = 0;
+  mutable DepthPyramid _pyramid;
+  std::unique_ptr<Shader> shader;
+  GLuint depth_fbo = 0;
+  GLuint depth_tex = 0;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_PASSES_HIZ_OCCLUSION_PASS_HPP
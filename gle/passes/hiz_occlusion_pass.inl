@@ -0,0 +1,153 @@
+#include <limits>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+const char *hiz_occlusion_pass_vertex = R"(
+#version 410
+
+in vec3 position;
+in mat4 model;
+
+uniform mat4 view_projection;
+
+void main() {
+  gl_Position = view_projection * model * vec4(position, 1.0);
+}
+)";
+const char *hiz_occlusion_pass_fragment = R"(
+#version 410
+
+void main() {}
+)";
+} // namespace __internal__
+
+inline HiZOcclusionPass::HiZOcclusionPass(HiZOcclusionOptions options)
+    : options(options) {
+  shader = std::make_unique<Shader>(__internal__::hiz_occlusion_pass_vertex,
+                                    __internal__::hiz_occlusion_pass_fragment,
+                                    false);
+}
+
+inline HiZOcclusionPass::~HiZOcclusionPass() {
+  for (auto &readback : readbacks) {
+    if (readback.fence) glDeleteSync(readback.fence);
+    if (readback.pbo) glDeleteBuffers(1, &readback.pbo);
+  }
+  if (depth_tex) glDeleteTextures(1, &depth_tex);
+  if (depth_fbo) glDeleteFramebuffers(1, &depth_fbo);
+}
+
+inline void HiZOcclusionPass::load(Scene &) {
+  shader->load();
+
+  glGenFramebuffers(1, &depth_fbo);
+  glGenTextures(1, &depth_tex);
+  glBindTexture(GL_TEXTURE_2D, depth_tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, options.width,
+               options.height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
+                         depth_tex, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  auto size = (GLsizeiptr)options.width * options.height * sizeof(float);
+  for (auto &readback : readbacks) {
+    glGenBuffers(1, &readback.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+inline void HiZOcclusionPass::consume(Readback &readback, bool wait) const {
+  if (!readback.fence) return;
+  auto status = wait ? glClientWaitSync(readback.fence,
+                                        GL_SYNC_FLUSH_COMMANDS_BIT,
+                                        std::numeric_limits<GLuint64>::max())
+                     : glClientWaitSync(readback.fence, 0, 0);
+  if (status == GL_TIMEOUT_EXPIRED) return;
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+  if (status == GL_WAIT_FAILED) return;
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+  auto size = (std::size_t)options.width * options.height;
+  auto depth = (const float *)glMapBufferRange(
+      GL_PIXEL_PACK_BUFFER, 0, size * sizeof(float), GL_MAP_READ_BIT);
+  if (depth) {
+    _pyramid.build(depth, options.width, options.height,
+                   readback.view_projection);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+inline void HiZOcclusionPass::render(const Scene &scene) const {
+  // The readback of the last frame is usually done by now. The one of the
+  // frame before, whose buffer is about to be reused, must be.
+  auto &current = readbacks[frame % readbacks.size()];
+  auto &last = readbacks[(frame + 1) % readbacks.size()];
+  consume(current, true);
+  consume(last, false);
+
+  const auto &camera = scene.camera();
+  const auto &frustum = camera.frustum();
+  auto view_projection = camera.projection_matrix() * camera.view_matrix();
+
+  _stats = RenderQueueStats();
+  for (auto &[mesh, models] : instances) {
+    models.clear();
+  }
+  scene.bvh().query(frustum, [&](Object *object) {
+    if (!frustum.intersects(object->world_bounds())) return;
+    if (__internal__::view_fraction(view_projection,
+                                    object->world_bounding_sphere()) <
+        options.min_occluder_size)
+      return;
+    instances[&object->mesh()].push_back(object->model_matrix());
+    _stats.objects++;
+  });
+  _stats.culled = scene.objects().size() - _stats.objects;
+
+  glViewport(0, 0, options.width, options.height);
+  glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  shader->use();
+  shader->uniform("view_projection", view_projection);
+  for (auto &[mesh, models] : instances) {
+    if (models.empty()) continue;
+    mesh->instances(models);
+    mesh->draw_depth();
+    _stats.draws++;
+  }
+
+  // Copy the depth to the pixel pack buffer without waiting for it
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, current.pbo);
+  glReadPixels(0, 0, options.width, options.height, GL_DEPTH_COMPONENT,
+               GL_FLOAT, NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  current.view_projection = view_projection;
+  frame++;
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+inline bool HiZOcclusionPass::visible(const AABB &bounds) const {
+  return _pyramid.visible(bounds);
+}
+
+inline const DepthPyramid &HiZOcclusionPass::pyramid() const {
+  return _pyramid;
+}
+
+inline const RenderQueueStats &HiZOcclusionPass::stats() const {
+  return _stats;
+}
+
+GLE_NAMESPACE_END
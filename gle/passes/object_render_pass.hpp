@@ -1,22 +1,126 @@
 #ifndef GLE_PASSES_OBJECT_RENDER_PASS_HPP
 #define GLE_PASSES_OBJECT_RENDER_PASS_HPP
 
+#include <cstdint>
 #include <gle/camera.hpp>
 #include <gle/common.hpp>
 #include <gle/object.hpp>
+#include <gle/occlusion.hpp>
 #include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
 #include <gle/scene.hpp>
 #include <gle/shaders/debug_shader.hpp>
 #include <memory>
+#include <vector>
 
 GLE_NAMESPACE_BEGIN
 
+/// @brief Options of the object render pass
+///
+struct ObjectRenderOptions {
+  /// @brief the largest error on screen, in pixels, of the level of detail
+  ///        drawn for each object, 0 always draws the full meshes
+  ///
+  float lod_pixel_error = 1.0f;
+
+  /// @brief if the meshlets of meshes that have some are culled one by one
+  ///        against the view frustum and for facing away from the camera
+  ///
+  bool meshlet_culling = true;
+
+  /// @brief if the objects whose mesh is in the scene geometry arena are
+  ///        drawn with multi draw indirect, when the context supports it
+  ///
+  bool multi_draw_indirect = true;
+
+  /// @brief if set, the objects it finds hidden behind occluders are not
+  ///        drawn, e.g. a HiZOcclusionPass added before this pass
+  ///
+  const OcclusionCuller *occlusion = nullptr;
+
+  /// @brief if a DepthPrePass with the same options wrote the depth of the
+  ///        objects whose material opts in, see Material::depth_prepass.
+  ///        They are drawn with a GL_EQUAL depth test, which only shades
+  ///        their visible fragments
+  ///
+  bool depth_prepass = false;
+};
+
+namespace __internal__ {
+/// @brief Get the largest mesh space error of the level of detail of an
+///        object for its error on screen to stay within some pixels
+///
+/// The error is projected at the point of the object bounding sphere closest
+/// to the camera, and scaled from mesh space to world space by the ratio of
+/// the object and mesh bounding sphere radii.
+///
+/// @param camera
+/// @param world_sphere the bounding sphere of the object
+/// @param mesh_sphere the bounding sphere of its mesh
+/// @param viewport_height the viewport height in pixels
+/// @param pixel_error the error allowed on screen
+/// @return float
+inline float lod_max_error(const Camera &camera,
+                           const BoundingSphere &world_sphere,
+                           const BoundingSphere &mesh_sphere,
+                           float viewport_height, float pixel_error);
+
+/// @brief Check if a transform scales every axis the same, so normal cones
+///        keep their angles
+///
+/// @param transform
+/// @return bool
+inline bool has_uniform_scale(const glm::mat4 &transform);
+
+/// @brief Queue the objects visible from the camera of a scene, with the
+///        level of detail and meshlets ObjectRenderPass draws them with
+///
+/// @param scene
+/// @param options
+/// @param viewport_height the viewport height in pixels
+/// @param visible_meshlets scratch space
+/// @param queue_of RenderQueue *(const Object &), the queue of an object or
+///        nullptr to skip it
+/// @return std::size_t the number of objects queued
+template <class F>
+inline std::size_t
+queue_visible_objects(const Scene &scene, const ObjectRenderOptions &options,
+                      float viewport_height,
+                      std::vector<std::uint32_t> &visible_meshlets,
+                      F &&queue_of);
+} // namespace __internal__
+
+/// @brief Draws the objects visible from the camera, each with the coarsest
+///        level of detail of its mesh that looks the same on screen
+///
+/// Objects drawn with the full mesh only draw the meshlets of the mesh that
+/// are in the view frustum and face the camera, when it has meshlets.
+/// Objects hidden behind occluders are skipped when the options have an
+/// occlusion culler. With a depth pre-pass, the objects it drew are drawn
+/// after the others with a GL_EQUAL depth test and without writing depth.
 class ObjectRenderPass : public RenderPass {
 public:
+  /// @brief Construct an object render pass
+  ///
+  /// @param options
+  inline explicit ObjectRenderPass(ObjectRenderOptions options = {});
+
   inline virtual void render(const Scene &scene) const override;
   inline virtual void load(Scene &scene) override;
 
+  /// @brief Get the draws and state changes of the last rendered frame
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
 private:
+  ObjectRenderOptions options;
+  mutable RenderQueue queue;
+  // The objects whose depth the pre-pass wrote
+  mutable RenderQueue equal_queue;
+  mutable RenderQueueStats _stats;
+  mutable std::vector<std::uint32_t> visible_meshlets;
+
 #ifdef GLE_DEBUG_LINES
   std::unique_ptr<DebugShader> debug_shader;
 #endif
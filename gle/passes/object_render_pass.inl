@@ -1,7 +1,86 @@
+#include <algorithm>
+#include <cmath>
 #include <glm/gtc/matrix_transform.hpp>
 
 GLE_NAMESPACE_BEGIN
 
+namespace __internal__ {
+inline float lod_max_error(const Camera &camera,
+                           const BoundingSphere &world_sphere,
+                           const BoundingSphere &mesh_sphere,
+                           float viewport_height, float pixel_error) {
+  auto distance = std::max(glm::distance(camera.origin(), world_sphere.center) -
+                               world_sphere.radius,
+                           camera.z_near());
+  // World space size of a pixel at that distance
+  auto pixel_size =
+      2.0f * distance * std::tan(camera.fov() * 0.5f) / viewport_height;
+  auto scale = mesh_sphere.radius > 0.0f
+                   ? world_sphere.radius / mesh_sphere.radius
+                   : 1.0f;
+  return pixel_error * pixel_size / scale;
+}
+
+inline bool has_uniform_scale(const glm::mat4 &transform) {
+  auto x = glm::length(glm::vec3(transform[0]));
+  auto y = glm::length(glm::vec3(transform[1]));
+  auto z = glm::length(glm::vec3(transform[2]));
+  auto tolerance = 1e-3f * std::max({x, y, z});
+  return std::abs(x - y) <= tolerance && std::abs(x - z) <= tolerance;
+}
+
+template <class F>
+inline std::size_t
+queue_visible_objects(const Scene &scene, const ObjectRenderOptions &options,
+                      float viewport_height,
+                      std::vector<std::uint32_t> &visible_meshlets,
+                      F &&queue_of) {
+  const auto &camera = scene.camera();
+  const auto &frustum = camera.frustum();
+  std::size_t queued = 0;
+  scene.bvh().query(frustum, [&](Object *object) {
+    // The BVH tests the fat bounds, test the exact ones too
+    if (!frustum.intersects(object->world_bounds())) return;
+    RenderQueue *queue = queue_of(*object);
+    if (!queue) return;
+    if (options.occlusion &&
+        !options.occlusion->visible(object->world_bounds()))
+      return;
+    auto &mesh = object->mesh();
+    std::size_t lod = 0;
+    if (mesh.num_lods() > 1 && options.lod_pixel_error > 0.0f) {
+      lod = mesh.select_lod(lod_max_error(
+          camera, object->world_bounding_sphere(), mesh.bounding_sphere(),
+          viewport_height, options.lod_pixel_error));
+    }
+    const auto &model = object->model_matrix();
+    if (lod == 0 && options.meshlet_culling && !mesh.meshlets().empty()) {
+      // Cull in mesh space, the frustum planes and the camera move into it
+      auto mesh_frustum = Frustum::from_matrix(camera.projection_matrix() *
+                                               camera.view_matrix() * model);
+      auto mesh_camera =
+          glm::vec3(glm::inverse(model) * glm::vec4(camera.origin(), 1.0f));
+      cull_meshlets(mesh.meshlets(), mesh_frustum, mesh_camera,
+                    has_uniform_scale(model), visible_meshlets);
+      if (visible_meshlets.empty()) return;
+      if (visible_meshlets.size() < mesh.meshlets().size()) {
+        queue->push_meshlets(camera, object->shader(), object->material(),
+                             mesh, model, visible_meshlets);
+        queued++;
+        return;
+      }
+    }
+    queue->push(camera, object->shader(), object->material(), mesh, model,
+                lod);
+    queued++;
+  });
+  return queued;
+}
+} // namespace __internal__
+
+inline ObjectRenderPass::ObjectRenderPass(ObjectRenderOptions options)
+    : options(options) {}
+
 inline void ObjectRenderPass::load(Scene &) {
 #ifdef GLE_DEBUG_LINES
   debug_shader = std::make_unique<DebugShader>();
@@ -10,19 +89,118 @@ inline void ObjectRenderPass::load(Scene &) {
 }
 
 inline void ObjectRenderPass::render(const Scene &scene) const {
-  for (const auto &object : scene.objects()) {
-    auto uniforms =
-        MVPShaderUniforms(object->model_matrix(), scene.camera().view_matrix(),
-                          scene.camera().projection_matrix());
+  queue.clear();
+  equal_queue.clear();
+  const auto &camera = scene.camera();
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  auto queued = __internal__::queue_visible_objects(
+      scene, options, (float)viewport[3], visible_meshlets,
+      [&](const Object &object) {
+        return options.depth_prepass && object.material().depth_prepass
+                   ? &equal_queue
+                   : &queue;
+      });
+  queue.cull(scene.objects().size() - queued);
+  queue.sort();
+  equal_queue.sort();
 
-    object->shader().use(scene, uniforms, object->material());
-    object->mesh().draw();
+  auto uniforms =
+      MVPShaderUniforms(camera.view_matrix(), camera.projection_matrix());
+  auto arena = options.multi_draw_indirect ? scene.geometry_arena() : nullptr;
+  queue.submit(scene, uniforms, nullptr, arena);
+  if (equal_queue.size() > 0) {
+    // The depth is already there, only the closest fragments pass
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+    equal_queue.submit(scene, uniforms, nullptr, arena);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+  }
 
 #ifdef GLE_DEBUG_LINES
-    debug_shader->use(scene, uniforms, object->material());
-    object->mesh().draw();
+  queue.submit(scene, uniforms, debug_shader.get(), arena);
+  equal_queue.submit(scene, uniforms, debug_shader.get(), arena);
 #endif
+
+  _stats = queue.stats();
+  _stats += equal_queue.stats();
+}
+
+inline const RenderQueueStats &ObjectRenderPass::stats() const {
+  return _stats;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("lod_max_error grows with the distance to the camera") {
+  auto camera = gle::Camera(glm::vec3(0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 1.0f, glm::radians(90.0f),
+                            0.1f, 1000.0f);
+  auto mesh_sphere = gle::BoundingSphere{glm::vec3(0), 1.0f};
+
+  // A pixel of a 1000 pixel high 90 degree view at distance 10 is 2cm
+  auto near = gle::__internal__::lod_max_error(
+      camera, gle::BoundingSphere{glm::vec3(0, 0, -11), 1.0f}, mesh_sphere,
+      1000.0f, 1.0f);
+  CHECK(near == doctest::Approx(0.02f));
+
+  auto far = gle::__internal__::lod_max_error(
+      camera, gle::BoundingSphere{glm::vec3(0, 0, -101), 1.0f}, mesh_sphere,
+      1000.0f, 1.0f);
+  CHECK(far == doctest::Approx(0.2f));
+
+  // Twice as large objects need half the mesh space error
+  auto scaled = gle::__internal__::lod_max_error(
+      camera, gle::BoundingSphere{glm::vec3(0, 0, -12), 2.0f}, mesh_sphere,
+      1000.0f, 1.0f);
+  CHECK(scaled == doctest::Approx(0.01f));
+}
+
+TEST_CASE("__internal__::queue_visible_objects queues each visible object "
+          "once") {
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &opaque = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  opaque.depth_prepass = true;
+  auto &other = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  auto &cube = scene.mesh(gle::make_cube_mesh());
+  for (int i = 0; i < 4; i++) {
+    scene.make_object(shader, opaque, cube, glm::vec3(i, 0, -5), glm::vec3(0),
+                      glm::vec3(1));
+    scene.make_object(shader, other, cube, glm::vec3(i, 0, -5), glm::vec3(0),
+                      glm::vec3(1));
   }
+  // Behind the camera
+  scene.make_object(shader, opaque, cube, glm::vec3(0, 0, 5), glm::vec3(0),
+                    glm::vec3(1));
+  scene.make_camera(glm::vec3(0), glm::vec3(0, 1, 0), glm::vec3(0, 0, -1),
+                    1.0f, glm::radians(90.0f), 0.1f, 100.0f);
+
+  auto options = gle::ObjectRenderOptions();
+  auto visible_meshlets = std::vector<std::uint32_t>();
+  gle::RenderQueue prepass, equal, rest;
+  auto queued = gle::__internal__::queue_visible_objects(
+      scene, options, 720.0f, visible_meshlets,
+      [&](const gle::Object &object) {
+        return object.material().depth_prepass ? &equal : &rest;
+      });
+  CHECK(queued == 8);
+  CHECK(equal.size() == 4);
+  CHECK(rest.size() == 4);
+
+  // The pre-pass skips the other material
+  queued = gle::__internal__::queue_visible_objects(
+      scene, options, 720.0f, visible_meshlets,
+      [&](const gle::Object &object) {
+        return object.material().depth_prepass ? &prepass : nullptr;
+      });
+  CHECK(queued == 4);
+  CHECK(prepass.size() == 4);
 }
 
-GLE_NAMESPACE_END
\ No newline at end of file
+#endif
@@ -0,0 +1,113 @@
+#ifndef GLE_PASSES_POINT_SHADOW_RENDER_PASS_HPP
+#define GLE_PASSES_POINT_SHADOW_RENDER_PASS_HPP
+
+#include <array>
+#include <gle/common.hpp>
+#include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
+#include <gle/shader.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Options of the point light shadow maps
+///
+struct PointShadowOptions {
+  /// @brief the size in texels of each cube map face
+  ///
+  GLuint resolution = 512;
+
+  /// @brief the number of point lights with a shadow map, the cube map array
+  ///        holds one cube map per light
+  ///
+  unsigned max_lights = 4;
+
+  /// @brief the depth bias against shadow acne, a fraction of the light
+  ///        radius
+  ///
+  float bias = 0.01f;
+};
+
+namespace __internal__ {
+/// @brief Give the wanted lights a layer of the cube map array
+///
+/// Lights that already have a layer keep it, so their cube map doesn't have
+/// to be rendered again. Layers of lights that are no longer wanted are
+/// cleared and reused for the new lights.
+///
+/// @param layers the light of each layer, nullptr for unused layers
+/// @param wanted the lights that should have a layer, at most layers.size()
+inline void
+assign_point_shadow_layers(std::vector<const Light *> &layers,
+                           const std::vector<const Light *> &wanted);
+
+/// @brief Get the view projection matrix of each cube map face of a point
+///        light, in the +x, -x, +y, -y, +z, -z face order of GL cube maps
+///
+/// @param position the light position
+/// @param radius the light radius, used as the far plane
+/// @return std::array<glm::mat4, 6>
+inline std::array<glm::mat4, 6> cube_face_matrices(const glm::vec3 &position,
+                                                   float radius);
+} // namespace __internal__
+
+/// @brief Renders cube shadow maps for the point lights closest to the camera
+///
+/// All six faces of a light are rendered in a single pass, a geometry shader
+/// sends every triangle to each face layer. A cube map is only rendered
+/// again when its light or a shadow caster within the light radius moved.
+class PointShadowRenderPass : public RenderPass {
+public:
+  /// @brief Construct a point light shadow pass
+  ///
+  /// @param options
+  inline explicit PointShadowRenderPass(PointShadowOptions options = {});
+  inline virtual void load(Scene &scene) override;
+  inline virtual void render(const Scene &scene) const override;
+
+  /// @brief Pick the lights with a shadow map and find the cube maps that
+  ///        need to be rendered again
+  ///
+  inline virtual void update(Scene &scene) override;
+
+  /// @brief Get the draws and casters of the last rendered frame, summed over
+  ///        the cube maps rendered
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
+  /// @brief Get the number of cube maps rendered in the last frame
+  ///
+  /// @return std::size_t
+  inline std::size_t updated_lights() const;
+
+private:
+  struct Layer {
+    const Light *light = nullptr;
+    glm::vec3 position = glm::vec3(0);
+    float radius = 0.0f;
+    // The casters and their model matrices when the cube map was rendered
+    std::vector<std::pair<Object *, glm::mat4>> casters;
+    mutable bool dirty = false;
+  };
+
+  mutable RenderQueueStats _stats;
+  mutable std::size_t _updated_lights = 0;
+  PointShadowOptions options;
+  std::vector<Layer> layers;
+  std::vector<const Light *> layer_lights;
+  std::vector<const Light *> wanted;
+  std::vector<std::pair<Object *, glm::mat4>> casters;
+  // Model matrices of the casters of each mesh, kept to reuse the vectors
+  mutable std::map<Mesh *, std::vector<glm::mat4>> instances;
+  std::unique_ptr<Shader> shader;
+  std::array<UniformHandle, 6> face_matrix_handles;
+  GLuint depth_fbo;
+  GLuint depth_tex;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_PASSES_POINT_SHADOW_RENDER_PASS_HPP
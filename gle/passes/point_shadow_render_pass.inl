@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stdexcept>
+#include <string>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+const char *point_shadow_render_pass_vertex = R"(
+#version 410
+
+in vec3 position;
+in mat4 model;
+
+void main() {
+  gl_Position = model * vec4(position, 1.0);
+}
+)";
+const char *point_shadow_render_pass_geometry = R"(
+#version 410
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+uniform mat4 face_matrices[6];
+uniform int first_layer;
+
+out vec3 frag_position;
+
+void main() {
+  for (int face = 0; face < 6; face++) {
+    gl_Layer = first_layer + face;
+    for (int i = 0; i < 3; i++) {
+      frag_position = gl_in[i].gl_Position.xyz;
+      gl_Position = face_matrices[face] * gl_in[i].gl_Position;
+      EmitVertex();
+    }
+    EndPrimitive();
+  }
+}
+)";
+const char *point_shadow_render_pass_fragment = R"(
+#version 410
+
+in vec3 frag_position;
+
+uniform vec3 light_position;
+uniform float light_radius;
+
+void main() {
+  gl_FragDepth = length(frag_position - light_position) / light_radius;
+}
+)";
+
+inline void
+assign_point_shadow_layers(std::vector<const Light *> &layers,
+                           const std::vector<const Light *> &wanted) {
+  auto is_wanted = [&](const Light *light) {
+    return std::find(wanted.begin(), wanted.end(), light) != wanted.end();
+  };
+  for (auto &light : layers) {
+    if (light && !is_wanted(light)) light = nullptr;
+  }
+
+  auto free_layer = layers.begin();
+  for (auto light : wanted) {
+    if (std::find(layers.begin(), layers.end(), light) != layers.end())
+      continue;
+    free_layer = std::find(free_layer, layers.end(), nullptr);
+    if (free_layer == layers.end()) return;
+    *free_layer = light;
+  }
+}
+
+inline std::array<glm::mat4, 6> cube_face_matrices(const glm::vec3 &position,
+                                                   float radius) {
+  auto projection =
+      glm::perspective(glm::radians(90.0f), 1.0f, radius * 1e-3f, radius);
+  auto face = [&](const glm::vec3 &direction, const glm::vec3 &up) {
+    return projection * glm::lookAt(position, position + direction, up);
+  };
+  return {face(glm::vec3(1, 0, 0), glm::vec3(0, -1, 0)),
+          face(glm::vec3(-1, 0, 0), glm::vec3(0, -1, 0)),
+          face(glm::vec3(0, 1, 0), glm::vec3(0, 0, 1)),
+          face(glm::vec3(0, -1, 0), glm::vec3(0, 0, -1)),
+          face(glm::vec3(0, 0, 1), glm::vec3(0, -1, 0)),
+          face(glm::vec3(0, 0, -1), glm::vec3(0, -1, 0))};
+}
+} // namespace __internal__
+
+inline PointShadowRenderPass::PointShadowRenderPass(PointShadowOptions options)
+    : options(options), layers(options.max_lights),
+      layer_lights(options.max_lights, nullptr) {
+  if (options.max_lights == 0)
+    throw std::runtime_error("point shadows need at least one light");
+
+  shader = std::make_unique<Shader>(
+      __internal__::point_shadow_render_pass_vertex,
+      __internal__::point_shadow_render_pass_fragment,
+      __internal__::point_shadow_render_pass_geometry, false);
+}
+
+inline void PointShadowRenderPass::load(Scene &scene) {
+  shader->load();
+  for (std::size_t face = 0; face < face_matrix_handles.size(); face++) {
+    face_matrix_handles[face] = shader->uniform_handle(
+        ("face_matrices[" + std::to_string(face) + "]").c_str());
+  }
+
+  GLint max_layers;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+  if ((GLint)options.max_lights * 6 > max_layers)
+    throw std::runtime_error("point shadows support at most " +
+                             std::to_string(max_layers / 6) + " lights");
+
+  glGenFramebuffers(1, &depth_fbo);
+  // create the cube map array, one cube map (six layers) per light
+  glGenTextures(1, &depth_tex);
+  glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, depth_tex);
+  glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT,
+               options.resolution, options.resolution, options.max_lights * 6,
+               0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S,
+                  GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T,
+                  GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R,
+                  GL_CLAMP_TO_EDGE);
+  glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  scene.point_shadow_map(depth_tex);
+  scene.point_shadow_bias(options.bias);
+
+  update(scene);
+}
+
+inline void PointShadowRenderPass::update(Scene &scene) {
+  // The visible point lights closest to the camera get the shadow maps
+  const auto &camera = scene.camera();
+  const auto &frustum = camera.frustum();
+  auto priority = [&](const Light *light) {
+    return glm::distance(camera.origin(), light->position) - light->radius();
+  };
+  wanted.clear();
+  for (const auto &light : scene.lights()) {
+    if (light->type != LightType::POINT_LIGHT || light->radius() <= 0.0f)
+      continue;
+    if (!frustum.intersects(BoundingSphere{light->position, light->radius()}))
+      continue;
+    wanted.push_back(light.get());
+  }
+  auto count = std::min<std::size_t>(wanted.size(), options.max_lights);
+  std::partial_sort(wanted.begin(), wanted.begin() + count, wanted.end(),
+                    [&](const Light *a, const Light *b) {
+                      return priority(a) < priority(b);
+                    });
+  wanted.resize(count);
+
+  __internal__::assign_point_shadow_layers(layer_lights, wanted);
+
+  // Only render a cube map again if its light or a caster in range moved
+  for (std::size_t i = 0; i < layers.size(); i++) {
+    auto &layer = layers[i];
+    auto light = layer_lights[i];
+    if (!light) {
+      layer.light = nullptr;
+      layer.casters.clear();
+      layer.dirty = false;
+      continue;
+    }
+
+    auto radius = light->radius();
+    if (layer.light != light || layer.position != light->position ||
+        layer.radius != radius) {
+      layer.light = light;
+      layer.position = light->position;
+      layer.radius = radius;
+      layer.dirty = true;
+    }
+
+    auto range = AABB{light->position - radius, light->position + radius};
+    casters.clear();
+    scene.bvh().query(range, [&](Object *object) {
+      if (!object->casts_shadows() || !object->world_bounds().overlaps(range))
+        return;
+      casters.emplace_back(object, object->model_matrix());
+    });
+    // BVH rotations can change the query order, so compare sorted lists
+    std::sort(casters.begin(), casters.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    if (casters != layer.casters) {
+      std::swap(casters, layer.casters);
+      layer.dirty = true;
+    }
+  }
+
+  scene.point_shadow_lights(layer_lights);
+}
+
+inline void PointShadowRenderPass::render(const Scene &) const {
+  _stats = RenderQueueStats();
+  _updated_lights = 0;
+
+  glViewport(0, 0, options.resolution, options.resolution);
+  glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
+  shader->use();
+
+  for (std::size_t i = 0; i < layers.size(); i++) {
+    const auto &layer = layers[i];
+    if (!layer.dirty) continue;
+    layer.dirty = false;
+    _updated_lights++;
+
+    // Clearing a layered attachment clears every layer, so the faces of this
+    // light are cleared one at a time before attaching the whole array
+    auto first_layer = (GLint)i * 6;
+    for (GLint face = 0; face < 6; face++) {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_tex,
+                                0, first_layer + face);
+      glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_tex, 0);
+
+    auto face_matrices =
+        __internal__::cube_face_matrices(layer.position, layer.radius);
+    for (std::size_t face = 0; face < face_matrices.size(); face++) {
+      shader->uniform(face_matrix_handles[face], face_matrices[face]);
+    }
+    shader->uniform("first_layer", first_layer);
+    shader->uniform("light_position", layer.position);
+    shader->uniform("light_radius", layer.radius);
+
+    for (auto &[mesh, models] : instances) {
+      models.clear();
+    }
+    for (const auto &[object, model] : layer.casters) {
+      instances[&object->mesh()].push_back(model);
+    }
+    _stats.objects += layer.casters.size();
+
+    for (auto &[mesh, models] : instances) {
+      if (models.empty()) continue;
+      mesh->instances(models);
+      mesh->draw_depth();
+      _stats.draws++;
+    }
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+inline const RenderQueueStats &PointShadowRenderPass::stats() const {
+  return _stats;
+}
+
+inline std::size_t PointShadowRenderPass::updated_lights() const {
+  return _updated_lights;
+}
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("Point shadow layers are kept by lights that stay wanted") {
+  auto a = gle::Light(gle::POINT_LIGHT, glm::vec3(0), glm::vec3(0),
+                      glm::vec3(1), 1.0f);
+  auto b = gle::Light(gle::POINT_LIGHT, glm::vec3(1), glm::vec3(0),
+                      glm::vec3(1), 1.0f);
+  auto c = gle::Light(gle::POINT_LIGHT, glm::vec3(2), glm::vec3(0),
+                      glm::vec3(1), 1.0f);
+
+  auto layers = std::vector<const gle::Light *>(2, nullptr);
+  gle::__internal__::assign_point_shadow_layers(layers, {&a, &b});
+  CHECK(layers == std::vector<const gle::Light *>{&a, &b});
+
+  // c replaces a, b keeps its layer
+  gle::__internal__::assign_point_shadow_layers(layers, {&c, &b});
+  CHECK(layers == std::vector<const gle::Light *>{&c, &b});
+
+  gle::__internal__::assign_point_shadow_layers(layers, {&b});
+  CHECK(layers == std::vector<const gle::Light *>{nullptr, &b});
+}
+
+#endif
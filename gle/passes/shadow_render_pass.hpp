@@ -1,20 +1,99 @@
 #ifndef GLE_PASSES_SHADOW_RENDER_PASS_HPP
 #define GLE_PASSES_SHADOW_RENDER_PASS_HPP
 
+#include <array>
 #include <gle/common.hpp>
+#include <gle/occlusion_rasterizer.hpp>
 #include <gle/render_pass.hpp>
+#include <gle/render_queue.hpp>
 #include <gle/shader.hpp>
+#include <map>
+#include <memory>
+#include <vector>
 
 GLE_NAMESPACE_BEGIN
 
+/// @brief Options of the directional shadow map
+///
+struct ShadowOptions {
+  /// @brief the number of cascades, between 1 and MAX_SHADOW_CASCADES
+  ///
+  unsigned cascades = 1;
+
+  /// @brief blend between logarithmic (1) and uniform (0) cascade splits
+  ///
+  float split_lambda = 0.75f;
+
+  /// @brief the view depth covered by the shadows, 0 for the camera far plane
+  ///
+  float max_distance = 0.0f;
+
+  /// @brief the size in texels of each cascade
+  ///
+  GLuint resolution = 1024;
+
+  /// @brief if the shadow casters hidden from the light behind the larger
+  ///        casters of a cascade are culled, with a depth buffer rasterized
+  ///        on the CPU for each cascade
+  ///
+  bool occlusion_culling = false;
+};
+
+namespace __internal__ {
+/// @brief Fit an orthographic light space matrix to the part of the shadow
+///        casters that can shadow a slice of the camera frustum
+///
+/// @param scene
+/// @param light a directional light
+/// @param near the view depth where the slice starts
+/// @param far the view depth where the slice ends
+/// @param resolution the shadow map size in texels, used for texel snapping
+/// @return glm::mat4
+inline glm::mat4 fit_light_space_matrix(const Scene &scene, const Light &light,
+                                        float near, float far,
+                                        GLuint resolution);
+
+/// @brief Get the view depth where each cascade ends with the practical split
+///        scheme, a blend of logarithmic and uniform splits
+///
+/// @param near the camera near plane
+/// @param far the view depth where the last cascade ends
+/// @param cascades the number of cascades
+/// @param lambda 1 for logarithmic splits, 0 for uniform splits
+/// @return std::array<float, MAX_SHADOW_CASCADES>
+inline std::array<float, MAX_SHADOW_CASCADES>
+cascade_splits(float near, float far, unsigned cascades, float lambda);
+} // namespace __internal__
+
 class ShadowRenderPass : public RenderPass {
 public:
-  inline ShadowRenderPass();
+  /// @brief Construct a shadow pass for the directional light of the scene
+  ///
+  /// @param options
+  inline explicit ShadowRenderPass(ShadowOptions options = {});
   inline virtual void load(Scene &scene) override;
   inline virtual void render(const Scene &scene) const override;
 
+  /// @brief Split the camera frustum and refit the light space matrix of
+  ///        every cascade to the camera and the shadow casters
+  ///
+  inline virtual void update(Scene &scene) override;
+
+  /// @brief Get the draws and culled shadow casters of the last rendered
+  ///        frame, summed over the cascades
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
 private:
+  mutable RenderQueueStats _stats;
+  ShadowOptions options;
+  // Model matrices of the casters of each mesh, kept to reuse the vectors
+  mutable std::map<Mesh *, std::vector<glm::mat4>> instances;
   std::unique_ptr<Shader> shader;
+  const Light *light = nullptr;
+  // Only with options.occlusion_culling
+  mutable std::unique_ptr<OcclusionRasterizer> occlusion;
   GLuint depth_fbo;
   GLuint depth_tex;
 };
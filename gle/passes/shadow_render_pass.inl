@@ -1,18 +1,21 @@
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <optional>
+#include <stdexcept>
+#include <string>
 
 GLE_NAMESPACE_BEGIN
 
 namespace __internal__ {
-const GLuint shadow_width = 1024;
-const GLuint shadow_height = 1024;
-
 const char *shadow_render_pass_vertex = R"(
 #version 410
 
 in vec3 position;
+in mat4 model;
 
 uniform mat4 light_space_matrix;
-uniform mat4 model;
 
 void main() {
   gl_Position = light_space_matrix * model * vec4(position, 1.0);
@@ -23,12 +26,102 @@ const char *shadow_render_pass_fragment = R"(
 
 void main() {}
 )";
+
+inline glm::mat4 fit_light_space_matrix(const Scene &scene, const Light &light,
+                                        float near, float far,
+                                        GLuint resolution) {
+  auto direction = glm::normalize(light.direction);
+  auto up = std::abs(direction.y) > 0.99f ? glm::vec3(1, 0, 0)
+                                          : glm::vec3(0, 1, 0);
+  // The light looks down its -z axis
+  auto light_view = glm::lookAt(glm::vec3(0), direction, up);
+
+  auto corners = scene.camera().frustum_corners(near, far);
+  auto receivers = AABB{glm::vec3(light_view * glm::vec4(corners[0], 1.0f)),
+                        glm::vec3(light_view * glm::vec4(corners[0], 1.0f))};
+  for (const auto &corner : corners) {
+    auto light_corner = glm::vec3(light_view * glm::vec4(corner, 1.0f));
+    receivers = receivers.merged(AABB{light_corner, light_corner});
+  }
+
+  // Casters in the light space column above the visible receivers, the
+  // column is open towards the light and its planes move to world space
+  auto column = Frustum();
+  column.planes = {glm::vec4(1, 0, 0, -receivers.min.x),
+                   glm::vec4(-1, 0, 0, receivers.max.x),
+                   glm::vec4(0, 1, 0, -receivers.min.y),
+                   glm::vec4(0, -1, 0, receivers.max.y),
+                   glm::vec4(0, 0, 1, -receivers.min.z),
+                   glm::vec4(0, 0, 0, 1)};
+  auto to_world = glm::transpose(light_view);
+  for (auto &plane : column.planes) {
+    plane = to_world * plane;
+  }
+  std::optional<AABB> casters;
+  scene.bvh().query(column, [&](Object *object) {
+    if (!object->casts_shadows()) return;
+    auto bounds = object->world_bounds().transformed(light_view);
+    if (bounds.max.x < receivers.min.x || bounds.min.x > receivers.max.x ||
+        bounds.max.y < receivers.min.y || bounds.min.y > receivers.max.y ||
+        bounds.max.z < receivers.min.z)
+      return;
+    casters = casters ? casters->merged(bounds) : bounds;
+  });
+
+  // Only the visible part of the caster bounds needs shadow map texels
+  auto fit = receivers;
+  if (casters) {
+    fit.min = glm::max(receivers.min, casters->min);
+    fit.max = glm::min(receivers.max, casters->max);
+    // Casters between the light and the receivers must still be rendered,
+    // and receivers below the casters, which may not cast shadows, must
+    // stay in front of the far plane
+    fit.max.z = casters->max.z;
+    fit.min.z = receivers.min.z;
+  }
+
+  // Snap the size of the map to steps of 1/16 of a power of two, and its
+  // position to whole texels, so texels stay fixed in world space as the
+  // camera moves and the shadow edges don't shimmer. The extra step covers
+  // the snapping offset.
+  auto size = std::max(fit.max.x - fit.min.x, fit.max.y - fit.min.y);
+  auto step = std::exp2(std::floor(std::log2(std::max(size, 1e-3f)))) / 16.0f;
+  size = (std::ceil(size / step) + 1.0f) * step;
+  auto texel = size / (float)resolution;
+  auto center = glm::vec2(fit.center());
+  auto min = glm::floor((center - size * 0.5f) / texel) * texel;
+
+  auto light_projection = glm::ortho(min.x, min.x + size, min.y, min.y + size,
+                                     -fit.max.z, -fit.min.z);
+  return light_projection * light_view;
+}
+
+inline std::array<float, MAX_SHADOW_CASCADES>
+cascade_splits(float near, float far, unsigned cascades, float lambda) {
+  auto splits = std::array<float, MAX_SHADOW_CASCADES>();
+  splits.fill(far);
+  for (unsigned i = 1; i < cascades; i++) {
+    auto fraction = (float)i / (float)cascades;
+    auto logarithmic = near * std::pow(far / near, fraction);
+    auto uniform = near + (far - near) * fraction;
+    splits[i - 1] = lambda * logarithmic + (1.0f - lambda) * uniform;
+  }
+  return splits;
+}
 } // namespace __internal__
 
-inline ShadowRenderPass::ShadowRenderPass() {
+inline ShadowRenderPass::ShadowRenderPass(ShadowOptions options)
+    : options(options) {
+  if (options.cascades < 1 || options.cascades > MAX_SHADOW_CASCADES)
+    throw std::runtime_error("shadow cascades must be between 1 and " +
+                             std::to_string(MAX_SHADOW_CASCADES));
+
   shader = std::make_unique<Shader>(__internal__::shadow_render_pass_vertex,
                                     __internal__::shadow_render_pass_fragment,
                                     false);
+  if (options.occlusion_culling)
+    occlusion = std::make_unique<OcclusionRasterizer>(
+        OcclusionRasterizerOptions{256, 256});
 }
 
 inline void ShadowRenderPass::load(Scene &scene) {
@@ -37,65 +130,107 @@ inline void ShadowRenderPass::load(Scene &scene) {
   // TODO: abstract away opengl calls here
 
   glGenFramebuffers(1, &depth_fbo);
-  // create depth texture
+  // create depth texture, one layer per cascade
   glGenTextures(1, &depth_tex);
-  glBindTexture(GL_TEXTURE_2D, depth_tex);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, __internal__::shadow_width,
-               __internal__::shadow_height, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
-               NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, depth_tex);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT, options.resolution,
+               options.resolution, options.cascades, 0, GL_DEPTH_COMPONENT,
+               GL_FLOAT, NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
   auto border = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-  glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR,
+  glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR,
                    glm::value_ptr(border));
-  // attach depth texture as FBO's depth buffer
+  // the layer attached as the FBO's depth buffer is chosen in render
   glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D,
-                         depth_tex, 0);
   glDrawBuffer(GL_NONE);
   glReadBuffer(GL_NONE);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
   scene.shadow_map(depth_tex);
 
-  const Light *light = nullptr;
-
+  // Without a directional light there are no cascades and the pass renders
+  // nothing, point light shadows are rendered by PointShadowRenderPass
+  light = nullptr;
   for (const auto &c_light : scene.lights()) {
     if (c_light->type == LightType::DIRECTIONAL_LIGHT) light = c_light.get();
   }
 
-  if (!light)
-    throw std::runtime_error(
-        "must have at least one directional light for shadows");
-
-  float near_plane = 1.0f, far_plane = 10.5f;
-  // TODO: get scene objects and calculate bounding box to solve for the ideal
-  // light position
-  auto light_position = glm::vec3(-1, 8, -1);
-  auto light_projection =
-      glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-  auto light_view =
-      glm::lookAt(light_position, light_position + light->direction,
-                  glm::vec3(0.0, 1.0, 0.0));
-  auto light_space_matrix = light_projection * light_view;
-
-  scene.light_space_matrix(light_space_matrix);
+  update(scene);
+}
+
+inline void ShadowRenderPass::update(Scene &scene) {
+  if (!light) {
+    scene.shadow_cascades(ShadowCascades());
+    return;
+  }
+
+  const auto &camera = scene.camera();
+  auto far = options.max_distance > 0.0f
+                 ? std::min(options.max_distance, camera.z_far())
+                 : camera.z_far();
+
+  auto cascades = ShadowCascades();
+  cascades.count = options.cascades;
+  cascades.splits = __internal__::cascade_splits(
+      camera.z_near(), far, options.cascades, options.split_lambda);
+  auto near = camera.z_near();
+  for (unsigned i = 0; i < cascades.count; i++) {
+    cascades.matrices[i] = __internal__::fit_light_space_matrix(
+        scene, *light, near, cascades.splits[i], options.resolution);
+    near = cascades.splits[i];
+  }
+  scene.shadow_cascades(cascades);
 }
 
 inline void ShadowRenderPass::render(const Scene &scene) const {
-  glViewport(0, 0, __internal__::shadow_width, __internal__::shadow_height);
+  glViewport(0, 0, options.resolution, options.resolution);
   glBindFramebuffer(GL_FRAMEBUFFER, depth_fbo);
-  glClear(GL_DEPTH_BUFFER_BIT);
+  shader->use();
 
+  _stats = RenderQueueStats();
+  // Objects that cast no shadows are skipped, not culled
+  std::size_t casters = 0;
   for (const auto &object : scene.objects()) {
+    if (object->casts_shadows()) casters++;
+  }
+  const auto &cascades = scene.shadow_cascades();
+  for (unsigned i = 0; i < cascades.count; i++) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depth_tex,
+                              0, i);
+    glClear(GL_DEPTH_BUFFER_BIT);
 
-    shader->use();
-    shader->uniform("light_space_matrix", scene.light_space_matrix().value());
-    shader->uniform("model", object->model_matrix());
+    // The depth shader only depends on the mesh, so every object with the
+    // same mesh is a single instanced draw
+    std::size_t visible = 0;
+    auto frustum = Frustum::from_matrix(cascades.matrices[i]);
+    for (auto &[mesh, models] : instances) {
+      models.clear();
+    }
+    // A caster hidden from the light by other casters adds no shadow
+    if (occlusion)
+      occlusion->update(scene, cascades.matrices[i], [](const Object &object) {
+        return object.casts_shadows();
+      });
+    scene.bvh().query(frustum, [&](Object *object) {
+      if (!object->casts_shadows()) return;
+      if (!frustum.intersects(object->world_bounds())) return;
+      if (occlusion && !occlusion->visible(object->world_bounds())) return;
+      instances[&object->mesh()].push_back(object->model_matrix());
+      visible++;
+    });
+    _stats.objects += visible;
+    _stats.culled += casters - visible;
 
-    object->mesh().draw();
+    shader->uniform("light_space_matrix", cascades.matrices[i]);
+    for (auto &[mesh, models] : instances) {
+      if (models.empty()) continue;
+      mesh->instances(models);
+      mesh->draw_depth();
+      _stats.draws++;
+    }
   }
 
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -103,4 +238,53 @@ inline void ShadowRenderPass::render(const Scene &scene) const {
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
-GLE_NAMESPACE_END
\ No newline at end of file
+inline const RenderQueueStats &ShadowRenderPass::stats() const {
+  return _stats;
+}
+
+GLE_NAMESPACE_END
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("Shadow cascade splits blend logarithmic and uniform splits") {
+  auto uniform = gle::__internal__::cascade_splits(1.0f, 100.0f, 4, 0.0f);
+  CHECK(uniform[0] == doctest::Approx(25.75f));
+  CHECK(uniform[2] == doctest::Approx(75.25f));
+  CHECK(uniform[3] == doctest::Approx(100.0f));
+
+  auto logarithmic = gle::__internal__::cascade_splits(1.0f, 100.0f, 2, 1.0f);
+  CHECK(logarithmic[0] == doctest::Approx(10.0f));
+  CHECK(logarithmic[1] == doctest::Approx(100.0f));
+}
+
+TEST_CASE("fit_light_space_matrix keeps receivers below the casters") {
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  auto &cube = scene.mesh(gle::make_cube_mesh());
+  auto &ground = scene.make_object(shader, material, cube, glm::vec3(0),
+                                   glm::vec3(0), glm::vec3(50, 0.1f, 50));
+  ground.casts_shadows(false);
+  scene.make_object(shader, material, cube, glm::vec3(0, 5, 0), glm::vec3(0),
+                    glm::vec3(1));
+  auto &light =
+      scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0),
+                       glm::vec3(0.1f, -1, 0), glm::vec3(1), 1.0);
+  scene.make_camera(glm::vec3(0, 2, 10), glm::vec3(0, 1, 0),
+                    glm::vec3(0, -0.2f, -1), 1.0f, glm::radians(60.0f), 0.1f,
+                    30.0f);
+
+  auto matrix = gle::__internal__::fit_light_space_matrix(scene, light, 0.1f,
+                                                          30.0f, 1024);
+  auto depth = [&](const glm::vec3 &position) {
+    auto clip = matrix * glm::vec4(position, 1.0f);
+    return clip.z / clip.w;
+  };
+  // The ground under the caster is inside the depth range, behind it
+  CHECK(depth(glm::vec3(0, 0.05f, 0)) <= 1.0f);
+  CHECK(depth(glm::vec3(0, 0.05f, 0)) >= -1.0f);
+  CHECK(depth(glm::vec3(0, 5.5f, 0)) >= -1.0f);
+  CHECK(depth(glm::vec3(0, 5.5f, 0)) < depth(glm::vec3(0, 0.05f, 0)));
+}
+
+#endif
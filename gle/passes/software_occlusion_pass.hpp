@@ -0,0 +1,47 @@
+#ifndef GLE_PASSES_SOFTWARE_OCCLUSION_PASS_HPP
+#define GLE_PASSES_SOFTWARE_OCCLUSION_PASS_HPP
+
+#include <gle/common.hpp>
+#include <gle/occlusion.hpp>
+#include <gle/occlusion_rasterizer.hpp>
+#include <gle/render_pass.hpp>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief Rasterizes the large objects seen from the camera on the CPU every
+///        frame and culls the objects hidden behind them, see
+///        ObjectRenderOptions::occlusion
+///
+/// Unlike HiZOcclusionPass the objects are tested against the occluders of
+/// the same frame. The pass draws nothing.
+class SoftwareOcclusionPass : public RenderPass, public OcclusionCuller {
+public:
+  /// @brief Construct a software occlusion pass
+  ///
+  /// @param options
+  inline explicit SoftwareOcclusionPass(
+      OcclusionRasterizerOptions options = {});
+
+  /// @brief Rasterize the occluders seen from the camera
+  ///
+  inline virtual void update(Scene &scene) override;
+  inline virtual void render(const Scene &scene) const override;
+
+  /// @brief Check if world space bounds may be visible from the camera
+  ///
+  /// @param bounds
+  /// @return bool
+  inline virtual bool visible(const AABB &bounds) const override;
+
+  /// @brief Get the rasterizer of the occluders
+  ///
+  /// @return const OcclusionRasterizer&
+  inline const OcclusionRasterizer &rasterizer() const;
+
+private:
+  OcclusionRasterizer _rasterizer;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_PASSES_SOFTWARE_OCCLUSION_PASS_HPP
@@ -0,0 +1,21 @@
+GLE_NAMESPACE_BEGIN
+
+inline SoftwareOcclusionPass::SoftwareOcclusionPass(
+    OcclusionRasterizerOptions options)
+    : _rasterizer(options) {}
+
+inline void SoftwareOcclusionPass::update(Scene &scene) {
+  _rasterizer.update(scene);
+}
+
+inline void SoftwareOcclusionPass::render(const Scene &) const {}
+
+inline bool SoftwareOcclusionPass::visible(const AABB &bounds) const {
+  return _rasterizer.visible(bounds);
+}
+
+inline const OcclusionRasterizer &SoftwareOcclusionPass::rasterizer() const {
+  return _rasterizer;
+}
+
+GLE_NAMESPACE_END
@@ -22,6 +22,12 @@ public:
   ///
   inline virtual void load(Scene &scene);
 
+  /// @brief Update the per-frame scene state this pass provides, such as the
+  ///        light space matrix. Called by the Window every frame before the
+  ///        scene uniforms are uploaded
+  ///
+  inline virtual void update(Scene &scene);
+
 protected:
   /// @brief Render this pass (implementation)
   ///
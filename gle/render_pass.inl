@@ -4,6 +4,8 @@ inline void RenderPass::do_render(const Scene &scene) const { render(scene); }
 
 inline void RenderPass::load(Scene &) {}
 
+inline void RenderPass::update(Scene &) {}
+
 inline RenderPass::~RenderPass() {}
 
 GLE_NAMESPACE_END
\ No newline at end of file
@@ -0,0 +1,236 @@
+#ifndef GLE_RENDER_QUEUE_HPP
+#define GLE_RENDER_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <gle/camera.hpp>
+#include <gle/common.hpp>
+#include <gle/geometry_arena.hpp>
+#include <gle/mesh.hpp>
+#include <gle/shader.hpp>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+
+/// @brief A sort key and the index of the queue item it belongs to
+///
+struct SortEntry {
+  std::uint64_t key;
+  std::uint32_t item;
+};
+
+/// @brief Sort entries by key with an LSD radix sort on 8 bit digits
+///
+/// Digits that are the same for every key are skipped. The sort is stable.
+///
+/// @param entries the entries to sort
+/// @param scratch scratch space, resized to the size of entries
+inline void radix_sort(std::vector<SortEntry> &entries,
+                       std::vector<SortEntry> &scratch);
+
+} // namespace __internal__
+
+/// @brief Number of draws and state changes issued by a render queue
+///
+struct RenderQueueStats {
+  /// @brief Number of objects queued
+  ///
+  std::size_t objects = 0;
+
+  /// @brief Number of objects culled before being queued
+  ///
+  std::size_t culled = 0;
+
+  /// @brief Number of draw calls
+  ///
+  std::size_t draws = 0;
+
+  /// @brief Number of multi draw indirect commands, each draws the instances
+  ///        of one mesh
+  ///
+  std::size_t indirect_commands = 0;
+
+  /// @brief Number of triangles drawn, summed over every instance
+  ///
+  std::size_t triangles = 0;
+
+  /// @brief Number of meshlets drawn
+  ///
+  std::size_t meshlets = 0;
+
+  /// @brief Number of meshlets of the queued objects culled before being
+  ///        queued
+  ///
+  std::size_t meshlets_culled = 0;
+
+  /// @brief Number of times the shader program changed
+  ///
+  std::size_t program_changes = 0;
+
+  /// @brief Number of times a material was loaded
+  ///
+  std::size_t material_changes = 0;
+
+  /// @brief Number of times the mesh VAO changed
+  ///
+  std::size_t mesh_changes = 0;
+
+  /// @brief Add the stats of another queue
+  ///
+  /// @param other
+  /// @return RenderQueueStats&
+  inline RenderQueueStats &operator+=(const RenderQueueStats &other);
+};
+
+/// @brief Queue of objects to draw, sorted to minimize state changes
+///
+/// Every queued object gets a 64 bit sort key made of (from the most to the
+/// least significant bits) its shader, material, mesh, level of detail and
+/// view depth:
+///
+///     | shader 12 | material 16 | mesh 16 | lod 3 | depth 17 |
+///
+/// The keys are radix sorted, so objects sharing state are contiguous and
+/// drawn front to back. Consecutive objects with the same shader, material,
+/// mesh and level of detail are drawn as instances of a single draw call, and
+/// the program, material and VAO are only bound when they change. Objects
+/// queued with some of their meshlets are drawn on their own.
+///
+/// When submitted with a geometry arena, the instanced draws of meshes in
+/// the arena become indirect commands, and consecutive commands with the
+/// same shader and material are drawn by a single
+/// glMultiDrawElementsIndirect call whatever their meshes.
+class RenderQueue {
+public:
+  RenderQueue(RenderQueue &) = delete;
+  RenderQueue(RenderQueue &&) = delete;
+  RenderQueue(const RenderQueue &) = delete;
+  RenderQueue(const RenderQueue &&) = delete;
+
+  inline RenderQueue();
+
+  /// @brief Remove all queued objects and reset the stats and the ids of
+  ///        the shaders, materials and meshes in the sort keys
+  ///
+  inline void clear();
+
+  /// @brief Queue an object
+  ///
+  /// @param camera the camera used to compute the view depth
+  /// @param shader
+  /// @param material
+  /// @param mesh
+  /// @param model the model matrix
+  /// @param lod the level of detail of the mesh
+  /// @exception std::runtime_error thrown if more shaders, materials or
+  ///            meshes were queued since the last clear() than fit in the
+  ///            sort key
+  inline void push(const Camera &camera, const Shader &shader,
+                   const Material &material, Mesh &mesh,
+                   const glm::mat4 &model, std::size_t lod = 0);
+
+  /// @brief Queue an object of which only some meshlets of the full mesh are
+  ///        drawn
+  ///
+  /// @param camera the camera used to compute the view depth
+  /// @param shader
+  /// @param material
+  /// @param mesh
+  /// @param model the model matrix
+  /// @param visible the indices of the visible meshlets, in increasing order
+  /// @exception std::runtime_error thrown if more shaders, materials or
+  ///            meshes were queued since the last clear() than fit in the
+  ///            sort key
+  inline void push_meshlets(const Camera &camera, const Shader &shader,
+                            const Material &material, Mesh &mesh,
+                            const glm::mat4 &model,
+                            const std::vector<std::uint32_t> &visible);
+
+  /// @brief Count objects that were culled instead of queued
+  ///
+  /// @param count
+  inline void cull(std::size_t count = 1);
+
+  /// @brief Sort the queued objects by their keys
+  ///
+  inline void sort();
+
+  /// @brief Sort the queued objects by their view depth first, then by their
+  ///        keys
+  ///
+  /// Drawing front to back rejects the most fragments with the depth test,
+  /// but only objects of the same mesh at about the same depth are drawn as
+  /// instances.
+  inline void sort_front_to_back();
+
+  /// @brief Draw the queued objects in key order
+  ///
+  /// @param scene
+  /// @param uniforms
+  /// @param shader_override if not null, every object is drawn with this
+  ///        shader and no material is loaded
+  /// @param arena if not null, the objects whose mesh is in the arena are
+  ///        drawn with multi draw indirect
+  inline void submit(const Scene &scene, const MVPShaderUniforms &uniforms,
+                     const Shader *shader_override = nullptr,
+                     GeometryArena *arena = nullptr);
+
+  /// @brief Get the draws and state changes since the last clear()
+  ///
+  /// @return const RenderQueueStats&
+  inline const RenderQueueStats &stats() const;
+
+  /// @brief Get the number of queued objects
+  ///
+  /// @return std::size_t
+  inline std::size_t size() const;
+
+private:
+  struct Item {
+    const Shader *shader;
+    const Material *material;
+    Mesh *mesh;
+    glm::mat4 model;
+    std::size_t lod;
+    // The range of visible_meshlets drawn, the whole level if there is none
+    std::uint32_t first_meshlet;
+    std::uint32_t num_meshlets;
+    bool meshlets;
+  };
+
+  // Consecutive sorted entries drawn together, and their indirect command
+  struct Batch {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t command;
+  };
+
+  inline std::uint64_t key_of(const Camera &camera, const Shader &shader,
+                              const Material &material, const Mesh &mesh,
+                              const glm::mat4 &model, std::size_t lod);
+
+  inline static std::uint32_t
+  id_of(std::unordered_map<const void *, std::uint32_t> &ids, const void *ptr,
+        std::uint32_t max_ids);
+
+  std::vector<Item> items;
+  std::vector<__internal__::SortEntry> entries;
+  std::vector<__internal__::SortEntry> scratch;
+  std::vector<glm::mat4> instance_models;
+  std::vector<Batch> batches;
+  std::vector<glm::mat4> arena_models;
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<std::uint32_t> visible_meshlets;
+  std::unordered_map<const void *, std::uint32_t> shader_ids;
+  std::unordered_map<const void *, std::uint32_t> material_ids;
+  std::unordered_map<const void *, std::uint32_t> mesh_ids;
+  RenderQueueStats _stats;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_RENDER_QUEUE_HPP
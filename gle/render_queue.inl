@@ -0,0 +1,340 @@
+#include <stdexcept>
+
+GLE_NAMESPACE_BEGIN
+
+namespace __internal__ {
+constexpr unsigned sort_key_shader_bits = 12;
+constexpr unsigned sort_key_material_bits = 16;
+constexpr unsigned sort_key_mesh_bits = 16;
+constexpr unsigned sort_key_lod_bits = 3;
+constexpr unsigned sort_key_depth_bits = 17;
+
+static_assert(sort_key_shader_bits + sort_key_material_bits +
+                  sort_key_mesh_bits + sort_key_lod_bits +
+                  sort_key_depth_bits ==
+              64);
+static_assert(Mesh::MAX_LODS <= 1u << sort_key_lod_bits);
+
+inline void radix_sort(std::vector<SortEntry> &entries,
+                       std::vector<SortEntry> &scratch) {
+  scratch.resize(entries.size());
+  if (entries.size() < 2) return;
+
+  // Bits that differ between any two keys, digits without any are skipped
+  std::uint64_t all_and = ~std::uint64_t(0), all_or = 0;
+  for (const auto &entry : entries) {
+    all_and &= entry.key;
+    all_or |= entry.key;
+  }
+  auto varying = all_and ^ all_or;
+
+  for (unsigned shift = 0; shift < 64; shift += 8) {
+    if (((varying >> shift) & 0xff) == 0) continue;
+
+    std::size_t offsets[257] = {};
+    for (const auto &entry : entries) {
+      offsets[((entry.key >> shift) & 0xff) + 1]++;
+    }
+    for (std::size_t i = 1; i < 257; i++) {
+      offsets[i] += offsets[i - 1];
+    }
+    for (const auto &entry : entries) {
+      scratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+    }
+    entries.swap(scratch);
+  }
+}
+} // namespace __internal__
+
+inline RenderQueueStats &
+RenderQueueStats::operator+=(const RenderQueueStats &other) {
+  objects += other.objects;
+  culled += other.culled;
+  draws += other.draws;
+  indirect_commands += other.indirect_commands;
+  triangles += other.triangles;
+  meshlets += other.meshlets;
+  meshlets_culled += other.meshlets_culled;
+  program_changes += other.program_changes;
+  material_changes += other.material_changes;
+  mesh_changes += other.mesh_changes;
+  return *this;
+}
+
+inline RenderQueue::RenderQueue() {}
+
+inline void RenderQueue::clear() {
+  items.clear();
+  entries.clear();
+  visible_meshlets.clear();
+  // Ids only order the objects of one frame, so states that are gone don't
+  // keep their slots
+  shader_ids.clear();
+  material_ids.clear();
+  mesh_ids.clear();
+  _stats = RenderQueueStats();
+}
+
+inline std::uint32_t
+RenderQueue::id_of(std::unordered_map<const void *, std::uint32_t> &ids,
+                   const void *ptr, std::uint32_t max_ids) {
+  auto [it, inserted] = ids.try_emplace(ptr, (std::uint32_t)ids.size());
+  if (it->second >= max_ids)
+    throw std::runtime_error("too many unique render states for the render "
+                             "queue sort key");
+  return it->second;
+}
+
+inline std::uint64_t RenderQueue::key_of(const Camera &camera,
+                                         const Shader &shader,
+                                         const Material &material,
+                                         const Mesh &mesh,
+                                         const glm::mat4 &model,
+                                         std::size_t lod) {
+  using namespace __internal__;
+
+  std::uint64_t shader_id =
+      id_of(shader_ids, &shader, 1u << sort_key_shader_bits);
+  std::uint64_t material_id =
+      id_of(material_ids, &material, 1u << sort_key_material_bits);
+  std::uint64_t mesh_id = id_of(mesh_ids, &mesh, 1u << sort_key_mesh_bits);
+
+  // Front to back between the camera planes
+  auto position = glm::vec3(model[3]);
+  auto depth = glm::dot(position - camera.origin(),
+                        glm::normalize(camera.direction()));
+  auto t = glm::clamp((depth - camera.z_near()) /
+                          (camera.z_far() - camera.z_near()),
+                      0.0f, 1.0f);
+  std::uint64_t depth_key =
+      (std::uint64_t)(t * (float)((1u << sort_key_depth_bits) - 1));
+
+  return shader_id << (64 - sort_key_shader_bits) |
+         material_id << (sort_key_mesh_bits + sort_key_lod_bits +
+                         sort_key_depth_bits) |
+         mesh_id << (sort_key_lod_bits + sort_key_depth_bits) |
+         (std::uint64_t)lod << sort_key_depth_bits | depth_key;
+}
+
+inline void RenderQueue::push(const Camera &camera, const Shader &shader,
+                              const Material &material, Mesh &mesh,
+                              const glm::mat4 &model, std::size_t lod) {
+  auto key = key_of(camera, shader, material, mesh, model, lod);
+  entries.push_back(__internal__::SortEntry{key, (std::uint32_t)items.size()});
+  items.push_back(Item{&shader, &material, &mesh, model, lod, 0, 0, false});
+  _stats.objects++;
+}
+
+inline void
+RenderQueue::push_meshlets(const Camera &camera, const Shader &shader,
+                           const Material &material, Mesh &mesh,
+                           const glm::mat4 &model,
+                           const std::vector<std::uint32_t> &visible) {
+  auto key = key_of(camera, shader, material, mesh, model, 0);
+  entries.push_back(__internal__::SortEntry{key, (std::uint32_t)items.size()});
+  items.push_back(Item{&shader, &material, &mesh, model, 0,
+                       (std::uint32_t)visible_meshlets.size(),
+                       (std::uint32_t)visible.size(), true});
+  visible_meshlets.insert(visible_meshlets.end(), visible.begin(),
+                          visible.end());
+  _stats.objects++;
+  _stats.meshlets_culled += mesh.meshlets().size() - visible.size();
+}
+
+inline void RenderQueue::cull(std::size_t count) { _stats.culled += count; }
+
+inline void RenderQueue::sort() { __internal__::radix_sort(entries, scratch); }
+
+inline void RenderQueue::sort_front_to_back() {
+  using namespace __internal__;
+
+  // Rotate the depth to the most significant bits and back
+  const auto low = sort_key_depth_bits, high = 64 - sort_key_depth_bits;
+  for (auto &entry : entries) {
+    entry.key = entry.key >> low | entry.key << high;
+  }
+  radix_sort(entries, scratch);
+  for (auto &entry : entries) {
+    entry.key = entry.key << low | entry.key >> high;
+  }
+}
+
+inline void RenderQueue::submit(const Scene &scene,
+                                const MVPShaderUniforms &uniforms,
+                                const Shader *shader_override,
+                                GeometryArena *arena) {
+  const auto no_command = (std::size_t)-1;
+
+  // Objects are only split into separate draws by the state they use, or
+  // when they only draw some meshlets
+  batches.clear();
+  arena_models.clear();
+  commands.clear();
+  for (std::size_t begin = 0; begin < entries.size();) {
+    const auto &first = items[entries[begin].item];
+    auto end = begin + 1;
+    for (; end < entries.size() && !first.meshlets; end++) {
+      const auto &item = items[entries[end].item];
+      if (item.meshlets) break;
+      if (item.mesh != first.mesh || item.lod != first.lod) break;
+      if (shader_override) continue;
+      if (item.shader != first.shader || item.material != first.material)
+        break;
+    }
+
+    auto batch = Batch{begin, end, no_command};
+    if (arena && !first.meshlets && arena->contains(*first.mesh)) {
+      batch.command = commands.size();
+      commands.push_back(arena->command(*first.mesh, first.lod, end - begin,
+                                        arena_models.size()));
+      for (auto i = begin; i < end; i++) {
+        arena_models.push_back(items[entries[i].item].model);
+      }
+    }
+    batches.push_back(batch);
+    begin = end;
+  }
+  // A single upload of the models and commands of every arena draw
+  if (!commands.empty()) arena->upload(arena_models, commands);
+
+  const Shader *current_shader = nullptr;
+  const Material *current_material = nullptr;
+  const Mesh *current_mesh = nullptr;
+  bool arena_bound = false;
+
+  if (shader_override) {
+    shader_override->use(scene, uniforms);
+    _stats.program_changes++;
+  }
+
+  for (std::size_t b = 0; b < batches.size();) {
+    const auto &batch = batches[b];
+    const auto &first = items[entries[batch.begin].item];
+
+    if (!shader_override) {
+      if (first.shader != current_shader) {
+        first.shader->use(scene, uniforms);
+        current_shader = first.shader;
+        current_material = nullptr;
+        _stats.program_changes++;
+      }
+      if (first.material != current_material) {
+        first.shader->load_material(*first.material);
+        current_material = first.material;
+        _stats.material_changes++;
+      }
+    }
+
+    if (batch.command != no_command) {
+      // Following arena batches with the same state, their commands are
+      // contiguous
+      auto last = b + 1;
+      for (; last < batches.size() && batches[last].command != no_command;
+           last++) {
+        if (shader_override) continue;
+        const auto &item = items[entries[batches[last].begin].item];
+        if (item.shader != first.shader || item.material != first.material)
+          break;
+      }
+      for (auto i = b; i < last; i++) {
+        const auto &item = items[entries[batches[i].begin].item];
+        _stats.triangles += (batches[i].end - batches[i].begin) *
+                            (std::size_t)item.mesh->num_elements(item.lod) /
+                            3;
+      }
+
+      if (!arena_bound) {
+        arena->bind();
+        arena_bound = true;
+        current_mesh = nullptr;
+        _stats.mesh_changes++;
+      }
+      arena->draw(batch.command, last - b);
+      _stats.draws++;
+      _stats.indirect_commands += last - b;
+      b = last;
+      continue;
+    }
+
+    instance_models.clear();
+    for (auto i = batch.begin; i < batch.end; i++) {
+      instance_models.push_back(items[entries[i].item].model);
+    }
+    first.mesh->instances(instance_models);
+
+    if (first.mesh != current_mesh) {
+      first.mesh->bind_buffers();
+      current_mesh = first.mesh;
+      arena_bound = false;
+      _stats.mesh_changes++;
+    }
+    if (first.meshlets) {
+      _stats.triangles += first.mesh->draw_meshlets(
+          visible_meshlets.data() + first.first_meshlet, first.num_meshlets);
+      _stats.meshlets += first.num_meshlets;
+    } else {
+      first.mesh->draw_instances(first.lod);
+      _stats.triangles +=
+          (batch.end - batch.begin) *
+          (std::size_t)first.mesh->num_elements(first.lod) / 3;
+    }
+    _stats.draws++;
+    b++;
+  }
+}
+
+inline const RenderQueueStats &RenderQueue::stats() const { return _stats; }
+
+inline std::size_t RenderQueue::size() const { return items.size(); }
+
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+#  include <gle/meshs/primitives.hpp>
+#  include <gle/shaders/solid_color_shader.hpp>
+#  include <memory>
+
+TEST_CASE("__internal__::radix_sort sorts stably by key") {
+  using gle::__internal__::SortEntry;
+  auto entries = std::vector<SortEntry>{
+      {0xff00000000000001, 0}, {3, 1}, {0x0000010000000000, 2},
+      {3, 3},                  {0, 4}, {0xff00000000000000, 5},
+  };
+  auto scratch = std::vector<SortEntry>();
+  gle::__internal__::radix_sort(entries, scratch);
+
+  auto items = std::vector<std::uint32_t>();
+  for (const auto &entry : entries) {
+    items.push_back(entry.item);
+  }
+  CHECK(items == std::vector<std::uint32_t>{4, 1, 3, 2, 5, 0});
+}
+
+TEST_CASE("RenderQueue sort key ids only last until clear") {
+  auto camera = gle::Camera(glm::vec3(0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 1.0f, glm::radians(90.0f),
+                            0.1f, 100.0f);
+  auto material = gle::SolidColorMaterial(glm::vec3(1), 1.0f, 0.5f);
+  auto mesh = gle::make_cube_mesh();
+  const std::size_t max_shaders = 1u << gle::__internal__::sort_key_shader_bits;
+  auto shaders = std::vector<std::unique_ptr<gle::Shader>>();
+  for (std::size_t i = 0; i < max_shaders + 1; i++) {
+    shaders.push_back(std::make_unique<gle::Shader>("", "", false));
+  }
+
+  auto queue = gle::RenderQueue();
+  auto push = [&](std::size_t first, std::size_t last) {
+    for (auto i = first; i < last; i++) {
+      queue.push(camera, *shaders[i], material, *mesh, glm::mat4(1));
+    }
+  };
+  push(0, max_shaders);
+  CHECK_THROWS_AS(push(max_shaders, max_shaders + 1), std::runtime_error);
+
+  // A new frame with as many other shaders
+  queue.clear();
+  CHECK_NOTHROW(push(1, max_shaders + 1));
+}
+
+#endif
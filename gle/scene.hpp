@@ -1,14 +1,111 @@
 #ifndef GLE_SCENE_HPP
 #define GLE_SCENE_HPP
 
+#include <array>
+#include <cstddef>
+#include <gle/buffer_texture.hpp>
+#include <gle/bvh.hpp>
 #include <gle/camera.hpp>
 #include <gle/common.hpp>
+#include <gle/fwd.hpp>
+#include <gle/light.hpp>
+#include <gle/light_clusters.hpp>
 #include <gle/shader.hpp>
 #include <gle/texture.hpp>
+#include <gle/ubo.hpp>
+#include <memory>
 #include <optional>
 
 GLE_NAMESPACE_BEGIN
 
+/// @brief The uniform block binding point of the scene uniforms
+///
+constexpr GLuint SCENE_UNIFORMS_BINDING = 0;
+
+/// @brief The texture unit the point light shadow cube map array is bound to
+///
+constexpr GLuint POINT_SHADOW_MAP_TEXTURE_UNIT = 11;
+
+/// @brief The texture unit the light data buffer texture is bound to
+///
+constexpr GLuint LIGHT_DATA_TEXTURE_UNIT = 12;
+
+/// @brief The texture unit the light cluster ranges are bound to
+///
+constexpr GLuint CLUSTER_RANGES_TEXTURE_UNIT = 13;
+
+/// @brief The texture unit the light cluster indices are bound to
+///
+constexpr GLuint CLUSTER_LIGHTS_TEXTURE_UNIT = 14;
+
+/// @brief The texture unit the shadow map is bound to
+///
+constexpr GLuint SHADOW_MAP_TEXTURE_UNIT = 15;
+
+/// @brief The maximum number of cascades of the directional shadow map
+///
+constexpr unsigned MAX_SHADOW_CASCADES = 4;
+
+/// @brief The cascades of the directional shadow map
+///
+/// Cascade i covers the view depths between splits[i - 1] (or the camera near
+/// plane) and splits[i], and is stored in layer i of the shadow map texture
+/// array
+struct ShadowCascades {
+  /// @brief the light space matrix of each cascade
+  ///
+  std::array<glm::mat4, MAX_SHADOW_CASCADES> matrices;
+
+  /// @brief the view depth where each cascade ends
+  ///
+  std::array<float, MAX_SHADOW_CASCADES> splits;
+
+  /// @brief the number of cascades in use, 0 if there is no shadow map
+  ///
+  unsigned count = 0;
+};
+
+namespace __internal__ {
+
+// std140 layout of the SceneUniforms block in the shader headers. vec3 members
+// are stored as vec4 since std140 aligns them to 16 bytes.
+struct SceneUniformBlock {
+  glm::mat4 light_space_matrices[MAX_SHADOW_CASCADES];
+  glm::mat4 camera_view;
+  glm::mat4 camera_projection;
+  glm::vec4 camera_origin;
+  glm::vec4 camera_direction;
+  glm::uvec4 cluster_grid;
+  glm::vec4 cluster_depth;
+  glm::vec4 shadow_cascade_splits;
+  std::uint32_t num_lights;
+  std::uint32_t num_shadow_cascades;
+  float point_shadow_bias;
+  std::uint32_t padding;
+};
+
+// The shader headers size light_space_matrices with MAX_SHADOW_CASCADES,
+// but the splits are a single vec4
+static_assert(MAX_SHADOW_CASCADES <= 4);
+constexpr std::size_t scene_uniforms_cascades_size =
+    sizeof(glm::mat4) * MAX_SHADOW_CASCADES;
+static_assert(offsetof(SceneUniformBlock, camera_origin) ==
+              scene_uniforms_cascades_size + 128);
+static_assert(offsetof(SceneUniformBlock, cluster_grid) ==
+              scene_uniforms_cascades_size + 160);
+static_assert(offsetof(SceneUniformBlock, shadow_cascade_splits) ==
+              scene_uniforms_cascades_size + 192);
+static_assert(offsetof(SceneUniformBlock, num_lights) ==
+              scene_uniforms_cascades_size + 208);
+static_assert(offsetof(SceneUniformBlock, point_shadow_bias) ==
+              scene_uniforms_cascades_size + 216);
+
+} // namespace __internal__
+
+/// @brief A BVH over the world space bounds of objects
+///
+using ObjectBVH = BVH<Object *>;
+
 class Scene {
 public:
   Scene(Scene &) = delete;
@@ -28,33 +125,102 @@ public:
 
   inline Mesh &mesh(std::unique_ptr<Mesh> mesh);
 
+  /// @brief Initialize the textures, meshes, shaders and uniform buffers
+  ///
+  /// When the context has multi draw indirect, the meshes are also copied
+  /// to the geometry arena.
   inline void init();
 
+  /// @brief Assign lights to clusters and upload the per-frame scene state
+  ///        (camera, lights and shadow map). Called once per frame by the
+  ///        Window
+  ///
+  inline void upload_uniforms();
+
   inline const Camera &camera() const;
   inline Camera &camera();
 
   inline const std::vector<std::unique_ptr<Object>> &objects() const;
 
+  /// @brief Get the BVH of the scene objects, kept up to date as objects move
+  ///
+  /// @return const ObjectBVH&
+  inline const ObjectBVH &bvh() const;
+
+  /// @brief Get the arena holding the meshes drawn with multi draw indirect
+  ///
+  /// @return GeometryArena* nullptr before init or if the context doesn't
+  ///         have multi draw indirect
+  inline GeometryArena *geometry_arena() const;
+
+  /// @brief Get the object whose mesh is hit first by the ray
+  ///
+  /// ## Example:
+  ///     // in MouseListener::mouse_press, with x and y in window coordinates
+  ///     auto ndc = glm::vec2(2.0 * x / width - 1.0, 1.0 - 2.0 * y / height);
+  ///     auto object = scene.pick(scene.camera().ray(ndc));
+  ///
+  /// @param ray a world space ray
+  /// @return Object* the object hit, or nullptr if no object was hit
+  inline Object *pick(const Ray &ray) const;
+
   inline const std::vector<std::unique_ptr<Light>> &lights() const;
 
+  inline LightClusters &light_clusters();
+
+  inline const LightClusters &light_clusters() const;
+
   inline const std::optional<GLuint> &shadow_map() const;
 
   inline void shadow_map(GLuint tex);
 
-  inline const std::optional<glm::mat4> &light_space_matrix() const;
+  inline const ShadowCascades &shadow_cascades() const;
+
+  inline const std::optional<GLuint> &point_shadow_map() const;
+
+  inline void point_shadow_map(GLuint tex);
+
+  /// @brief Get the depth bias of the point shadows, a fraction of the light
+  ///        radius
+  ///
+  /// @return float
+  inline float point_shadow_bias() const;
+
+  inline void point_shadow_bias(float bias);
+
+  /// @brief Get the point lights with a shadow map
+  ///
+  /// The cube map of the light at index i is layer i of the point shadow map
+  /// cube map array. Unused layers hold nullptr.
+  ///
+  /// @return const std::vector<const Light *>&
+  inline const std::vector<const Light *> &point_shadow_lights() const;
+
+  inline void point_shadow_lights(const std::vector<const Light *> &lights);
 
-  inline void light_space_matrix(const glm::mat4 &mat);
+  inline void shadow_cascades(const ShadowCascades &cascades);
 
 private:
   std::unique_ptr<Camera> _camera;
   std::vector<std::unique_ptr<Object>> _objects;
+  ObjectBVH _bvh;
   std::vector<std::unique_ptr<Light>> _lights;
   std::vector<std::unique_ptr<Shader>> _shaders;
   std::vector<std::unique_ptr<Material>> _materials;
   std::vector<std::unique_ptr<Texture>> _textures;
   std::vector<std::unique_ptr<Mesh>> _meshs;
+  std::unique_ptr<GeometryArena> _geometry_arena;
   std::optional<GLuint> _shadow_map;
-  std::optional<glm::mat4> _light_space_matrix;
+  ShadowCascades _shadow_cascades;
+  std::optional<GLuint> _point_shadow_map;
+  float _point_shadow_bias = 0.01f;
+  std::vector<const Light *> _point_shadow_lights;
+  LightClusters _light_clusters;
+  std::vector<glm::vec4> light_data;
+  UBO<__internal__::SceneUniformBlock> uniform_buffer;
+  BufferTexture<glm::vec4> light_data_texture;
+  BufferTexture<glm::uvec2> cluster_ranges_texture;
+  BufferTexture<std::uint32_t> cluster_lights_texture;
 };
 
 GLE_NAMESPACE_END
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <limits>
+
 GLE_NAMESPACE_BEGIN
 
 inline Scene::Scene() : _objects(), _lights() {}
@@ -11,9 +14,79 @@ inline void Scene::init() {
     mesh->init_buffers();
   }
 
+  if (GeometryArena::supported()) {
+    _geometry_arena = std::make_unique<GeometryArena>();
+    _geometry_arena->init();
+    for (const auto &mesh : _meshs) {
+      _geometry_arena->add(*mesh);
+    }
+  }
+
   for (auto &shader : _shaders) {
     shader->load();
   }
+
+  uniform_buffer.init();
+  light_data_texture.init();
+  cluster_ranges_texture.init();
+  cluster_lights_texture.init();
+}
+
+inline void Scene::upload_uniforms() {
+  _light_clusters.assign(*_camera, _lights);
+
+  // Each light is packed in 3 texels, see get_light in the shader headers
+  light_data.clear();
+  for (const auto &light : _lights) {
+    auto radius = light->radius();
+    auto slot = std::find(_point_shadow_lights.begin(),
+                          _point_shadow_lights.end(), light.get());
+    auto shadow_layer = slot == _point_shadow_lights.end()
+                            ? -1.0f
+                            : (float)(slot - _point_shadow_lights.begin());
+    light_data.push_back(glm::vec4(light->position, (float)light->type));
+    light_data.push_back(glm::vec4(glm::normalize(light->direction), radius));
+    light_data.push_back(glm::vec4(light->attn, shadow_layer));
+  }
+
+  const auto &grid = _light_clusters.options().grid;
+  auto block = __internal__::SceneUniformBlock();
+  for (unsigned i = 0; i < _shadow_cascades.count; i++) {
+    block.light_space_matrices[i] = _shadow_cascades.matrices[i];
+    block.shadow_cascade_splits[i] = _shadow_cascades.splits[i];
+  }
+  block.num_shadow_cascades = _shadow_cascades.count;
+  block.point_shadow_bias = _point_shadow_bias;
+  block.camera_view = _camera->view_matrix();
+  block.camera_projection = _camera->projection_matrix();
+  block.camera_origin = glm::vec4(_camera->origin(), 1);
+  block.camera_direction = glm::vec4(_camera->direction(), 0);
+  block.cluster_grid = glm::uvec4(grid, 0);
+  block.cluster_depth =
+      glm::vec4(_camera->z_near(), _camera->z_far(),
+                (float)grid.z / std::log(_camera->z_far() / _camera->z_near()),
+                0);
+  block.num_lights = _lights.size();
+
+  uniform_buffer.write(block);
+  uniform_buffer.bind_base(SCENE_UNIFORMS_BINDING);
+
+  light_data_texture.write(light_data);
+  cluster_ranges_texture.write(_light_clusters.ranges());
+  cluster_lights_texture.write(_light_clusters.indices());
+  light_data_texture.bind(LIGHT_DATA_TEXTURE_UNIT);
+  cluster_ranges_texture.bind(CLUSTER_RANGES_TEXTURE_UNIT);
+  cluster_lights_texture.bind(CLUSTER_LIGHTS_TEXTURE_UNIT);
+
+  if (_shadow_map.has_value()) {
+    glActiveTexture(GL_TEXTURE0 + SHADOW_MAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, _shadow_map.value());
+  }
+
+  if (_point_shadow_map.has_value()) {
+    glActiveTexture(GL_TEXTURE0 + POINT_SHADOW_MAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, _point_shadow_map.value());
+  }
 }
 
 template <class... Args> inline Camera &Scene::make_camera(Args &&...args) {
@@ -23,7 +96,10 @@ template <class... Args> inline Camera &Scene::make_camera(Args &&...args) {
 
 template <class... Args> inline Object &Scene::make_object(Args &&...args) {
   _objects.push_back(std::make_unique<Object>(std::forward<Args>(args)...));
-  return *_objects.back();
+  auto &object = *_objects.back();
+  object.bvh = &_bvh;
+  object.bvh_proxy = _bvh.insert(object.world_bounds(), &object);
+  return object;
 }
 
 template <class... Args> inline Light &Scene::make_light(Args &&...args) {
@@ -54,6 +130,10 @@ inline Mesh &Scene::mesh(std::unique_ptr<Mesh> mesh) {
   return *_meshs.back();
 }
 
+inline GeometryArena *Scene::geometry_arena() const {
+  return _geometry_arena.get();
+}
+
 inline const Camera &Scene::camera() const { return *_camera; }
 inline Camera &Scene::camera() { return *_camera; }
 
@@ -61,22 +141,60 @@ inline const std::vector<std::unique_ptr<Object>> &Scene::objects() const {
   return _objects;
 }
 
+inline const ObjectBVH &Scene::bvh() const { return _bvh; }
+
+inline Object *Scene::pick(const Ray &ray) const {
+  Object *closest = nullptr;
+  _bvh.raycast(ray, std::numeric_limits<float>::infinity(),
+               [&](Object *object, float max_t) {
+                 auto t = object->raycast(ray, max_t);
+                 if (t < max_t) closest = object;
+                 return t;
+               });
+  return closest;
+}
+
 inline const std::vector<std::unique_ptr<Light>> &Scene::lights() const {
   return _lights;
 }
 
+inline LightClusters &Scene::light_clusters() { return _light_clusters; }
+
+inline const LightClusters &Scene::light_clusters() const {
+  return _light_clusters;
+}
+
 inline const std::optional<GLuint> &Scene::shadow_map() const {
   return _shadow_map;
 }
 
 inline void Scene::shadow_map(GLuint tex) { _shadow_map = tex; }
 
-inline const std::optional<glm::mat4> &Scene::light_space_matrix() const {
-  return _light_space_matrix;
+inline const ShadowCascades &Scene::shadow_cascades() const {
+  return _shadow_cascades;
+}
+
+inline void Scene::shadow_cascades(const ShadowCascades &cascades) {
+  _shadow_cascades = cascades;
+}
+
+inline const std::optional<GLuint> &Scene::point_shadow_map() const {
+  return _point_shadow_map;
+}
+
+inline void Scene::point_shadow_map(GLuint tex) { _point_shadow_map = tex; }
+
+inline float Scene::point_shadow_bias() const { return _point_shadow_bias; }
+
+inline void Scene::point_shadow_bias(float bias) { _point_shadow_bias = bias; }
+
+inline const std::vector<const Light *> &Scene::point_shadow_lights() const {
+  return _point_shadow_lights;
 }
 
-inline void Scene::light_space_matrix(const glm::mat4 &mat) {
-  _light_space_matrix = mat;
+inline void
+Scene::point_shadow_lights(const std::vector<const Light *> &lights) {
+  _point_shadow_lights = lights;
 }
 
 GLE_NAMESPACE_END
\ No newline at end of file
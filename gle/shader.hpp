@@ -6,8 +6,11 @@
 #include <gle/light.hpp>
 #include <gle/scene.hpp>
 #include <gle/texture.hpp>
+#include <deque>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 GLE_NAMESPACE_BEGIN
 
@@ -20,15 +23,20 @@ struct Material {
   inline virtual void preload(const Shader &shader) const;
 
   inline virtual ~Material();
+
+  /// @brief if the depth of the objects with this material is written by a
+  ///        DepthPrePass, so ObjectRenderPass only shades their visible
+  ///        fragments. The shader must declare gl_Position invariant, and
+  ///        leaves holes where it discards fragments, as the pre-pass
+  ///        already hid what is behind them
+  ///
+  bool depth_prepass = false;
 };
 
-/// @brief Structure representing the matrices for model view and projection
+/// @brief Structure representing the matrices for view and projection
 ///
+/// The model matrix is a per-instance vertex attribute, see Mesh::instances
 struct MVPShaderUniforms {
-  /// @brief the model matrix
-  ///
-  glm::mat4 model;
-
   /// @brief the view matrix
   ///
   glm::mat4 view;
@@ -39,17 +47,63 @@ struct MVPShaderUniforms {
 
   /// @brief Construct a new MVPShaderUniforms object with the given values
   ///
-  /// @param model
   /// @param view
   /// @param projection
-  inline MVPShaderUniforms(const glm::mat4 &model, const glm::mat4 &view,
-                           const glm::mat4 &projection);
+  inline MVPShaderUniforms(const glm::mat4 &view, const glm::mat4 &projection);
   /// @brief Load the current values into the given shader's uniforms
   ///
   /// @param shader
   inline void load(const Shader &shader) const;
 };
 
+/// @brief A resolved uniform location
+///
+/// Handles are resolved once with Shader::uniform_handle() and can then be
+/// passed to Shader::uniform() without any name lookup.
+struct UniformHandle {
+  GLint location = -1;
+
+  /// @brief Check if the handle refers to an active uniform
+  ///
+  /// @return true if the uniform is active in the shader program
+  inline bool valid() const;
+};
+
+namespace __internal__ {
+
+/// @brief Table of uniform names to locations, filled once after linking
+///
+class UniformTable {
+public:
+  /// @brief Remove all entries
+  ///
+  inline void clear();
+
+  /// @brief Add a uniform to the table
+  ///
+  /// @param name
+  /// @param location
+  inline void add(const std::string &name, GLint location);
+
+  /// @brief Find the location of a uniform
+  ///
+  /// @param name
+  /// @return the location, or -1 if the uniform is not active
+  inline GLint find(std::string_view name) const;
+
+  /// @brief Get the number of entries in the table
+  ///
+  /// @return std::size_t
+  inline std::size_t size() const;
+
+private:
+  // deque so the views held by the map stay valid as names are added
+  std::deque<std::string> names;
+  std::unordered_map<std::string_view, GLint> locations;
+};
+
+} // namespace __internal__
+
 /// @brief A complete shader program including vertex, fragment and geometry
 ///        shaders
 class Shader {
@@ -89,12 +143,22 @@ public:
 
   inline void use() const;
 
-  /// @brief Use the shader and load the given uniforms
+  /// @brief Use the shader and load the given uniforms and material
   ///
   /// @param uniforms
   inline void use(const Scene &scene, const MVPShaderUniforms &uniforms,
                   const Material &material) const;
 
+  /// @brief Use the shader and load the given uniforms without a material
+  ///
+  /// @param uniforms
+  inline void use(const Scene &scene, const MVPShaderUniforms &uniforms) const;
+
+  /// @brief Load the given material, the shader must be in use
+  ///
+  /// @param material
+  inline void load_material(const Material &material) const;
+
   /// @brief Set the given uniform to the given value
   ///
   /// @param name
@@ -156,6 +220,74 @@ public:
   /// @param val
   inline void uniform(const char *name, GLuint i, const Texture &val) const;
 
+  /// @brief Resolve the handle of a uniform
+  ///
+  /// Must be called after the shader is loaded
+  /// @param name
+  /// @return the uniform handle, invalid if the uniform is not active
+  inline UniformHandle uniform_handle(const char *name) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, float val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::vec2 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::vec3 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::vec4 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::mat2 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::mat3 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, const glm::mat4 &val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, std::uint32_t val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param val
+  inline void uniform(UniformHandle handle, std::int32_t val) const;
+
+  /// @brief Set the given uniform to the given value
+  ///
+  /// @param handle
+  /// @param i
+  /// @param val
+  inline void uniform(UniformHandle handle, GLuint i, const Texture &val) const;
+
   inline bool is_loaded() const;
 
 protected:
@@ -164,13 +296,20 @@ protected:
   inline virtual void on_use() const;
 
 private:
+  /// @brief Read the active uniforms of the linked program into the uniform
+  ///        table
+  ///
+  inline void load_uniform_table();
+
   std::string vertex_source;
   std::string fragment_source;
   std::optional<std::string> geometry_source;
-  GLuint program;
-  GLuint vertex_shader;
-  GLuint geometry_shader;
-  GLuint fragment_shader;
+  // 0 until load() creates them
+  GLuint program = 0;
+  GLuint vertex_shader = 0;
+  GLuint geometry_shader = 0;
+  GLuint fragment_shader = 0;
+  __internal__::UniformTable uniform_table;
   bool _is_loaded;
 };
 
@@ -1,40 +1,15 @@
 
 #include <array>
 #include <glm/gtc/type_ptr.hpp>
+#include <string>
 
 GLE_NAMESPACE_BEGIN
 
-constexpr std::size_t MAX_LIGHTS = 20;
-
 namespace __internal__ {
 
-const char *vertex_default_begin = R"(
-#version 410
-
-in vec3 position;
-in vec3 normal;
-in vec3 tangent;
-in vec3 bitangent;
-in vec2 uv;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-uniform mat4 light_space_matrix;
-
-struct Camera {
-  vec3 origin;
-  vec3 direction;
-};
-
-uniform Camera camera;
-)";
-
-const char *fragment_default_begin = R"(
-#version 410
-
-out vec4 FragColor;
+const char *glsl_version = "#version 410\n";
 
+const char *scene_uniforms_source = R"(
 #define POINT_LIGHT 0
 #define DIRECTIONAL_LIGHT 1
 
@@ -43,6 +18,9 @@ struct Light {
   vec3 position;
   vec3 direction;
   vec3 attn;
+  float radius;
+  // Layer of the point shadow cube map array, -1 if the light has none
+  int shadow_layer;
 };
 
 struct Camera {
@@ -50,40 +28,140 @@ struct Camera {
   vec3 direction;
 };
 
-uniform sampler2D shadow_map;
-uniform Camera camera;
-uniform Light lights[20];
-uniform uint num_lights;
+layout (std140) uniform SceneUniforms {
+  mat4 light_space_matrices[MAX_SHADOW_CASCADES];
+  mat4 camera_view;
+  mat4 camera_projection;
+  Camera camera;
+  uvec4 cluster_grid;
+  // near, far, slices / log(far / near)
+  vec4 cluster_depth;
+  // The view depth where each shadow cascade ends
+  vec4 shadow_cascade_splits;
+  uint num_lights;
+  uint num_shadow_cascades;
+  // Fraction of the light radius
+  float point_shadow_bias;
+};
+)";
+
+const char *vertex_default_begin = R"(
+in vec3 position;
+in vec3 normal;
+// xyz is the tangent, w is the handedness of the bitangent
+in vec4 tangent;
+in vec2 uv;
+// Per-instance model matrix
+in mat4 model;
+
+vec3 get_bitangent() { return cross(normal, tangent.xyz) * tangent.w; }
+
+uniform mat4 view;
+uniform mat4 projection;
+)";
+
+const char *fragment_default_begin = R"(
+out vec4 FragColor;
+
+uniform sampler2DArray shadow_map;
+uniform samplerCubeArray point_shadow_map;
+uniform samplerBuffer light_data;
+uniform usamplerBuffer cluster_ranges;
+uniform usamplerBuffer cluster_lights;
+
+Light get_light(in uint i) {
+  vec4 a = texelFetch(light_data, int(i) * 3);
+  vec4 b = texelFetch(light_data, int(i) * 3 + 1);
+  vec4 c = texelFetch(light_data, int(i) * 3 + 2);
+  return Light(uint(a.w), a.xyz, b.xyz, c.xyz, b.w, int(c.w));
+}
+
+// Get the fraction of a point light blocked at the given world space position
+float point_shadow(in Light light, in vec3 world_position) {
+  if (light.shadow_layer < 0)
+    return 0.0;
+  // The cube maps store the distance to the light over the light radius
+  vec3 light_to_position = world_position - light.position;
+  float current_depth = length(light_to_position) / light.radius;
+  float closest_depth = texture(point_shadow_map,
+                                vec4(light_to_position, light.shadow_layer)).r;
+  return current_depth - point_shadow_bias > closest_depth ? 1.0 : 0.0;
+}
+
+// Get the (offset, count) range of the lights in the cluster containing the
+// given world space position
+uvec2 get_cluster(in vec3 world_position) {
+  vec4 view_position = camera_view * vec4(world_position, 1.0);
+  vec4 clip_position = camera_projection * view_position;
+  vec2 ndc = clip_position.xy / clip_position.w;
+  vec2 grid = vec2(cluster_grid.xy);
+  uvec2 tile = uvec2(clamp((ndc * 0.5 + 0.5) * grid, vec2(0), grid - 1.0));
+  float depth = max(-view_position.z, cluster_depth.x);
+  float slice = floor(log(depth / cluster_depth.x) * cluster_depth.z);
+  uint z = uint(clamp(slice, 0.0, float(cluster_grid.z) - 1.0));
+  uint index = tile.x + cluster_grid.x * (tile.y + cluster_grid.y * z);
+  return texelFetch(cluster_ranges, int(index)).xy;
+}
+
+// Get the index of the i'th light of a cluster
+uint get_cluster_light(in uvec2 cluster, in uint i) {
+  return texelFetch(cluster_lights, int(cluster.x + i)).x;
+}
+
+// Get the shadow cascade covering the given world space position, the
+// position must be inside the shadow distance if there are no cascades
+uint get_shadow_cascade(in vec3 world_position) {
+  float depth = dot(world_position - camera.origin, camera.direction);
+  for (uint i = 0u; i + 1u < num_shadow_cascades; i++) {
+    if (depth < shadow_cascade_splits[i])
+      return i;
+  }
+  return max(num_shadow_cascades, 1u) - 1u;
+}
 )";
 
+inline std::string with_default_header(const char *header,
+                                       const std::string &source) {
+  // The arrays of the uniform block are sized like SceneUniformBlock
+  return std::string(glsl_version) + "#define MAX_SHADOW_CASCADES " +
+         std::to_string(MAX_SHADOW_CASCADES) + "\n" + scene_uniforms_source +
+         header + source;
+}
+
 } // namespace __internal__
 
 inline Shader::Shader(const std::string &vertex_source,
                       const std::string &fragment_source, bool include_headers)
-    : vertex_source(include_headers
-                        ? __internal__::vertex_default_begin + vertex_source
-                        : vertex_source),
-      fragment_source(include_headers ? __internal__::fragment_default_begin +
-                                            fragment_source
-                                      : fragment_source),
+    : vertex_source(include_headers ? __internal__::with_default_header(
+                                          __internal__::vertex_default_begin,
+                                          vertex_source)
+                                    : vertex_source),
+      fragment_source(include_headers
+                          ? __internal__::with_default_header(
+                                __internal__::fragment_default_begin,
+                                fragment_source)
+                          : fragment_source),
       geometry_source(std::nullopt), _is_loaded(false) {}
 
 inline Shader::Shader(const std::string &vertex_source,
                       const std::string &fragment_source,
                       const std::string &geometry_source, bool include_headers)
-    : vertex_source(include_headers
-                        ? __internal__::vertex_default_begin + vertex_source
-                        : vertex_source),
-      fragment_source(include_headers ? __internal__::fragment_default_begin +
-                                            fragment_source
-                                      : fragment_source),
+    : vertex_source(include_headers ? __internal__::with_default_header(
+                                          __internal__::vertex_default_begin,
+                                          vertex_source)
+                                    : vertex_source),
+      fragment_source(include_headers
+                          ? __internal__::with_default_header(
+                                __internal__::fragment_default_begin,
+                                fragment_source)
+                          : fragment_source),
       geometry_source(geometry_source), _is_loaded(false) {}
 
 inline Shader::~Shader() {
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
-  if (geometry_source.has_value()) glDeleteShader(geometry_shader);
-  glDeleteProgram(program);
+  if (vertex_shader) glDeleteShader(vertex_shader);
+  if (fragment_shader) glDeleteShader(fragment_shader);
+  if (geometry_shader) glDeleteShader(geometry_shader);
+  if (program) glDeleteProgram(program);
 }
 
 namespace __internal__ {
@@ -120,8 +198,9 @@ inline void Shader::load() {
   glBindAttribLocation(program, 0, "position");
   glBindAttribLocation(program, 1, "normal");
   glBindAttribLocation(program, 2, "tangent");
-  glBindAttribLocation(program, 3, "bitangent");
-  glBindAttribLocation(program, 4, "uv");
+  glBindAttribLocation(program, 3, "uv");
+  // A mat4 attribute takes the locations 4 to 7
+  glBindAttribLocation(program, 4, "model");
 
   glAttachShader(program, vertex_shader);
   glAttachShader(program, fragment_shader);
@@ -136,105 +215,201 @@ inline void Shader::load() {
     GLE_LOG(GLE_ERR, "shader error: %s", message);
     throw std::runtime_error(message);
   }
+
+  load_uniform_table();
+
+  auto scene_uniforms = glGetUniformBlockIndex(program, "SceneUniforms");
+  if (scene_uniforms != GL_INVALID_INDEX)
+    glUniformBlockBinding(program, scene_uniforms, SCENE_UNIFORMS_BINDING);
+
+  // Sampler units are program state, so the units of the textures bound by
+  // the scene only have to be set once
+  glUseProgram(program);
+  uniform("shadow_map", (GLint)SHADOW_MAP_TEXTURE_UNIT);
+  uniform("point_shadow_map", (GLint)POINT_SHADOW_MAP_TEXTURE_UNIT);
+  uniform("light_data", (GLint)LIGHT_DATA_TEXTURE_UNIT);
+  uniform("cluster_ranges", (GLint)CLUSTER_RANGES_TEXTURE_UNIT);
+  uniform("cluster_lights", (GLint)CLUSTER_LIGHTS_TEXTURE_UNIT);
+}
+
+inline void Shader::load_uniform_table() {
+  uniform_table.clear();
+
+  GLint num_uniforms;
+  GLint max_name_length;
+  glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &num_uniforms);
+  glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+  auto name_buffer = std::string(max_name_length, '\0');
+  for (GLint i = 0; i < num_uniforms; i++) {
+    GLsizei length;
+    GLint size;
+    GLenum type;
+    glGetActiveUniform(program, i, max_name_length, &length, &size, &type,
+                       name_buffer.data());
+    auto name = name_buffer.substr(0, length);
+
+    // Arrays of basic types are reported once as "name[0]", so every element
+    // gets its own entry along with the bare array name
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+      auto base = name.substr(0, name.size() - 3);
+      uniform_table.add(base, glGetUniformLocation(program, name.c_str()));
+      for (GLint j = 0; j < size; j++) {
+        auto element = base + "[" + std::to_string(j) + "]";
+        uniform_table.add(element,
+                          glGetUniformLocation(program, element.c_str()));
+      }
+    } else {
+      uniform_table.add(name, glGetUniformLocation(program, name.c_str()));
+    }
+  }
 }
 
 inline void Shader::use() const { glUseProgram(program); }
 
 inline void Shader::use(const Scene &scene, const MVPShaderUniforms &uniforms,
                         const Material &material) const {
-  const auto &lights = scene.lights();
-  const auto &camera = scene.camera();
+  use(scene, uniforms);
+  load_material(material);
+}
 
-  material.preload(*this);
+inline void Shader::use(const Scene &,
+                        const MVPShaderUniforms &uniforms) const {
+  // Lights, light clusters, camera and the shadow map are uploaded once per
+  // frame by Scene::upload_uniforms
   glUseProgram(program);
   on_use();
-  if (lights.size() > MAX_LIGHTS)
-    throw std::runtime_error("number of lights exceeded the max lights");
-  uniform("num_lights", (std::uint32_t)lights.size());
-  for (std::uint32_t i = 0; i < lights.size(); i++) {
-    std::string n = "lights[" + std::to_string(i) + "].";
-    uniform((n + "type").c_str(), lights.at(i)->type);
-    uniform((n + "direction").c_str(), glm::normalize(lights.at(i)->direction));
-    uniform((n + "position").c_str(), lights.at(i)->position);
-    uniform((n + "attn").c_str(), lights.at(i)->attn);
-  }
-  uniform("camera.origin", camera.origin());
-  uniform("camera.direction", camera.direction());
-  if (scene.shadow_map().has_value()) {
-    glActiveTexture(GL_TEXTURE15);
-    glBindTexture(GL_TEXTURE_2D, scene.shadow_map().value());
-    uniform("shadow_map", (GLint)15);
-  }
-  if (scene.light_space_matrix().has_value())
-    uniform("light_space_matrix", scene.light_space_matrix().value());
   uniforms.load(*this);
+}
+
+inline void Shader::load_material(const Material &material) const {
+  material.preload(*this);
   material.load(*this);
 }
 
+inline UniformHandle Shader::uniform_handle(const char *name) const {
+  return UniformHandle{uniform_table.find(name)};
+}
+
 inline void Shader::uniform(const char *name, float val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform1f(u, val);
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, std::uint32_t val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform1ui(u, val);
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, std::int32_t val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform1i(u, val);
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::vec2 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform2fv(u, 1, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::vec3 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform3fv(u, 1, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::vec4 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniform4fv(u, 1, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::mat2 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniformMatrix2fv(u, 1, GL_FALSE, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::mat3 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniformMatrix3fv(u, 1, GL_FALSE, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, const glm::mat4 &val) const {
-  auto u = glGetUniformLocation(program, name);
-  glUniformMatrix4fv(u, 1, GL_FALSE, glm::value_ptr(val));
+  uniform(uniform_handle(name), val);
 }
 
 inline void Shader::uniform(const char *name, GLuint i,
                             const Texture &tex) const {
+  uniform(uniform_handle(name), i, tex);
+}
+
+inline void Shader::uniform(UniformHandle handle, float val) const {
+  glUniform1f(handle.location, val);
+}
+
+inline void Shader::uniform(UniformHandle handle, std::uint32_t val) const {
+  glUniform1ui(handle.location, val);
+}
+
+inline void Shader::uniform(UniformHandle handle, std::int32_t val) const {
+  glUniform1i(handle.location, val);
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::vec2 &val) const {
+  glUniform2fv(handle.location, 1, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::vec3 &val) const {
+  glUniform3fv(handle.location, 1, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::vec4 &val) const {
+  glUniform4fv(handle.location, 1, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::mat2 &val) const {
+  glUniformMatrix2fv(handle.location, 1, GL_FALSE, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::mat3 &val) const {
+  glUniformMatrix3fv(handle.location, 1, GL_FALSE, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, const glm::mat4 &val) const {
+  glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(val));
+}
+
+inline void Shader::uniform(UniformHandle handle, GLuint i,
+                            const Texture &tex) const {
 
   glActiveTexture(GL_TEXTURE0 + i);
   tex.bind();
-  uniform(name, (GLint)i);
+  uniform(handle, (GLint)i);
 }
 
-inline MVPShaderUniforms::MVPShaderUniforms(const glm::mat4 &model,
-                                            const glm::mat4 &view,
+inline MVPShaderUniforms::MVPShaderUniforms(const glm::mat4 &view,
                                             const glm::mat4 &projection)
-    : model(model), view(view), projection(projection) {}
+    : view(view), projection(projection) {}
 
 inline void MVPShaderUniforms::load(const Shader &shader) const {
-  shader.uniform("model", model);
   shader.uniform("view", view);
   shader.uniform("projection", projection);
 }
 
+inline bool UniformHandle::valid() const { return location != -1; }
+
+namespace __internal__ {
+
+inline void UniformTable::clear() {
+  locations.clear();
+  names.clear();
+}
+
+inline void UniformTable::add(const std::string &name, GLint location) {
+  if (locations.count(name)) return;
+  names.push_back(name);
+  locations.emplace(names.back(), location);
+}
+
+inline GLint UniformTable::find(std::string_view name) const {
+  auto it = locations.find(name);
+  if (it == locations.end()) return -1;
+  return it->second;
+}
+
+inline std::size_t UniformTable::size() const { return locations.size(); }
+
+} // namespace __internal__
+
 inline void Shader::on_use() const {}
 inline void Material::preload(const Shader &) const {};
 
@@ -242,4 +417,26 @@ inline Material::~Material() {}
 
 inline bool Shader::is_loaded() const { return _is_loaded; }
 
-GLE_NAMESPACE_END
\ No newline at end of file
+GLE_NAMESPACE_END
+
+#ifdef GLE_TEST_CASES
+
+TEST_CASE("__internal__::UniformTable finds uniforms by name") {
+  auto table = gle::__internal__::UniformTable();
+  table.add("model", 0);
+  table.add("lights[0].type", 4);
+  table.add("lights[1].type", 9);
+  table.add("model", 7);
+
+  CHECK(table.size() == 3);
+  CHECK(table.find("model") == 0);
+  CHECK(table.find("lights[1].type") == 9);
+  CHECK(table.find(std::string("lights[0].") + "type") == 4);
+  CHECK(table.find("view") == -1);
+
+  table.clear();
+  CHECK(table.size() == 0);
+  CHECK(table.find("model") == -1);
+}
+
+#endif
\ No newline at end of file
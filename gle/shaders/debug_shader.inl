@@ -12,8 +12,9 @@ void main() {
   gl_Position = view * model * vec4(position, 1.0);
   mat3 normal_matrix = mat3(transpose(inverse(view * model)));
   vs_out.normal = normalize(vec3(vec4(normal_matrix * normal, 0.0)));
-  vs_out.tangent = normalize(vec3(vec4(normal_matrix * tangent, 0.0)));
-  vs_out.bitangent = normalize(vec3(vec4(normal_matrix * bitangent, 0.0)));
+  vs_out.tangent = normalize(vec3(vec4(normal_matrix * tangent.xyz, 0.0)));
+  vs_out.bitangent =
+      normalize(vec3(vec4(normal_matrix * get_bitangent(), 0.0)));
 }
 )";
 
@@ -2,21 +2,21 @@ GLE_NAMESPACE_BEGIN
 
 namespace __internal__ {
 const char *solid_color_vertex_shader = R"(
+// Same depth as the depth pre-pass, for its GL_EQUAL depth test
+invariant gl_Position;
+
 out vec3 frag_normal;
 out vec3 frag_position;
-out vec4 frag_position_light_space;
 
 void main() {
   frag_normal = mat3(transpose(inverse(model))) * normal;
   gl_Position = projection * view * model * vec4(position, 1.0);
   frag_position = (model * vec4(position, 1.0)).xyz;
-  frag_position_light_space = light_space_matrix * vec4(frag_position, 1.0);
 }
 )";
 const char *solid_color_fragment_shader = R"(
 in vec3 frag_normal;
 in vec3 frag_position;
-in vec4 frag_position_light_space;
 
 struct Material {
   vec3 color;
@@ -37,6 +37,11 @@ vec3 dir_light(in Light light, in vec3 view_dir, in vec3 normal) {
 
 
 float shadow(in vec3 normal, in vec3 light_dir) {
+  if (num_shadow_cascades == 0u)
+    return 0.0;
+  uint cascade = get_shadow_cascade(frag_position);
+  vec4 frag_position_light_space =
+      light_space_matrices[cascade] * vec4(frag_position, 1.0);
   vec3 proj_coords = frag_position_light_space.xyz / frag_position_light_space.w;
   proj_coords = proj_coords * 0.5 + 0.5;
   if(proj_coords.z > 1.0)
@@ -47,10 +52,11 @@ float shadow(in vec3 normal, in vec3 light_dir) {
   float bias = max(0.05 * (1.0 - dot(normal, light_dir)), 0.005);
 
   float shadow = 0.0;
-  vec2 texel_size = 1.0 / textureSize(shadow_map, 0);
+  vec2 texel_size = 1.0 / vec2(textureSize(shadow_map, 0).xy);
   for(int x = -1; x <= 1; x++) {
     for(int y = -1; y <= 1; y++) {
-      float pcf_depth = texture(shadow_map, proj_coords.xy + vec2(x, y) * texel_size).r;
+      vec2 pcf_uv = proj_coords.xy + vec2(x, y) * texel_size;
+      float pcf_depth = texture(shadow_map, vec3(pcf_uv, cascade)).r;
       shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
     }
   }
@@ -64,15 +70,21 @@ void main() {
   vec3 view_dir = normalize(camera.origin - frag_position);
   vec3 normal = normalize(frag_normal);
   vec3 light_dir = vec3(0);
-  for (uint i = 0; i < num_lights; i++) {
+  uvec2 cluster = get_cluster(frag_position);
+  for (uint i = 0; i < cluster.y; i++) {
+    Light cluster_light = get_light(get_cluster_light(cluster, i));
     float point_attn = 1.0;
-    if (lights[i].type == POINT_LIGHT) {
-      float dist = distance(frag_position, lights[i].position);
-      point_attn = 1.0 / (1.0 + dist * dist);
-    } else if (lights[i].type == DIRECTIONAL_LIGHT && light_dir == vec3(0)) {
-      light_dir = normalize(lights[i].direction);
+    if (cluster_light.type == POINT_LIGHT) {
+      float dist = distance(frag_position, cluster_light.position);
+      if (dist > cluster_light.radius)
+        continue;
+      point_attn = (1.0 - point_shadow(cluster_light, frag_position))
+                   / (1.0 + dist * dist);
+    } else if (cluster_light.type == DIRECTIONAL_LIGHT
+               && light_dir == vec3(0)) {
+      light_dir = normalize(cluster_light.direction);
     }
-    attn += dir_light(lights[i], view_dir, normal) * point_attn;
+    attn += dir_light(cluster_light, view_dir, normal) * point_attn;
   }
   attn *= 1.0 - shadow(normal, light_dir);
   attn += vec3(0.2);
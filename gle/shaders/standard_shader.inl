@@ -2,9 +2,11 @@ GLE_NAMESPACE_BEGIN
 
 namespace __internal__ {
 const char *standard_vertex_shader = R"(
+// Same depth as the depth pre-pass, for its GL_EQUAL depth test
+invariant gl_Position;
+
 out vec3 frag_normal;
 out vec3 frag_position;
-out vec4 frag_position_light_space;
 out vec2 frag_uv;
 
 out mat3 tbn;
@@ -19,10 +21,8 @@ void main() {
   gl_Position = projection * view * model * vec4(position, 1.0);
   frag_position = (model * vec4(position, 1.0)).xyz;
 
-  frag_position_light_space = light_space_matrix * vec4(frag_position, 1.0);
-
-  vec3 T = normalize(vec3(model * vec4(tangent, 0.0)));
-  vec3 B = normalize(vec3(model * vec4(bitangent, 0.0)));
+  vec3 T = normalize(vec3(model * vec4(tangent.xyz, 0.0)));
+  vec3 B = normalize(vec3(model * vec4(get_bitangent(), 0.0)));
   vec3 N = normalize(vec3(model * vec4(normal, 0.0)));
   tbn = mat3(T, B, N);
   mat3 tbn_t = transpose(tbn);
@@ -35,7 +35,6 @@ void main() {
 const char *standard_fragment_shader = R"(
 in vec3 frag_normal;
 in vec3 frag_position;
-in vec4 frag_position_light_space;
 in vec2 frag_uv;
 in vec3 tangent_light_pos;
 in vec3 tangent_view_pos;
@@ -65,6 +64,11 @@ vec3 light(in Light light, in vec3 view_dir, in vec3 normal) {
 }
 
 float shadow(in vec3 normal, in vec3 light_dir) {
+  if (num_shadow_cascades == 0u)
+    return 0.0;
+  uint cascade = get_shadow_cascade(frag_position);
+  vec4 frag_position_light_space =
+      light_space_matrices[cascade] * vec4(frag_position, 1.0);
   vec3 proj_coords = frag_position_light_space.xyz / frag_position_light_space.w;
   proj_coords = proj_coords * 0.5 + 0.5;
   if(proj_coords.z > 1.0)
@@ -76,10 +80,11 @@ float shadow(in vec3 normal, in vec3 light_dir) {
   // float bias = 0.005;
 
   float shadow = 0.0;
-  vec2 texel_size = 1.0 / textureSize(shadow_map, 0);
+  vec2 texel_size = 1.0 / vec2(textureSize(shadow_map, 0).xy);
   for(int x = -1; x <= 1; x++) {
     for(int y = -1; y <= 1; y++) {
-      float pcf_depth = texture(shadow_map, proj_coords.xy + vec2(x, y) * texel_size).r;
+      vec2 pcf_uv = proj_coords.xy + vec2(x, y) * texel_size;
+      float pcf_depth = texture(shadow_map, vec3(pcf_uv, cascade)).r;
       shadow += current_depth - bias > pcf_depth ? 1.0 : 0.0;
     }
   }
@@ -146,15 +151,21 @@ void main() {
   normal = normal * 2.0 - 1.0;
   normal = normalize(tbn * normal);
   vec3 light_dir = vec3(0);
-  for (uint i = 0; i < num_lights; i++) {
+  uvec2 cluster = get_cluster(frag_position);
+  for (uint i = 0; i < cluster.y; i++) {
+    Light cluster_light = get_light(get_cluster_light(cluster, i));
     float point_attn = 1.0;
-    if (lights[i].type == POINT_LIGHT) {
-      float dist = distance(frag_position, lights[i].position);
-      point_attn = 1.0 / (1.0 + dist * dist);
-    } else if (lights[i].type == DIRECTIONAL_LIGHT && light_dir == vec3(0)) {
-      light_dir = normalize(lights[i].direction);
+    if (cluster_light.type == POINT_LIGHT) {
+      float dist = distance(frag_position, cluster_light.position);
+      if (dist > cluster_light.radius)
+        continue;
+      point_attn = (1.0 - point_shadow(cluster_light, frag_position))
+                   / (1.0 + dist * dist);
+    } else if (cluster_light.type == DIRECTIONAL_LIGHT
+               && light_dir == vec3(0)) {
+      light_dir = normalize(cluster_light.direction);
     }
-    attn += light(lights[i], view_dir, normal) * point_attn;
+    attn += light(cluster_light, view_dir, normal) * point_attn;
   }
   attn *= 1.0 - shadow(normalize(frag_normal), light_dir);
   attn += vec3(0.2); // ambient
@@ -1,3 +1,5 @@
+#include <fstream>
+
 GLE_NAMESPACE_BEGIN
 
 // lovely C
@@ -0,0 +1,49 @@
+#ifndef GLE_UBO_HPP
+#define GLE_UBO_HPP
+
+#include <gle/common.hpp>
+#include <gle/gl.hpp>
+
+GLE_NAMESPACE_BEGIN
+
+/// @brief A uniform buffer object holding a single uniform block
+///
+/// @tparam T the block structure. It must match the std140 layout of the
+///           block declared in the shaders.
+template <class T> class UBO {
+public:
+  UBO(UBO &) = delete;
+  UBO(UBO &&) = delete;
+  UBO(const UBO &) = delete;
+  UBO(const UBO &&) = delete;
+
+  inline UBO();
+
+  inline ~UBO();
+
+  /// @brief Gen the buffer and allocate storage for the block
+  ///
+  /// Must be called after GL is initialized
+  inline void init();
+
+  /// @brief Bind the buffer
+  ///
+  inline void bind() const;
+
+  /// @brief Bind the buffer to the given uniform block binding point
+  ///
+  /// @param binding
+  inline void bind_base(GLuint binding) const;
+
+  /// @brief write the block to the buffer
+  ///
+  /// @param data
+  inline void write(const T &data) const;
+
+private:
+  GLuint handle;
+};
+
+GLE_NAMESPACE_END
+
+#endif // GLE_UBO_HPP
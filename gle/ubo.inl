@@ -0,0 +1,28 @@
+GLE_NAMESPACE_BEGIN
+
+template <class T> inline UBO<T>::UBO() : handle(0) {}
+
+template <class T> inline UBO<T>::~UBO() {
+  if (handle) glDeleteBuffers(1, &handle);
+}
+
+template <class T> inline void UBO<T>::init() {
+  glGenBuffers(1, &handle);
+  bind();
+  glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+}
+
+template <class T> inline void UBO<T>::bind() const {
+  glBindBuffer(GL_UNIFORM_BUFFER, handle);
+}
+
+template <class T> inline void UBO<T>::bind_base(GLuint binding) const {
+  glBindBufferBase(GL_UNIFORM_BUFFER, binding, handle);
+}
+
+template <class T> inline void UBO<T>::write(const T &data) const {
+  bind();
+  glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+}
+
+GLE_NAMESPACE_END
\ No newline at end of file
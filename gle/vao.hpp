@@ -1,6 +1,7 @@
 #ifndef GLE_VAO_HPP
 #define GLE_VAO_HPP
 
+#include <cstddef>
 #include <gle/common.hpp>
 #include <gle/gl.hpp>
 #include <gle/vbo.hpp>
@@ -28,13 +29,48 @@ public:
   ///
   inline void bind() const;
 
-  /// @brief Attribute vbo to this VAO
+  /// @brief unbind the current vao so later buffer binds are not recorded in
+  ///        it
   ///
+  static inline void unbind();
+
+  /// @brief Attribute vbo to this VAO and enable the attribute
+  ///
+  /// The attribute state is recorded in the VAO, so this only needs to be
+  /// called once when the buffers are created. Integer values stay integers
+  /// in the shaders unless they are Normalized or packed 10_10_10_2 values.
   /// @tparam T
   /// @param index
   /// @param vbo
   template <class T> inline void attr(GLuint index, const VBO<T> &vbo) const;
 
+  /// @brief Attribute a member of the elements of an interleaved vbo to this
+  ///        VAO
+  ///
+  /// ## Example:
+  ///     vao.attr<glm::vec3>(1, vbo, offsetof(Vertex, normal));
+  ///
+  /// @tparam U the type of the member
+  /// @tparam T the type of the vbo elements
+  /// @param index
+  /// @param vbo
+  /// @param offset the offset of the member in T
+  template <class U, class T>
+  inline void attr(GLuint index, const VBO<T> &vbo, std::size_t offset) const;
+
+  /// @brief Set the attribute to advance once every divisor instances instead
+  ///        of once per vertex
+  ///
+  /// @param index
+  /// @param divisor
+  inline void divisor(GLuint index, GLuint divisor) const;
+
+  /// @brief Record the element buffer used when drawing with this VAO
+  ///
+  /// @tparam T
+  /// @param vbo a GL_ELEMENT_ARRAY_BUFFER vbo
+  template <class T> inline void elements(const VBO<T> &vbo) const;
+
 private:
   GLuint handle;
 };
@@ -7,28 +7,55 @@ inline VAO::~VAO() {
 }
 inline void VAO::init() { glGenVertexArrays(1, &handle); }
 inline void VAO::bind() const { glBindVertexArray(handle); }
+inline void VAO::unbind() { glBindVertexArray(0); }
 
 template <class T>
 inline void VAO::attr(GLuint index, const VBO<T> &vbo) const {
+  static_assert(VBO<T>::gl_value_type != GL_NONE,
+                "interleaved vbos must be attributed by member offset");
+  attr<T>(index, vbo, 0);
+}
+
+template <class U, class T>
+inline void VAO::attr(GLuint index, const VBO<T> &vbo,
+                      std::size_t offset) const {
+  constexpr auto value_type = __internal__::vbo_value_type<U>::value;
+  constexpr auto value_size = __internal__::vbo_value_size<U>::value;
+  constexpr auto normalized = __internal__::vbo_value_normalized<U>::value;
 
   bind();
   vbo.bind();
 
-  switch (VBO<T>::gl_value_type) {
+  switch (value_type) {
   case GL_BYTE:
   case GL_UNSIGNED_BYTE:
   case GL_SHORT:
   case GL_UNSIGNED_SHORT:
   case GL_INT:
   case GL_UNSIGNED_INT:
-    glVertexAttribIPointer(index, VBO<T>::gl_value_size, VBO<T>::gl_value_type,
-                           sizeof(T), (void *)0);
-    break;
+    if (!normalized) {
+      glVertexAttribIPointer(index, value_size, value_type, sizeof(T),
+                             (void *)offset);
+      break;
+    }
+    [[fallthrough]];
   default:
-    glVertexAttribPointer(index, VBO<T>::gl_value_size, VBO<T>::gl_value_type,
-                          GL_FALSE, sizeof(T), (void *)0);
+    glVertexAttribPointer(index, value_size, value_type,
+                          normalized ? GL_TRUE : GL_FALSE, sizeof(T),
+                          (void *)offset);
     break;
   }
+  glEnableVertexAttribArray(index);
+}
+
+inline void VAO::divisor(GLuint index, GLuint divisor) const {
+  bind();
+  glVertexAttribDivisor(index, divisor);
+}
+
+template <class T> inline void VAO::elements(const VBO<T> &vbo) const {
+  bind();
+  vbo.bind();
 }
 
 GLE_NAMESPACE_END
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef GLE_VBO_HPP
 #define GLE_VBO_HPP
 
+#include <cstddef>
+#include <cstdint>
 #include <gle/common.hpp>
 #include <gle/gl.hpp>
 #include <glm/glm.hpp>
@@ -9,6 +11,44 @@
 
 GLE_NAMESPACE_BEGIN
 
+/// @brief An integer value or glm vector read as floats by the shaders,
+///        in [0, 1] when unsigned and [-1, 1] when signed
+///
+/// ## Example:
+///     VBO<Normalized<glm::vec<4, std::uint8_t>>> colors(GL_ARRAY_BUFFER,
+///                                                       false);
+///
+/// @tparam T the stored integer type, e.g. glm::vec<4, std::int16_t>
+template <class T> struct Normalized {
+  using type = T;
+  T value;
+};
+
+/// @brief A vector of L half floats, the bits are packed with
+///        glm::packHalf1x16
+///
+/// @tparam L the number of components
+template <glm::length_t L> struct HalfVec {
+  static constexpr glm::length_t length = L;
+  glm::vec<L, std::uint16_t> bits;
+};
+
+/// @brief Three signed normalized 10 bit components and a 2 bit one in a
+///        single integer (GL_INT_2_10_10_10_REV), packed with
+///        glm::packSnorm3x10_1x2
+///
+struct PackedSnorm1010102 {
+  std::uint32_t bits;
+};
+
+/// @brief Three unsigned normalized 10 bit components and a 2 bit one in a
+///        single integer (GL_UNSIGNED_INT_2_10_10_10_REV), packed with
+///        glm::packUnorm3x10_1x2
+///
+struct PackedUnorm1010102 {
+  std::uint32_t bits;
+};
+
 // C++ voodoo
 namespace __internal__ {
 
@@ -35,9 +75,38 @@ static_assert(is_glm_vec_of<glm::ivec3, int>::value);
 static_assert(is_glm_vec_of<glm::ivec4, int>::value);
 static_assert(!is_glm_vec_of<glm::ivec2, float>::value);
 
+// See if T is U or a vector with inner type U
+template <class T, class U>
+struct is_scalar_or_vec_of
+    : std::integral_constant<bool, std::is_same<T, U>::value ||
+                                       is_glm_vec_of<T, U>::value> {};
+
+template <class T> struct is_normalized : std::false_type {};
+template <class T> struct is_normalized<Normalized<T>> : std::true_type {};
+
+template <class T> struct is_half_vec : std::false_type {};
+template <glm::length_t L> struct is_half_vec<HalfVec<L>> : std::true_type {};
+
+template <class T>
+struct is_packed_1010102
+    : std::integral_constant<bool,
+                             std::is_same<T, PackedSnorm1010102>::value ||
+                                 std::is_same<T, PackedUnorm1010102>::value> {
+};
+
+template <class T> constexpr GLuint vbo_get_value_type();
+
 template <class T> constexpr GLint vbo_get_value_size() {
   if constexpr (std::is_fundamental<T>::value)
     return 1;
+  else if constexpr (is_normalized<T>::value)
+    return vbo_get_value_size<typename T::type>();
+  else if constexpr (is_half_vec<T>::value)
+    return T::length;
+  else if constexpr (is_packed_1010102<T>::value)
+    return 4;
+  else if constexpr (vbo_get_value_type<T>() == GL_NONE)
+    return 0;
   else
     return sizeof(T) / sizeof(typename T::value_type);
 }
@@ -57,6 +126,26 @@ template <class T> constexpr GLuint vbo_get_value_type() {
     return GL_UNSIGNED_INT;
   else if constexpr (std::is_same<T, unsigned int>::value)
     return GL_UNSIGNED_INT;
+  else if constexpr (is_scalar_or_vec_of<T, std::int16_t>::value)
+    return GL_SHORT;
+  else if constexpr (is_scalar_or_vec_of<T, std::uint16_t>::value)
+    return GL_UNSIGNED_SHORT;
+  else if constexpr (is_scalar_or_vec_of<T, std::int8_t>::value)
+    return GL_BYTE;
+  else if constexpr (is_scalar_or_vec_of<T, std::uint8_t>::value)
+    return GL_UNSIGNED_BYTE;
+  else if constexpr (is_normalized<T>::value)
+    return vbo_get_value_type<typename T::type>();
+  else if constexpr (is_half_vec<T>::value)
+    return GL_HALF_FLOAT;
+  else if constexpr (std::is_same<T, PackedSnorm1010102>::value)
+    return GL_INT_2_10_10_10_REV;
+  else if constexpr (std::is_same<T, PackedUnorm1010102>::value)
+    return GL_UNSIGNED_INT_2_10_10_10_REV;
+  else if constexpr (std::is_class<T>::value)
+    // Composite types (e.g. interleaved vertices) have no single value type,
+    // their members are attributed by offset with VAO::attr
+    return GL_NONE;
   else
     static_assert(dependent_false<T>::value, "Unable to detect VBO value type");
 }
@@ -70,17 +159,30 @@ template <class T>
 struct vbo_value_size : std::integral_constant<GLint, vbo_get_value_size<T>()> {
 };
 
+// Normalized integers and packed formats are converted to floats, other
+// integers stay integers in the shaders
+template <class T>
+struct vbo_value_normalized
+    : std::integral_constant<bool, is_normalized<T>::value ||
+                                       is_packed_1010102<T>::value> {};
+
 static_assert(vbo_value_size<float>::value == 1);
 static_assert(vbo_value_size<int>::value == 1);
 static_assert(vbo_value_size<glm::vec3>::value == 3);
 static_assert(vbo_value_size<glm::uvec2>::value == 2);
+static_assert(vbo_value_size<Normalized<glm::vec<4, std::int16_t>>>::value ==
+              4);
+static_assert(vbo_value_size<HalfVec<2>>::value == 2);
+static_assert(vbo_value_size<PackedSnorm1010102>::value == 4);
 
 } // namespace __internal__
 
 /// @brief A VBO
 ///
-/// @tparam T the type of data stored in this vbo. This can be a float, int, or
-///           glm float vector or glm int vector.
+/// @tparam T the type of data stored in this vbo. This can be a float, int,
+///           glm float vector, glm int vector, 8 or 16 bit integer vector,
+///           Normalized integer vector, HalfVec, packed 10_10_10_2 value or
+///           a struct of those for interleaved data.
 template <class T> class VBO {
 public:
   /// @brief the type of OpenGL value stored in this vbo (e.g. GL_FLOAT)
@@ -90,9 +192,16 @@ public:
 
   /// @brief the number of components per element
   ///
-  /// For example, a VBO<glm::vec3> has a value size of 3
+  /// For example, a VBO<glm::vec3> has a value size of 3. Interleaved VBOs
+  /// have a value type of GL_NONE and a value size of 0
   static constexpr GLint gl_value_size = __internal__::vbo_value_size<T>::value;
 
+  /// @brief if the values are integers converted to floats in [0, 1] or
+  ///        [-1, 1] when read by the shaders
+  ///
+  static constexpr bool gl_normalized =
+      __internal__::vbo_value_normalized<T>::value;
+
   VBO(VBO &) = delete;
   VBO(VBO &&) = delete;
   VBO(const VBO &) = delete;
@@ -120,6 +229,34 @@ public:
   /// @param data
   inline void write(const std::vector<T> &data);
 
+  /// @brief write count elements starting at data to the buffers
+  ///
+  /// @param data
+  /// @param count
+  inline void write(const T *data, std::size_t count);
+
+  /// @brief Allocate room for count elements, the content is undefined
+  ///
+  /// @param count
+  inline void reserve(std::size_t count);
+
+  /// @brief Overwrite count elements of the buffers starting at element
+  ///        first, the buffers must hold at least first + count elements
+  ///
+  /// @param first
+  /// @param data
+  /// @param count
+  inline void write_at(std::size_t first, const T *data, std::size_t count);
+
+  /// @brief Move the content of the buffers to new buffers of count
+  ///        elements, keeping the first kept elements
+  ///
+  /// The handle changes, so VAOs reading this vbo must be attributed again
+  ///
+  /// @param kept
+  /// @param count
+  inline void resize(std::size_t kept, std::size_t count);
+
 private:
   GLuint type;
   GLuint handle;
@@ -135,6 +272,16 @@ static_assert(VBO<float>::gl_value_type == GL_FLOAT);
 static_assert(VBO<int>::gl_value_type == GL_INT);
 static_assert(VBO<glm::vec3>::gl_value_type == GL_FLOAT);
 static_assert(VBO<glm::ivec3>::gl_value_type == GL_INT);
+static_assert(VBO<glm::vec<4, std::uint8_t>>::gl_value_type ==
+              GL_UNSIGNED_BYTE);
+static_assert(VBO<Normalized<glm::vec<4, std::uint16_t>>>::gl_value_type ==
+              GL_UNSIGNED_SHORT);
+static_assert(VBO<HalfVec<2>>::gl_value_type == GL_HALF_FLOAT);
+static_assert(VBO<PackedSnorm1010102>::gl_value_type == GL_INT_2_10_10_10_REV);
+
+static_assert(!VBO<glm::vec<4, std::int16_t>>::gl_normalized);
+static_assert(VBO<Normalized<glm::vec<4, std::int16_t>>>::gl_normalized);
+static_assert(VBO<PackedUnorm1010102>::gl_normalized);
 
 GLE_NAMESPACE_END
 
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 GLE_NAMESPACE_BEGIN
 
 template <class T>
@@ -15,9 +17,40 @@ template <class T> inline void VBO<T>::bind() const {
 }
 
 template <class T> inline void VBO<T>::write(const std::vector<T> &data) {
+  write(data.data(), data.size());
+}
+
+template <class T>
+inline void VBO<T>::write(const T *data, std::size_t count) {
+  bind();
+  glBufferData(type, sizeof(T) * count, data,
+               dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+}
+
+template <class T> inline void VBO<T>::reserve(std::size_t count) {
+  write(nullptr, count);
+}
+
+template <class T>
+inline void VBO<T>::write_at(std::size_t first, const T *data,
+                             std::size_t count) {
   bind();
-  glBufferData(type, sizeof(T) * data.size(), data.data(),
+  glBufferSubData(type, sizeof(T) * first, sizeof(T) * count, data);
+}
+
+template <class T>
+inline void VBO<T>::resize(std::size_t kept, std::size_t count) {
+  auto old = handle;
+  glGenBuffers(1, &handle);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, handle);
+  glBufferData(GL_COPY_WRITE_BUFFER, sizeof(T) * count, nullptr,
                dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+  if (old) {
+    glBindBuffer(GL_COPY_READ_BUFFER, old);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        sizeof(T) * std::min(kept, count));
+    glDeleteBuffers(1, &old);
+  }
 }
 
 GLE_NAMESPACE_END
\ No newline at end of file
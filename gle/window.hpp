@@ -56,6 +56,11 @@ struct WindowOptions {
   /// @brief OpenGL minor version
   ///
   int gl_minor_version = 1;
+
+  /// @brief If the window is shown. Hidden windows are useful to get a GL
+  ///        context for tools and benchmarks. Default: true
+  ///
+  bool visible = true;
 };
 
 /// @brief Representation of the graphics window
@@ -107,10 +112,10 @@ public:
 
   /// @brief Start the window rendering loop
   ///
-  inline void start(const Scene &scene);
+  inline void start(Scene &scene);
 
   template <class T, class... Args>
-  inline RenderPass &make_render_pass(Args &&...args);
+  inline T &make_render_pass(Args &&...args);
 
   inline void add_keyboard_listener(KeyboardListener &listener);
 
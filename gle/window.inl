@@ -85,6 +85,7 @@ inline void Window::init(Scene &scene) {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, options().gl_minor_version);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+  glfwWindowHint(GLFW_VISIBLE, options().visible ? GL_TRUE : GL_FALSE);
 
   _window =
       glfwCreateWindow(width(), height(), name().c_str(), nullptr, nullptr);
@@ -142,7 +143,7 @@ inline void Window::init(Scene &scene) {
   }
 }
 
-inline void Window::start(const Scene &scene) {
+inline void Window::start(Scene &scene) {
   while (!glfwWindowShouldClose(window())) {
 #ifdef DEBUG_TIMER
     auto start_time = glfwGetTime();
@@ -151,6 +152,11 @@ inline void Window::start(const Scene &scene) {
                  _clear_color.a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    for (const auto &pass : render_passes) {
+      pass->update(scene);
+    }
+    scene.upload_uniforms();
+
     for (const auto &pass : render_passes) {
       glViewport(0, 0, width(), height());
       pass->do_render(scene);
@@ -169,9 +175,11 @@ inline void Window::start(const Scene &scene) {
 }
 
 template <class T, class... Args>
-inline RenderPass &Window::make_render_pass(Args &&...args) {
-  render_passes.push_back(std::make_unique<T>(std::forward<Args>(args)...));
-  return *render_passes.back();
+inline T &Window::make_render_pass(Args &&...args) {
+  auto pass = std::make_unique<T>(std::forward<Args>(args)...);
+  auto &ref = *pass;
+  render_passes.push_back(std::move(pass));
+  return ref;
 }
 
 constexpr WindowOptions &Window::options() { return _options; }
@@ -0,0 +1,1061 @@
+#define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <doctest.h>
+#include <fstream>
+#include <gle/gle.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <limits>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Benchmarks are run with `bin/benchmarks`, a single benchmark can be selected
+// with `bin/benchmarks -tc="<name>"`. Benchmarks that need a GL context open a
+// hidden window.
+
+namespace bench {
+
+/// @brief Run fn the given number of times and get the average time per run
+///
+/// @return the average time per run in microseconds
+template <class F> inline double time_us(std::size_t iterations, F &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; i++) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() /
+         (double)iterations;
+}
+
+inline void report(const std::string &name, double us) {
+  std::printf("%-48s %12.3f us\n", name.c_str(), us);
+}
+
+inline gle::WindowOptions hidden_window_options() {
+  auto options = gle::WindowOptions();
+  options.visible = false;
+  return options;
+}
+
+inline void make_default_camera(gle::Scene &scene) {
+  scene.make_camera(glm::vec3(10, 5, 10), glm::vec3(0, 1, 0),
+                    glm::vec3(-10, -5, -10), 1.0f, glm::radians(45.0f), 0.1f,
+                    100.0f);
+}
+
+} // namespace bench
+
+TEST_CASE("shader uniform submit cost per object") {
+  const std::size_t num_objects = 5000;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(0.8, 0.8, 0.8), 1.0, 1.0);
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  for (int i = 0; i < 4; i++) {
+    scene.make_light(gle::POINT_LIGHT, glm::vec3(i, 1, 0), glm::vec3(0),
+                     glm::vec3(1), 1.0);
+  }
+  bench::make_default_camera(scene);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 64, 64);
+  window.init(scene);
+
+  auto uniforms = gle::MVPShaderUniforms(scene.camera().view_matrix(),
+                                         scene.camera().projection_matrix());
+
+  // The uniforms Shader::use used to set by name for every object, each set
+  // with the setter of its type so no call fails
+  enum class Type { FLOAT, UINT, VEC3, MAT4 };
+  auto names = std::vector<std::pair<std::string, Type>>{
+      {"model", Type::MAT4},
+      {"view", Type::MAT4},
+      {"projection", Type::MAT4},
+      {"num_lights", Type::UINT},
+      {"camera.origin", Type::VEC3},
+      {"camera.direction", Type::VEC3},
+      {"mat.color", Type::VEC3},
+      {"mat.diffuse", Type::FLOAT},
+      {"mat.specular", Type::FLOAT},
+      {"light_space_matrix", Type::MAT4}};
+  for (std::size_t i = 0; i < scene.lights().size(); i++) {
+    auto light = "lights[" + std::to_string(i) + "].";
+    names.emplace_back(light + "type", Type::UINT);
+    names.emplace_back(light + "direction", Type::VEC3);
+    names.emplace_back(light + "position", Type::VEC3);
+    names.emplace_back(light + "attn", Type::VEC3);
+  }
+  // Sets a uniform with any of the overloads of Shader::uniform
+  auto set = [&](auto &&target, Type type) {
+    switch (type) {
+    case Type::FLOAT:
+      shader.uniform(target, 1.0f);
+      break;
+    case Type::UINT:
+      shader.uniform(target, std::uint32_t(1));
+      break;
+    case Type::VEC3:
+      shader.uniform(target, glm::vec3(1));
+      break;
+    case Type::MAT4:
+      shader.uniform(target, glm::mat4(1));
+      break;
+    }
+  };
+
+  shader.use();
+  GLint program;
+  glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+
+  auto value_mat4 = glm::mat4(1);
+  auto value_vec3 = glm::vec3(1);
+  auto by_location_lookup = bench::time_us(num_objects, [&]() {
+    for (const auto &[name, type] : names) {
+      auto location = glGetUniformLocation(program, name.c_str());
+      switch (type) {
+      case Type::FLOAT:
+        glUniform1f(location, 1.0f);
+        break;
+      case Type::UINT:
+        glUniform1ui(location, 1);
+        break;
+      case Type::VEC3:
+        glUniform3fv(location, 1, glm::value_ptr(value_vec3));
+        break;
+      case Type::MAT4:
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value_mat4));
+        break;
+      }
+    }
+  });
+  auto by_table = bench::time_us(num_objects, [&]() {
+    for (const auto &[name, type] : names) {
+      set(name.c_str(), type);
+    }
+  });
+  auto handles = std::vector<std::pair<gle::UniformHandle, Type>>();
+  for (const auto &[name, type] : names) {
+    handles.emplace_back(shader.uniform_handle(name.c_str()), type);
+  }
+  auto by_handle = bench::time_us(num_objects, [&]() {
+    for (const auto &[handle, type] : handles) {
+      set(handle, type);
+    }
+  });
+  auto submit = bench::time_us(num_objects, [&]() {
+    shader.use(scene, uniforms, material);
+  });
+  auto upload = bench::time_us(num_objects, [&]() { scene.upload_uniforms(); });
+  glFinish();
+
+  bench::report("glGetUniformLocation per uniform", by_location_lookup);
+  bench::report("uniform table lookup per uniform", by_table);
+  bench::report("uniform handle per uniform", by_handle);
+  bench::report("Shader::use per object", submit);
+  bench::report("Scene::upload_uniforms per frame", upload);
+}
+
+TEST_CASE("clustered lighting frame time by number of lights") {
+  for (std::size_t num_lights : {16, 64, 256, 1024}) {
+    auto scene = gle::Scene();
+    auto &shader = scene.make_shader<gle::SolidColorShader>();
+    auto &material = scene.make_material<gle::SolidColorMaterial>(
+        glm::vec3(0.8, 0.8, 0.8), 1.0, 1.0);
+    auto &plane_mesh = scene.mesh(gle::make_plane_mesh(50));
+    scene.make_object(shader, material, plane_mesh, glm::vec3(-50, 0, -50),
+                      glm::vec3(0), glm::vec3(100));
+    scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0),
+                     glm::vec3(-1, -1, -1), glm::vec3(1), 1.0);
+    for (std::size_t i = 0; i < num_lights; i++) {
+      auto position = glm::vec3((float)(i % 32) * 3.0f - 48.0f, 0.5f,
+                                (float)(i / 32) * 3.0f - 48.0f);
+      scene.make_light(gle::POINT_LIGHT, position, glm::vec3(0),
+                       glm::vec3(1, 0.8, 0.6), 0.05f);
+    }
+    bench::make_default_camera(scene);
+
+    auto window =
+        gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+    auto &pass = window.make_render_pass<gle::ObjectRenderPass>();
+    window.init(scene);
+
+    auto assign = bench::time_us(100, [&]() {
+      scene.light_clusters().assign(scene.camera(), scene.lights());
+    });
+    auto frame = bench::time_us(100, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      scene.upload_uniforms();
+      pass.do_render(scene);
+      glFinish();
+    });
+
+    auto lights = std::to_string(num_lights) + " lights";
+    bench::report(lights + ": light assignment", assign);
+    bench::report(lights + ": frame", frame);
+  }
+}
+
+TEST_CASE("mesh draw call cost per object") {
+  const std::size_t num_objects = 5000;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &mesh = scene.mesh(gle::make_cube_mesh());
+  bench::make_default_camera(scene);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 64, 64);
+  window.init(scene);
+  shader.use();
+
+  // The draw path before attribute state was recorded in the VAO: the
+  // pointers were re-specified and enabled, the element buffer re-bound and
+  // the arrays disabled again for every draw (15 GL calls per object)
+  auto legacy_vao = gle::VAO();
+  auto legacy_vertices = gle::VBO<gle::Vertex>(GL_ARRAY_BUFFER, false);
+  auto legacy_triangles =
+      gle::VBO<glm::uvec3>(GL_ELEMENT_ARRAY_BUFFER, false);
+  legacy_vao.init();
+  legacy_vao.bind();
+  legacy_vertices.init();
+  legacy_triangles.init();
+  legacy_vertices.write(mesh.interleaved_vertices());
+  legacy_triangles.write(mesh.triangles());
+  gle::VAO::unbind();
+
+  auto respecified = bench::time_us(num_objects, [&]() {
+    legacy_vao.bind();
+    legacy_vao.attr<glm::vec3>(0, legacy_vertices,
+                               offsetof(gle::Vertex, position));
+    legacy_vao.attr<glm::vec3>(1, legacy_vertices,
+                               offsetof(gle::Vertex, normal));
+    legacy_vao.attr<glm::vec4>(2, legacy_vertices,
+                               offsetof(gle::Vertex, tangent));
+    legacy_vao.attr<glm::vec2>(3, legacy_vertices, offsetof(gle::Vertex, uv));
+    legacy_triangles.bind();
+    glDrawElements(GL_TRIANGLES, mesh.num_elements(), GL_UNSIGNED_INT,
+                   (void *)0);
+    for (GLuint i = 0; i < 4; i++) {
+      glDisableVertexAttribArray(i);
+    }
+  });
+  glFinish();
+
+  // glBindVertexArray + glDrawElements
+  auto recorded = bench::time_us(num_objects, [&]() { mesh.draw(); });
+  glFinish();
+
+  bench::report("re-specified attributes per object", respecified);
+  bench::report("recorded VAO per object", recorded);
+}
+
+TEST_CASE("render queue state changes per frame") {
+  const std::size_t num_objects = 10000;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto materials = std::vector<gle::Material *>();
+  for (int i = 0; i < 8; i++) {
+    materials.push_back(&scene.make_material<gle::SolidColorMaterial>(
+        glm::vec3(0.1f * (float)i), 1.0, 1.0));
+  }
+  auto meshes = std::vector<gle::Mesh *>{
+      &scene.mesh(gle::make_cube_mesh()),
+      &scene.mesh(gle::make_ico_sphere_mesh(1)),
+      &scene.mesh(gle::make_plane_mesh(4))};
+  // Interleave the state so insertion order changes state on every object
+  for (std::size_t i = 0; i < num_objects; i++) {
+    scene.make_object(shader, *materials[i % materials.size()],
+                      *meshes[i % meshes.size()],
+                      glm::vec3((float)(i % 100), 0, (float)(i / 100)),
+                      glm::vec3(0), glm::vec3(0.5));
+  }
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  bench::make_default_camera(scene);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+  auto &pass = window.make_render_pass<gle::ObjectRenderPass>();
+  window.init(scene);
+
+  auto frame = bench::time_us(20, [&]() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.upload_uniforms();
+    pass.do_render(scene);
+    glFinish();
+  });
+
+  const auto &stats = pass.stats();
+  std::printf("%zu objects, %zu culled, %zu draws, %zu program, %zu material "
+              "and %zu mesh changes per frame (unsorted: %zu each)\n",
+              stats.objects, stats.culled, stats.draws, stats.program_changes,
+              stats.material_changes, stats.mesh_changes, stats.objects);
+  bench::report("sorted render queue frame", frame);
+}
+
+TEST_CASE("BVH queries over 100k objects") {
+  const std::size_t num_objects = 100000;
+
+  auto rng = std::mt19937(1);
+  auto coord = std::uniform_real_distribution<float>(-1000.0f, 1000.0f);
+  auto size = std::uniform_real_distribution<float>(0.5f, 4.0f);
+  auto boxes = std::vector<gle::AABB>();
+  for (std::size_t i = 0; i < num_objects; i++) {
+    auto min = glm::vec3(coord(rng), coord(rng) * 0.05f, coord(rng));
+    boxes.push_back(
+        gle::AABB{min, min + glm::vec3(size(rng), size(rng), size(rng))});
+  }
+
+  auto bvh = gle::BVH<std::uint32_t>();
+  auto proxies = std::vector<gle::BVH<std::uint32_t>::Proxy>();
+  auto build = bench::time_us(1, [&]() {
+    for (std::size_t i = 0; i < num_objects; i++) {
+      proxies.push_back(bvh.insert(boxes[i], (std::uint32_t)i));
+    }
+  });
+
+  auto camera = gle::Camera(glm::vec3(0, 20, 0), glm::vec3(0, 1, 0),
+                            glm::vec3(1, -0.1, 0.3), 16.0f / 9.0f,
+                            glm::radians(60.0f), 0.1f, 300.0f);
+  const auto &frustum = camera.frustum();
+
+  std::size_t visible = 0;
+  auto linear_frustum = bench::time_us(20, [&]() {
+    visible = 0;
+    for (const auto &box : boxes) {
+      if (frustum.intersects(box)) visible++;
+    }
+  });
+  auto bvh_frustum = bench::time_us(20, [&]() {
+    visible = 0;
+    bvh.query(frustum, [&](std::uint32_t) { visible++; });
+  });
+
+  auto ray = camera.ray(glm::vec2(0.1f, -0.2f));
+  auto linear_hit = std::numeric_limits<float>::infinity();
+  auto linear_ray = bench::time_us(20, [&]() {
+    linear_hit = std::numeric_limits<float>::infinity();
+    for (const auto &box : boxes) {
+      linear_hit = ray.intersect(box, linear_hit);
+    }
+  });
+  auto bvh_hit = std::numeric_limits<float>::infinity();
+  auto bvh_ray = bench::time_us(20, [&]() {
+    bvh_hit = std::numeric_limits<float>::infinity();
+    bvh.raycast(ray, bvh_hit, [&](std::uint32_t i, float max_t) {
+      bvh_hit = std::min(bvh_hit, ray.intersect(boxes[i], max_t));
+      return bvh_hit;
+    });
+  });
+  CHECK(linear_hit == bvh_hit);
+
+  // Move 1% of the objects a little every frame
+  auto refit = bench::time_us(20, [&]() {
+    for (std::size_t i = 0; i < num_objects; i += 100) {
+      boxes[i].min += glm::vec3(0.05f);
+      boxes[i].max += glm::vec3(0.05f);
+      bvh.move(proxies[i], boxes[i]);
+    }
+  });
+
+  std::printf("%zu objects, %zu in the frustum, tree height %d\n", num_objects,
+              visible, bvh.height());
+  bench::report("BVH build", build);
+  bench::report("linear frustum cull", linear_frustum);
+  bench::report("BVH frustum cull", bvh_frustum);
+  bench::report("linear ray cast", linear_ray);
+  bench::report("BVH ray cast", bvh_ray);
+  bench::report("BVH refit of 1% of the objects", refit);
+}
+
+TEST_CASE("ico sphere generation by subdivision level") {
+  auto vertices = std::vector<glm::vec3>();
+  auto uvs = std::vector<glm::vec2>();
+  auto triangles = std::vector<glm::uvec3>();
+
+  // The linear scan for an existing midpoint that subdivision used before the
+  // edge cache, only run on the small levels since it is quadratic
+  auto linear_subdivide = [](int subdivisions) {
+    auto vertices = std::vector<glm::vec3>();
+    auto uvs = std::vector<glm::vec2>();
+    auto triangles = std::vector<glm::uvec3>();
+    gle::make_ico_sphere(0, vertices, uvs, triangles);
+    auto midpoint = [&](std::uint32_t a, std::uint32_t b) {
+      auto mid = (vertices[a] + vertices[b]) / 2.0f;
+      for (std::size_t i = 0; i < vertices.size(); i++) {
+        if (vertices[i] == mid) return (std::uint32_t)i;
+      }
+      vertices.push_back(mid);
+      return (std::uint32_t)vertices.size() - 1;
+    };
+    for (int i = 0; i < subdivisions; i++) {
+      auto new_triangles = std::vector<glm::uvec3>();
+      for (const auto &t : triangles) {
+        auto xy = midpoint(t.x, t.y);
+        auto yz = midpoint(t.y, t.z);
+        auto zx = midpoint(t.z, t.x);
+        new_triangles.push_back(glm::uvec3(t.x, xy, zx));
+        new_triangles.push_back(glm::uvec3(xy, t.y, yz));
+        new_triangles.push_back(glm::uvec3(zx, yz, t.z));
+        new_triangles.push_back(glm::uvec3(zx, xy, yz));
+      }
+      triangles = new_triangles;
+    }
+    return vertices.size();
+  };
+
+  for (int level = 0; level <= 7; level++) {
+    auto iterations = level < 5 ? 20 : 2;
+    auto arrays = bench::time_us(iterations, [&]() {
+      gle::make_ico_sphere(level, vertices, uvs, triangles);
+    });
+    auto mesh = bench::time_us(iterations, [&]() {
+      auto sphere = gle::make_ico_sphere_mesh(level);
+      CHECK(sphere->vertices().size() == vertices.size());
+    });
+
+    auto name = "level " + std::to_string(level) + " (" +
+                std::to_string(vertices.size()) + " vertices)";
+    bench::report(name + " arrays", arrays);
+    bench::report(name + " mesh", mesh);
+    if (level <= 5) {
+      std::size_t linear_vertices = 0;
+      auto linear = bench::time_us(1, [&]() {
+        linear_vertices = linear_subdivide(level);
+      });
+      CHECK(linear_vertices == vertices.size());
+      bench::report(name + " linear scan", linear);
+    }
+  }
+}
+
+TEST_CASE("calculate_normals by triangle count") {
+  auto num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("parallel runs use %u threads\n", num_threads);
+
+  // Plane meshes have 2 * n^2 triangles
+  for (int n : {71, 224, 708, 2237}) {
+    auto mesh = gle::make_plane_mesh(n);
+    auto iterations = n < 1000 ? 10 : 1;
+    auto serial =
+        bench::time_us(iterations, [&]() { mesh->calculate_normals(1); });
+    auto parallel = bench::time_us(
+        iterations, [&]() { mesh->calculate_normals(num_threads); });
+    CHECK(mesh->normals()[0] == glm::vec3(0, 1, 0));
+
+    auto name = std::to_string(mesh->triangles().size()) + " triangles";
+    bench::report(name + " serial", serial);
+    bench::report(name + " parallel", parallel);
+  }
+}
+
+TEST_CASE("obj parsing throughput") {
+  // A grid with a uv and normal per position and triangle faces without
+  // slashes, the subset of the format the stream parser understands
+  const int n = 500;
+  auto triangle_obj = std::string();
+  auto quad_obj = std::string();
+  char line[256];
+  for (int i = 0; i <= n; i++) {
+    for (int j = 0; j <= n; j++) {
+      std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0 1 0\n",
+                    (float)i * 0.37f, 0.0f, (float)j * -1.13f,
+                    (float)i / (float)n, (float)j / (float)n);
+      triangle_obj += line;
+      quad_obj += line;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      int a = i * (n + 1) + j + 1;
+      int b = a + n + 1;
+      std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", a, a + 1,
+                    b + 1, a, b + 1, b);
+      triangle_obj += line;
+      std::snprintf(line, sizeof(line),
+                    "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, a + 1,
+                    a + 1, a + 1, b + 1, b + 1, b + 1, b, b, b);
+      quad_obj += line;
+    }
+  }
+
+  auto path = std::string("gle_bench.obj");
+  auto write = [&](const std::string &contents) {
+    auto file = std::ofstream(path, std::ios_base::binary);
+    file << contents;
+  };
+  auto mb_per_s = [](const std::string &contents, double us) {
+    return (double)contents.size() / us;
+  };
+  auto num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+  write(triangle_obj);
+  std::size_t stream_triangles = 0;
+  auto stream = bench::time_us(1, [&]() {
+    auto file = std::ifstream(path);
+    stream_triangles = gle::load_obj(file)->triangles().size();
+  });
+  std::size_t parsed_triangles = 0;
+  auto parsed = bench::time_us(1, [&]() {
+    parsed_triangles = gle::parse_obj(gle::MappedFile(path).view(), num_threads)
+                           .triangles.size();
+  });
+  auto mapped = bench::time_us(1, [&]() {
+    auto mesh = gle::load_obj_from_file(path, num_threads);
+    CHECK(mesh->triangles().size() == stream_triangles);
+  });
+  CHECK(parsed_triangles == stream_triangles);
+
+  write(quad_obj);
+  auto quads = bench::time_us(1, [&]() {
+    auto data = gle::parse_obj(gle::MappedFile(path).view(), num_threads);
+    CHECK(data.vertices.size() == (std::size_t)(n + 1) * (n + 1));
+  });
+  std::remove(path.c_str());
+
+  std::printf("%.1f MB of triangles, %.1f MB of v/vt/vn quads, %u threads\n",
+              (double)triangle_obj.size() / 1e6,
+              (double)quad_obj.size() / 1e6, num_threads);
+  std::printf("stream parser %.1f MB/s, parse_obj %.1f MB/s, "
+              "v/vt/vn quads %.1f MB/s\n",
+              mb_per_s(triangle_obj, stream), mb_per_s(triangle_obj, parsed),
+              mb_per_s(quad_obj, quads));
+  bench::report("load_obj(std::istream &)", stream);
+  bench::report("parse_obj", parsed);
+  bench::report("load_obj_from_file", mapped);
+  bench::report("parse_obj v/vt/vn quads", quads);
+}
+
+TEST_CASE("cached mesh file loading") {
+  // The same grid obj as the parser benchmark, loaded by parsing it and
+  // calculating normals, then from the mesh file written by the first load
+  const int n = 500;
+  auto obj = std::string();
+  char line[256];
+  for (int i = 0; i <= n; i++) {
+    for (int j = 0; j <= n; j++) {
+      std::snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\n",
+                    (float)i * 0.37f, 0.0f, (float)j * -1.13f,
+                    (float)i / (float)n, (float)j / (float)n);
+      obj += line;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      int a = i * (n + 1) + j + 1;
+      int b = a + n + 1;
+      std::snprintf(line, sizeof(line), "f %d %d %d\nf %d %d %d\n", a, a + 1,
+                    b + 1, a, b + 1, b);
+      obj += line;
+    }
+  }
+
+  auto obj_path = std::string("gle_bench.obj");
+  auto mesh_path = obj_path + ".glemesh";
+  {
+    auto file = std::ofstream(obj_path, std::ios_base::binary);
+    file << obj;
+  }
+  std::remove(mesh_path.c_str());
+
+  std::size_t num_triangles = 0;
+  auto parsed = bench::time_us(1, [&]() {
+    num_triangles = gle::load_obj_cached(obj_path)->triangles().size();
+  });
+  auto cached = bench::time_us(5, [&]() {
+    CHECK(gle::load_obj_cached(obj_path)->triangles().size() == num_triangles);
+  });
+  auto read = bench::time_us(5, [&]() {
+    CHECK(gle::read_mesh(mesh_path)->triangles().size() == num_triangles);
+  });
+
+  auto quantized_path = std::string("gle_bench_quantized.glemesh");
+  auto quantize = gle::MeshFileOptions();
+  quantize.quantize = true;
+  gle::write_mesh(*gle::read_mesh(mesh_path), quantized_path, quantize);
+  auto quantized = bench::time_us(5, [&]() {
+    CHECK(gle::read_mesh(quantized_path)->triangles().size() == num_triangles);
+  });
+
+  std::remove(obj_path.c_str());
+  std::remove(mesh_path.c_str());
+  std::remove(quantized_path.c_str());
+
+  std::printf("%.1f MB obj, %zu triangles\n", (double)obj.size() / 1e6,
+              num_triangles);
+  bench::report("load_obj_cached, parse and write", parsed);
+  bench::report("load_obj_cached, mesh file", cached);
+  bench::report("read_mesh", read);
+  bench::report("read_mesh quantized", quantized);
+}
+
+TEST_CASE("mesh optimization ACMR") {
+  auto report = [](const char *name, gle::Mesh &mesh) {
+    std::size_t num_triangles = mesh.triangles().size();
+    auto stats = gle::MeshOptimizeStats();
+    auto us = bench::time_us(1, [&]() { stats = mesh.optimize(); });
+    std::printf("%-28s %8zu triangles, ACMR %.3f -> %.3f\n", name,
+                num_triangles, stats.acmr_before, stats.acmr_after);
+    bench::report(std::string("optimize ") + name, us);
+  };
+
+  auto sphere = gle::make_ico_sphere_mesh(6);
+  report("ico sphere 6", *sphere);
+
+  // A grid with randomly ordered triangles, like the triangle soups of
+  // scanned assets
+  const std::uint32_t n = 400;
+  auto vertices = std::vector<glm::vec3>();
+  auto triangles = std::vector<glm::uvec3>();
+  for (std::uint32_t i = 0; i <= n; i++) {
+    for (std::uint32_t j = 0; j <= n; j++) {
+      vertices.emplace_back(i, std::sin(0.1f * i) * std::cos(0.1f * j), j);
+    }
+  }
+  for (std::uint32_t i = 0; i < n; i++) {
+    for (std::uint32_t j = 0; j < n; j++) {
+      auto a = i * (n + 1) + j, b = a + n + 1;
+      triangles.emplace_back(a, a + 1, b + 1);
+      triangles.emplace_back(a, b + 1, b);
+    }
+  }
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(42));
+  auto grid = gle::Mesh(std::move(vertices), std::move(triangles));
+  report("shuffled grid", grid);
+}
+
+TEST_CASE("distant props with levels of detail") {
+  const std::size_t num_objects = 2000;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(0.8, 0.8, 0.8), 1.0, 1.0);
+  auto &mesh = scene.mesh(gle::make_ico_sphere_mesh(5));
+  auto generate = bench::time_us(1, [&]() { mesh.generate_lods(); });
+  mesh.optimize();
+  for (std::size_t i = 0; i < num_objects; i++) {
+    scene.make_object(shader, material, mesh,
+                      glm::vec3((float)(i % 40) * 4.0f, 0,
+                                -10.0f - (float)(i / 40) * 4.0f),
+                      glm::vec3(0), glm::vec3(1));
+  }
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  scene.make_camera(glm::vec3(80, 5, 0), glm::vec3(0, 1, 0),
+                    glm::vec3(0, -0.05, -1), 16.0f / 9.0f, glm::radians(60.0f),
+                    0.1f, 300.0f);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+  auto &full = window.make_render_pass<gle::ObjectRenderPass>(
+      gle::ObjectRenderOptions{0.0f});
+  auto &lods = window.make_render_pass<gle::ObjectRenderPass>();
+  window.init(scene);
+
+  auto frame = [&](const gle::ObjectRenderPass &pass) {
+    return bench::time_us(20, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      scene.upload_uniforms();
+      pass.do_render(scene);
+      glFinish();
+    });
+  };
+  auto full_frame = frame(full);
+  auto full_triangles = full.stats().triangles;
+  auto lod_frame = frame(lods);
+
+  std::printf("%zu of %zu triangles drawn with levels of detail\n",
+              lods.stats().triangles, full_triangles);
+  for (std::size_t lod = 1; lod < mesh.num_lods(); lod++) {
+    std::printf("lod %zu: %d triangles, error %g\n", lod,
+                mesh.num_elements(lod) / 3, mesh.lods()[lod - 1].error);
+  }
+  bench::report("generate_lods (ico sphere 5)", generate);
+  bench::report("full meshes frame", full_frame);
+  bench::report("levels of detail frame", lod_frame);
+}
+
+TEST_CASE("packed vertex format memory and vertex fetch") {
+  const std::size_t num_instances = 64;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &full = scene.mesh(gle::make_ico_sphere_mesh(6));
+  auto &packed = scene.mesh(gle::make_ico_sphere_mesh(6));
+  packed.vertex_format(gle::PACKED_VERTEX_FORMAT);
+  bench::make_default_camera(scene);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 256, 256);
+  window.init(scene);
+  shader.use();
+
+  // Many small instances so the frame is bound by vertex work
+  auto models = std::vector<glm::mat4>();
+  for (std::size_t i = 0; i < num_instances; i++) {
+    auto model = glm::mat4(0.05f);
+    model[3] = glm::vec4((float)(i % 8) - 4.0f, (float)(i / 8) - 4.0f, 0, 1);
+    models.push_back(model);
+  }
+  full.instances(models);
+  packed.instances(models);
+
+  auto frame = [&](const gle::Mesh &mesh) {
+    return bench::time_us(20, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      mesh.draw();
+      glFinish();
+    });
+  };
+  auto full_frame = frame(full);
+  auto packed_frame = frame(packed);
+
+  auto num_vertices = full.vertices().size();
+  std::printf("vertex buffer: %zu KiB -> %zu KiB\n",
+              num_vertices * sizeof(gle::Vertex) / 1024,
+              num_vertices * sizeof(gle::PackedVertex) / 1024);
+  bench::report("float vertices frame (ico sphere 6)", full_frame);
+  bench::report("packed vertices frame (ico sphere 6)", packed_frame);
+}
+
+TEST_CASE("meshlet cone and frustum culling") {
+  const std::size_t num_objects = 64;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  auto &mesh = scene.mesh(gle::make_ico_sphere_mesh(6));
+  mesh.optimize();
+  auto build = bench::time_us(1, [&]() { mesh.build_meshlets(); });
+  for (std::size_t i = 0; i < num_objects; i++) {
+    scene.make_object(shader, material, mesh,
+                      glm::vec3((float)(i % 8) * 3.0f - 10.5f, 0,
+                                -5.0f - (float)(i / 8) * 3.0f),
+                      glm::vec3(0), glm::vec3(1));
+  }
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  scene.make_camera(glm::vec3(0, 2, 0), glm::vec3(0, 1, 0),
+                    glm::vec3(0, -0.1, -1), 16.0f / 9.0f, glm::radians(60.0f),
+                    0.1f, 100.0f);
+
+  auto options = gle::ObjectRenderOptions();
+  options.meshlet_culling = false;
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+  auto &full = window.make_render_pass<gle::ObjectRenderPass>(options);
+  auto &culled = window.make_render_pass<gle::ObjectRenderPass>();
+  window.init(scene);
+
+  auto frame = [&](const gle::ObjectRenderPass &pass) {
+    return bench::time_us(20, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      scene.upload_uniforms();
+      pass.do_render(scene);
+      glFinish();
+    });
+  };
+  auto full_frame = frame(full);
+  auto culled_frame = frame(culled);
+
+  std::printf("%zu of %zu triangles drawn, %zu meshlets culled\n",
+              culled.stats().triangles, full.stats().triangles,
+              culled.stats().meshlets_culled);
+  bench::report("build_meshlets (ico sphere 6)", build);
+  bench::report("whole meshes frame", full_frame);
+  bench::report("culled meshlets frame", culled_frame);
+}
+
+TEST_CASE("multi draw indirect submission of 50k objects") {
+  const std::size_t num_objects = 50000;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  auto meshes = std::vector<gle::Mesh *>{
+      &scene.mesh(gle::make_cube_mesh()),
+      &scene.mesh(gle::make_ico_sphere_mesh(1)),
+      &scene.mesh(gle::make_ico_sphere_mesh(2)),
+      &scene.mesh(gle::make_plane_mesh(2)),
+  };
+  // Interleaved meshes, so the queue can't instance long runs of one mesh
+  // at the same depth
+  for (std::size_t i = 0; i < num_objects; i++) {
+    scene.make_object(shader, material, *meshes[(i * 7) % meshes.size()],
+                      glm::vec3((float)(i % 250) - 125.0f, 0,
+                                -1.0f - (float)(i / 250)),
+                      glm::vec3(0), glm::vec3(0.3f));
+  }
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  scene.make_camera(glm::vec3(0, 20, 10), glm::vec3(0, 1, 0),
+                    glm::vec3(0, -0.5, -1), 1.0f, glm::radians(90.0f), 0.1f,
+                    300.0f);
+
+  auto options = gle::ObjectRenderOptions();
+  options.multi_draw_indirect = false;
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 64, 64);
+  auto &direct = window.make_render_pass<gle::ObjectRenderPass>(options);
+  auto &indirect = window.make_render_pass<gle::ObjectRenderPass>();
+  window.init(scene);
+  if (!gle::GeometryArena::supported())
+    std::printf("no multi draw indirect, both passes draw directly\n");
+
+  auto frame = [&](const gle::ObjectRenderPass &pass) {
+    return bench::time_us(10, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      pass.do_render(scene);
+      glFinish();
+    });
+  };
+  auto direct_frame = frame(direct);
+  auto indirect_frame = frame(indirect);
+
+  std::printf("%zu objects: %zu draws direct, %zu draws and %zu commands "
+              "indirect\n",
+              indirect.stats().objects, direct.stats().draws,
+              indirect.stats().draws, indirect.stats().indirect_commands);
+  bench::report("instanced draws frame", direct_frame);
+  bench::report("multi draw indirect frame", indirect_frame);
+}
+
+TEST_CASE("hierarchical-Z occlusion culling behind walls") {
+  const std::size_t num_rows = 10;
+  const std::size_t props_per_row = 400;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto &material = scene.make_material<gle::SolidColorMaterial>(
+      glm::vec3(1), 1.0f, 0.5f);
+  auto &cube = scene.mesh(gle::make_cube_mesh());
+  auto &sphere = scene.mesh(gle::make_ico_sphere_mesh(3));
+  // Rows of props, each hidden behind a wall across the street
+  for (std::size_t row = 0; row < num_rows; row++) {
+    auto z = -10.0f - 20.0f * (float)row;
+    scene.make_object(shader, material, cube, glm::vec3(0, 3, z),
+                      glm::vec3(0), glm::vec3(100, 6, 0.5f));
+    for (std::size_t i = 0; i < props_per_row; i++) {
+      scene.make_object(shader, material, sphere,
+                        glm::vec3((float)(i % 80) - 40.0f, 0.5f,
+                                  z - 2.0f - (float)(i / 80) * 3.0f),
+                        glm::vec3(0), glm::vec3(0.5f));
+    }
+  }
+  scene.make_light(gle::DIRECTIONAL_LIGHT, glm::vec3(0), glm::vec3(-1, -1, -1),
+                   glm::vec3(1), 1.0);
+  scene.make_camera(glm::vec3(0, 2, 0), glm::vec3(0, 1, 0),
+                    glm::vec3(0, 0, -1), 16.0f / 9.0f, glm::radians(60.0f),
+                    0.1f, 300.0f);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+  auto &occlusion = window.make_render_pass<gle::HiZOcclusionPass>();
+  auto &all = window.make_render_pass<gle::ObjectRenderPass>();
+  auto options = gle::ObjectRenderOptions();
+  options.occlusion = &occlusion;
+  auto &culled = window.make_render_pass<gle::ObjectRenderPass>(options);
+  window.init(scene);
+
+  // The first depth buffers are only read back frames later
+  for (int i = 0; i < 3; i++) {
+    occlusion.do_render(scene);
+    glFinish();
+  }
+  auto occluders = bench::time_us(20, [&]() {
+    occlusion.do_render(scene);
+    glFinish();
+  });
+  auto frame = [&](const gle::ObjectRenderPass &pass) {
+    return bench::time_us(20, [&]() {
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      scene.upload_uniforms();
+      pass.do_render(scene);
+      glFinish();
+    });
+  };
+  auto all_frame = frame(all);
+  auto culled_frame = frame(culled);
+
+  std::size_t hidden = 0;
+  auto tests = bench::time_us(10, [&]() {
+    hidden = 0;
+    for (const auto &object : scene.objects()) {
+      if (!occlusion.pyramid().visible(object->world_bounds())) hidden++;
+    }
+  });
+
+  std::printf("%zu occluders, %zu of %zu objects hidden, %zu objects "
+              "drawn instead of %zu\n",
+              occlusion.stats().objects, hidden, scene.objects().size(),
+              culled.stats().objects, all.stats().objects);
+  bench::report("occluder depth and readback", occluders);
+  bench::report("pyramid tests per frame", tests);
+  bench::report("frame without occlusion culling", all_frame);
+  bench::report("frame with occlusion culling", culled_frame);
+}
+
+TEST_CASE("software occlusion rasterizer throughput") {
+  const std::size_t num_occluders = 200;
+
+  auto camera = gle::Camera(glm::vec3(0, 2, 0), glm::vec3(0, 1, 0),
+                            glm::vec3(0, 0, -1), 2.0f, glm::radians(60.0f),
+                            0.1f, 300.0f);
+  auto view_projection = camera.projection_matrix() * camera.view_matrix();
+  auto sphere = gle::make_ico_sphere_mesh(3);
+  auto random = std::mt19937(3);
+  auto x = std::uniform_real_distribution<float>(-40.0f, 40.0f);
+  auto z = std::uniform_real_distribution<float>(-120.0f, -10.0f);
+  auto models = std::vector<glm::mat4>();
+  for (std::size_t i = 0; i < num_occluders; i++) {
+    auto model = glm::translate(glm::mat4(1.0f), glm::vec3(x(random), 0,
+                                                           z(random)));
+    models.push_back(glm::scale(model, glm::vec3(3.0f)));
+  }
+
+  auto rasterize = [&](gle::OcclusionRasterizer &rasterizer) {
+    rasterizer.begin(view_projection);
+    for (const auto &model : models) {
+      rasterizer.add(sphere->vertices(), sphere->triangles(), model);
+    }
+    rasterizer.end();
+  };
+  auto options = gle::OcclusionRasterizerOptions();
+  auto single = gle::OcclusionRasterizer(options);
+  options.num_threads = 0;
+  auto threaded = gle::OcclusionRasterizer(options);
+  auto single_us = bench::time_us(20, [&]() { rasterize(single); });
+  auto threaded_us = bench::time_us(20, [&]() { rasterize(threaded); });
+
+  // The rows alone, without the vertex transform and the setup
+  auto triangles = std::vector<gle::__internal__::OcclusionTriangle>();
+  auto depth = std::vector<float>(options.width * options.height);
+  auto points = std::uniform_real_distribution<float>(0.0f, 1.0f);
+  auto triangle = gle::__internal__::OcclusionTriangle();
+  while (triangles.size() < 20000) {
+    auto point = [&]() {
+      return glm::vec3(points(random) * (float)options.width,
+                       points(random) * (float)options.height, points(random));
+    };
+    auto p0 = point();
+    // Small triangles, like the ones of distant occluders
+    if (gle::__internal__::setup_occlusion_triangle(
+            p0, p0 + glm::vec3(8, 0, 0), p0 + glm::vec3(0, 8, 0),
+            options.width, options.height, triangle))
+      triangles.push_back(triangle);
+  }
+  auto rows = [&](auto &&fn) {
+    return bench::time_us(20, [&]() {
+      std::fill(depth.begin(), depth.end(), 1.0f);
+      fn(triangles, depth.data(), options.width, 0, options.height);
+    });
+  };
+  auto scalar_us = rows(gle::__internal__::rasterize_rows_scalar);
+  auto simd_us = rows(gle::__internal__::rasterize_rows);
+
+  auto props = std::vector<gle::AABB>();
+  for (std::size_t i = 0; i < 10000; i++) {
+    auto center = glm::vec3(x(random), 0, z(random));
+    props.push_back(gle::AABB{center - glm::vec3(0.5f), center + 0.5f});
+  }
+  std::size_t hidden = 0;
+  auto tests = bench::time_us(20, [&]() {
+    hidden = 0;
+    for (const auto &bounds : props) {
+      if (!single.visible(bounds)) hidden++;
+    }
+  });
+
+  auto per_ms = [](std::size_t count, double us) {
+    return (double)count / (us / 1000.0);
+  };
+  std::printf("%zu triangles rasterized of %zu occluders, %zu of %zu props "
+              "hidden\n",
+              single.num_triangles(), num_occluders, hidden, props.size());
+  std::printf("triangles per ms: %.0f on 1 thread, %.0f on %u threads\n",
+              per_ms(single.num_triangles(), single_us),
+              per_ms(threaded.num_triangles(), threaded_us),
+              std::thread::hardware_concurrency());
+  std::printf("8x8 triangles per ms: %.0f scalar, %.0f simd\n",
+              per_ms(triangles.size(), scalar_us),
+              per_ms(triangles.size(), simd_us));
+  bench::report("rasterize occluders, 1 thread", single_us);
+  bench::report("rasterize occluders, all threads", threaded_us);
+  bench::report("occlusion tests of 10k props", tests);
+}
+
+TEST_CASE("depth pre-pass on overlapping walls") {
+  const std::size_t num_walls = 64;
+  const std::size_t num_lights = 32;
+
+  auto scene = gle::Scene();
+  auto &shader = scene.make_shader<gle::SolidColorShader>();
+  auto materials = std::vector<gle::Material *>();
+  for (std::size_t i = 0; i < 8; i++) {
+    auto &material = scene.make_material<gle::SolidColorMaterial>(
+        glm::vec3((float)i / 8.0f), 1.0f, 0.5f);
+    material.depth_prepass = true;
+    materials.push_back(&material);
+  }
+  auto &cube = scene.mesh(gle::make_cube_mesh());
+  // Walls covering the whole view. The queue sorts by material before
+  // depth, so each material is drawn front to back over the walls of the
+  // others and most pixels are shaded several times.
+  for (std::size_t i = 0; i < num_walls; i++) {
+    scene.make_object(shader, *materials[i % materials.size()], cube,
+                      glm::vec3(0, 0, -5.0f - (float)i),
+                      glm::vec3(0), glm::vec3(400, 400, 0.5f));
+  }
+  for (std::size_t i = 0; i < num_lights; i++) {
+    scene.make_light(gle::POINT_LIGHT,
+                     glm::vec3((float)(i % 8) - 4.0f, (float)(i / 8) - 2.0f,
+                               -3.0f),
+                     glm::vec3(0), glm::vec3(1), 0.2);
+  }
+  scene.make_camera(glm::vec3(0), glm::vec3(0, 1, 0), glm::vec3(0, 0, -1),
+                    16.0f / 9.0f, glm::radians(60.0f), 0.1f, 300.0f);
+
+  auto window =
+      gle::Window("benchmarks", bench::hidden_window_options(), 1280, 720);
+  auto &all = window.make_render_pass<gle::ObjectRenderPass>();
+  auto options = gle::ObjectRenderOptions();
+  options.depth_prepass = true;
+  auto &prepass = window.make_render_pass<gle::DepthPrePass>(options);
+  auto &shaded = window.make_render_pass<gle::ObjectRenderPass>(options);
+  window.init(scene);
+
+  auto without = bench::time_us(20, [&]() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.upload_uniforms();
+    all.do_render(scene);
+    glFinish();
+  });
+  auto with = bench::time_us(20, [&]() {
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    scene.upload_uniforms();
+    prepass.do_render(scene);
+    shaded.do_render(scene);
+    glFinish();
+  });
+
+  std::printf("%zu walls: %zu depth draws, %zu shaded draws\n",
+              scene.objects().size(), prepass.stats().draws,
+              shaded.stats().draws);
+  bench::report("frame without depth pre-pass", without);
+  bench::report("frame with depth pre-pass", with);
+}